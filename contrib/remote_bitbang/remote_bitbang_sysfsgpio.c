@@ -36,6 +36,12 @@
   Or if you want to test UNIX sockets, run both on Raspberry Pi:
   socat UNIX-LISTEN:/tmp/remotebitbang-socket,fork EXEC:"sudo ./remote_bitbang_sysfsgpio tck 11 tms 25 tdo 9 tdi 10"
   openocd -c "interface remote_bitbang; remote_bitbang_host /tmp/remotebitbang-socket" -f target/stm32f1x.cfg
+
+  For SWD, tck is used as SWCLK and a bidirectional swdio gpio has to be given;
+  the JTAG only gpios can then be left out:
+  socat TCP6-LISTEN:7777,fork EXEC:"sudo ./remote_bitbang_sysfsgpio tck 11 swdio 25"
+  openocd -c "interface remote_bitbang; transport select swd; remote_bitbang_host raspberrypi; remote_bitbang_port 7777" \
+	  -f target/stm32f1x.cfg
 */
 
 #include <sys/types.h>
@@ -164,17 +170,22 @@ static int tdi_fd = -1;
 static int tdo_fd = -1;
 static int trst_fd = -1;
 static int srst_fd = -1;
+static int swdio_fd = -1;
 
 /*
  * Bitbang interface read of TDO
  *
  * The sysfs value will read back either '0' or '1'. The trick here is to call
  * lseek to bypass buffering in the sysfs kernel driver.
+ * Without a tdo gpio (SWD only setup) TDO reads as '0'.
  */
 static int sysfsgpio_read(void)
 {
 	char buf[1];
 
+	if (tdo_fd < 0)
+		return '0';
+
 	/* important to seek to signal sysfs of new read */
 	lseek(tdo_fd, 0, SEEK_SET);
 	int ret = read(tdo_fd, &buf, sizeof(buf));
@@ -236,6 +247,63 @@ static void sysfsgpio_write(int tck, int tms, int tdi)
 	last_tck = tck;
 }
 
+/* gpio numbers for each gpio. Negative values are invalid */
+static int tck_gpio = -1;
+static int tms_gpio = -1;
+static int tdi_gpio = -1;
+static int tdo_gpio = -1;
+static int trst_gpio = -1;
+static int srst_gpio = -1;
+static int swdio_gpio = -1;
+
+/*
+ * SWD: switch SWDIO between driven by us (1) and released to the target (0)
+ */
+static void sysfsgpio_swdio_drive(int is_output)
+{
+	char buf[40];
+
+	snprintf(buf, sizeof(buf), "/sys/class/gpio/gpio%d/direction", swdio_gpio);
+	if (open_write_close(buf, is_output ? "high" : "in") < 0)
+		LOG_WARNING("setting swdio direction failed");
+}
+
+/*
+ * SWD: read SWDIO, as '0' or '1' like sysfsgpio_read()
+ */
+static int sysfsgpio_swdio_read(void)
+{
+	char buf[1];
+
+	lseek(swdio_fd, 0, SEEK_SET);
+	int ret = read(swdio_fd, &buf, sizeof(buf));
+
+	if (ret < 0) {
+		LOG_WARNING("reading swdio failed");
+		return '0';
+	}
+
+	return buf[0];
+}
+
+/*
+ * SWD: write SWDIO, then SWCLK (on the tck gpio)
+ */
+static void sysfsgpio_swd_write(int swclk, int swdio)
+{
+	const char one[] = "1";
+	const char zero[] = "0";
+	size_t bytes_written;
+
+	bytes_written = write(swdio_fd, swdio ? &one : &zero, 1);
+	if (bytes_written != 1)
+		LOG_WARNING("writing swdio failed");
+
+	bytes_written = write(tck_fd, swclk ? &one : &zero, 1);
+	if (bytes_written != 1)
+		LOG_WARNING("writing swclk failed");
+}
+
 /*
  * Bitbang interface to manipulate reset lines SRST and TRST
  *
@@ -262,14 +330,6 @@ static void sysfsgpio_reset(int trst, int srst)
 	}
 }
 
-/* gpio numbers for each gpio. Negative values are invalid */
-static int tck_gpio = -1;
-static int tms_gpio = -1;
-static int tdi_gpio = -1;
-static int tdo_gpio = -1;
-static int trst_gpio = -1;
-static int srst_gpio = -1;
-
 /* helper func to close and cleanup files only if they were valid/ used */
 static void cleanup_fd(int fd, int gpio)
 {
@@ -289,6 +349,54 @@ static void cleanup_all_fds(void)
 	cleanup_fd(tdo_fd, tdo_gpio);
 	cleanup_fd(trst_fd, trst_gpio);
 	cleanup_fd(srst_fd, srst_gpio);
+	cleanup_fd(swdio_fd, swdio_gpio);
+}
+
+/*
+ * Bulk shift: 32 bit little endian cycle count, flags, TMS bits (unless
+ * flag 0x02 is set, then TMS is high on the last cycle only), TDI bits.
+ * With flag 0x01 the TDO bits are sent back, packed like TDI.
+ */
+static int process_bulk_shift(void)
+{
+	unsigned char header[5];
+	if (fread(header, 1, sizeof(header), stdin) != sizeof(header))
+		return ERROR_FAIL;
+
+	unsigned int num_bits = header[0] | header[1] << 8 | header[2] << 16 |
+		(unsigned int)header[3] << 24;
+	unsigned int num_bytes = (num_bits + 7) / 8;
+	int capture = header[4] & 0x01;
+	int tms_exit = header[4] & 0x02;
+
+	unsigned char *buf = calloc(3, num_bytes ? num_bytes : 1);
+	if (!buf)
+		return ERROR_FAIL;
+	unsigned char *tms = buf;
+	unsigned char *tdi = buf + num_bytes;
+	unsigned char *tdo = buf + 2 * num_bytes;
+
+	if ((!tms_exit && fread(tms, 1, num_bytes, stdin) != num_bytes) ||
+			fread(tdi, 1, num_bytes, stdin) != num_bytes) {
+		free(buf);
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < num_bits; i++) {
+		int tms_bit = tms_exit ? i == num_bits - 1 : (tms[i / 8] >> (i % 8)) & 1;
+		int tdi_bit = (tdi[i / 8] >> (i % 8)) & 1;
+
+		sysfsgpio_write(0, tms_bit, tdi_bit);
+		if (capture && sysfsgpio_read() == '1')
+			tdo[i / 8] |= 1 << (i % 8);
+		sysfsgpio_write(1, tms_bit, tdi_bit);
+	}
+
+	if (capture)
+		fwrite(tdo, 1, num_bytes, stdout);
+
+	free(buf);
+	return ERROR_OK;
 }
 
 static void process_remote_protocol(void)
@@ -311,7 +419,23 @@ static void process_remote_protocol(void)
 					(d & 1));
 		} else if (c == 'R')
 			putchar(sysfsgpio_read());
-		else
+		else if ((c == 'O' || c == 'o' || c == 'c' || (c >= 'd' && c <= 'g'))
+				&& swdio_fd < 0)
+			LOG_ERROR("SWD command '%c' received, but no swdio gpio given", c);
+		else if (c == 'O' || c == 'o') /* SWDIO direction */
+			sysfsgpio_swdio_drive(c == 'O');
+		else if (c == 'c') /* SWDIO read */
+			putchar(sysfsgpio_swdio_read());
+		else if (c >= 'd' && c <= 'g') { /* SWD write */
+			char d = c - 'd';
+			sysfsgpio_swd_write(!!(d & 2), (d & 1));
+		} else if (c == 'V') { /* Protocol version */
+			putchar('V');
+			putchar('1');
+		} else if (c == 'J') { /* Bulk shift */
+			if (process_bulk_shift() != ERROR_OK)
+				break;
+		} else
 			LOG_ERROR("Unknown command '%c' received", c);
 	}
 }
@@ -333,16 +457,20 @@ int main(int argc, char *argv[])
 			trst_gpio = atoi(argv[++i]);
 		else if (!strcmp(argv[i], "srst"))
 			srst_gpio = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "swdio"))
+			swdio_gpio = atoi(argv[++i]);
 		else {
-			LOG_ERROR("Usage:\n%s ((tck|tms|tdo|tdi|trst|srst) num)*", argv[0]);
+			LOG_ERROR("Usage:\n%s ((tck|tms|tdo|tdi|trst|srst|swdio) num)*", argv[0]);
 			return -1;
 		}
 	}
 
-	if (!(is_gpio_valid(tck_gpio)
-			&& is_gpio_valid(tms_gpio)
+	int jtag = is_gpio_valid(tms_gpio) || is_gpio_valid(tdi_gpio) ||
+		is_gpio_valid(tdo_gpio) || !is_gpio_valid(swdio_gpio);
+
+	if (!is_gpio_valid(tck_gpio) || (jtag && !(is_gpio_valid(tms_gpio)
 			&& is_gpio_valid(tdi_gpio)
-			&& is_gpio_valid(tdo_gpio))) {
+			&& is_gpio_valid(tdo_gpio)))) {
 		if (!is_gpio_valid(tck_gpio))
 			LOG_ERROR("gpio num for tck is invalid");
 		if (!is_gpio_valid(tms_gpio))
@@ -352,7 +480,8 @@ int main(int argc, char *argv[])
 		if (!is_gpio_valid(tdi_gpio))
 			LOG_ERROR("gpio num for tdi is invalid");
 
-		LOG_ERROR("Require tck, tms, tdi and tdo gpios to all be specified");
+		LOG_ERROR("Require tck, tms, tdi and tdo gpios to all be specified,"
+			" or tck and swdio for SWD only");
 		return ERROR_JTAG_INIT_FAILED;
 	}
 
@@ -364,17 +493,32 @@ int main(int argc, char *argv[])
 	if (tck_fd < 0)
 		goto out_error;
 
-	tms_fd = setup_sysfs_gpio(tms_gpio, 1, 1);
-	if (tms_fd < 0)
-		goto out_error;
+	if (jtag) {
+		tms_fd = setup_sysfs_gpio(tms_gpio, 1, 1);
+		if (tms_fd < 0)
+			goto out_error;
 
-	tdi_fd = setup_sysfs_gpio(tdi_gpio, 1, 0);
-	if (tdi_fd < 0)
-		goto out_error;
+		tdi_fd = setup_sysfs_gpio(tdi_gpio, 1, 0);
+		if (tdi_fd < 0)
+			goto out_error;
 
-	tdo_fd = setup_sysfs_gpio(tdo_gpio, 0, 0);
-	if (tdo_fd < 0)
-		goto out_error;
+		tdo_fd = setup_sysfs_gpio(tdo_gpio, 0, 0);
+		if (tdo_fd < 0)
+			goto out_error;
+	}
+
+	/* SWDIO changes direction, keep it open for both; start out driving it high */
+	if (is_gpio_valid(swdio_gpio)) {
+		swdio_fd = setup_sysfs_gpio(swdio_gpio, 1, 1);
+		if (swdio_fd < 0)
+			goto out_error;
+		close(swdio_fd);
+		char buf[40];
+		snprintf(buf, sizeof(buf), "/sys/class/gpio/gpio%d/value", swdio_gpio);
+		swdio_fd = open(buf, O_RDWR | O_NONBLOCK | O_SYNC);
+		if (swdio_fd < 0)
+			goto out_error;
+	}
 
 	/* assume active low */
 	if (trst_gpio > 0) {
@@ -394,6 +538,7 @@ int main(int argc, char *argv[])
 		 tck_gpio, tms_gpio, tdi_gpio, tdo_gpio);
 	LOG_WARNING("SysfsGPIO num: srst = %d", srst_gpio);
 	LOG_WARNING("SysfsGPIO num: trst = %d", trst_gpio);
+	LOG_WARNING("SysfsGPIO num: swdio = %d", swdio_gpio);
 
 	setvbuf(stdout, NULL, _IONBF, 0);
 	process_remote_protocol();
@@ -1263,23 +1263,14 @@ static int cfi_intel_write_block(struct flash_bank *bank, const uint8_t *buffer,
 
 	target_buffer_set_u32_array(target, target_code, target_code_size / 4, target_code_src);
 
-	/* Get memory for block write handler */
-	retval = target_alloc_working_area(target,
-			target_code_size,
+	/* Get memory for block write handler, with the code loaded */
+	retval = target_alloc_algorithm(target, target_code, target_code_size,
 			&write_algorithm);
 	if (retval != ERROR_OK) {
 		LOG_WARNING("No working area available, can't do block memory writes");
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
 
-	/* write algorithm code to working area */
-	retval = target_write_buffer(target, write_algorithm->address,
-			target_code_size, target_code);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Unable to write block write code to target");
-		goto cleanup;
-	}
-
 	/* Get a workspace buffer for the data to flash starting with 32k size.
 	 * Half size until buffer would be smaller 256 Bytes then fail back */
 	/* FIXME Why 256 bytes, why not 32 bytes (smallest flash write page */
@@ -1373,7 +1364,7 @@ cleanup:
 	if (source)
 		target_free_working_area(target, source);
 
-	target_free_working_area(target, write_algorithm);
+	target_free_algorithm(target, write_algorithm);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -1502,23 +1493,12 @@ static int cfi_spansion_write_block_mips(struct flash_bank *bank, const uint8_t
 
 	target_buffer_set_u32_array(target, target_code, target_code_size / 4, target_code_src);
 
-	/* allocate working area */
-	retval = target_alloc_working_area(target, target_code_size,
+	/* allocate working area with the algorithm code */
+	retval = target_alloc_algorithm(target, target_code, target_code_size,
 			&write_algorithm);
-	if (retval != ERROR_OK) {
-		free(target_code);
-		return retval;
-	}
-
-	/* write algorithm code to working area */
-	retval = target_write_buffer(target, write_algorithm->address,
-			target_code_size, target_code);
-	if (retval != ERROR_OK) {
-		free(target_code);
-		return retval;
-	}
-
 	free(target_code);
+	if (retval != ERROR_OK)
+		return retval;
 
 	/* the following code still assumes target code is fixed 24*4 bytes */
 
@@ -1527,7 +1507,7 @@ static int cfi_spansion_write_block_mips(struct flash_bank *bank, const uint8_t
 		if (buffer_size <= 256) {
 			/* we already allocated the writing code, but failed to get a
 			 * buffer, free the algorithm */
-			target_free_working_area(target, write_algorithm);
+			target_free_algorithm(target, write_algorithm);
 
 			LOG_WARNING(
 				"not enough working area available, can't do block memory writes");
@@ -1582,7 +1562,8 @@ static int cfi_spansion_write_block_mips(struct flash_bank *bank, const uint8_t
 		count -= thisrun_count;
 	}
 
-	target_free_all_working_areas(target);
+	target_free_working_area(target, source);
+	target_free_algorithm(target, write_algorithm);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -1881,23 +1862,12 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 
 	target_buffer_set_u32_array(target, target_code, target_code_size / 4, target_code_src);
 
-	/* allocate working area */
-	retval = target_alloc_working_area(target, target_code_size,
+	/* allocate working area with the algorithm code */
+	retval = target_alloc_algorithm(target, target_code, target_code_size,
 			&write_algorithm);
-	if (retval != ERROR_OK) {
-		free(target_code);
-		return retval;
-	}
-
-	/* write algorithm code to working area */
-	retval = target_write_buffer(target, write_algorithm->address,
-			target_code_size, target_code);
-	if (retval != ERROR_OK) {
-		free(target_code);
-		return retval;
-	}
-
 	free(target_code);
+	if (retval != ERROR_OK)
+		return retval;
 
 	/* the following code still assumes target code is fixed 24*4 bytes */
 
@@ -1906,7 +1876,7 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 		if (buffer_size <= 256) {
 			/* we already allocated the writing code, but failed to get a
 			 * buffer, free the algorithm */
-			target_free_working_area(target, write_algorithm);
+			target_free_algorithm(target, write_algorithm);
 
 			LOG_WARNING(
 				"not enough working area available, can't do block memory writes");
@@ -1961,7 +1931,8 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 		count -= thisrun_count;
 	}
 
-	target_free_all_working_areas(target);
+	target_free_working_area(target, source);
+	target_free_algorithm(target, write_algorithm);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
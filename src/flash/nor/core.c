@@ -696,8 +696,133 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/* unlock, erase and program one part of a run */
+static int flash_write_range(struct target *target, struct flash_bank *c,
+	uint8_t *buffer, target_addr_t address, uint32_t size, int erase, bool unlock)
+{
+	int retval = ERROR_OK;
+
+	if (unlock)
+		retval = flash_unlock_address_range(target, address, size);
+	if (retval == ERROR_OK) {
+		if (erase) {
+			/* calculate and erase sectors */
+			retval = flash_erase_address_range(target,
+					true, address, size);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		/* write flash sectors */
+		retval = flash_driver_write(c, buffer, address - c->base, size);
+	}
+
+	return retval;
+}
+
+/**
+ * CRC of flash contents.  Banks read through the target's memory map are
+ * checksummed on the target; others, whose driver has its own read
+ * routine, are read back through the driver and checksummed here.
+ */
+static int flash_checksum(struct target *target, struct flash_bank *c,
+	uint32_t offset, uint32_t count, uint32_t *crc)
+{
+	if (c->driver->read == NULL || c->driver->read == default_flash_read)
+		return target_checksum_memory(target, c->base + offset, count, crc);
+
+	uint8_t *buffer = malloc(count);
+	if (buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = flash_driver_read(c, buffer, offset, count);
+	if (retval == ERROR_OK)
+		retval = image_calculate_checksum(buffer, count, crc);
+	free(buffer);
+
+	return retval;
+}
+
+/**
+ * Write a run sector by sector, skipping those sectors whose contents
+ * already match.  A sector whose flash contents can't be checksummed is
+ * written.  Consecutive changed sectors are written together.
+ */
+static int flash_write_changed(struct target *target, struct flash_bank *c,
+	uint8_t *buffer, target_addr_t address, uint32_t size, int erase, bool unlock,
+	uint32_t *written)
+{
+	uint32_t start = address - c->base;
+	uint32_t end = start + size;
+	uint32_t offset = start;
+	uint32_t dirty_start = start;
+	uint32_t dirty_end = start;
+	int sector = 0;
+	int retval;
+
+	*written = 0;
+
+	while (offset < end) {
+		uint32_t chunk_end = end;
+
+		/* find the sector containing offset */
+		while (sector < c->num_sectors &&
+				c->sectors[sector].offset + c->sectors[sector].size <= offset)
+			sector++;
+		if (sector < c->num_sectors &&
+				c->sectors[sector].offset + c->sectors[sector].size < end)
+			chunk_end = c->sectors[sector].offset + c->sectors[sector].size;
+
+		uint32_t image_crc, flash_crc;
+		retval = image_calculate_checksum(buffer + offset - start,
+				chunk_end - offset, &image_crc);
+		if (retval != ERROR_OK)
+			return retval;
+		bool changed = true;
+		if (flash_checksum(target, c, offset, chunk_end - offset, &flash_crc) == ERROR_OK)
+			changed = image_crc != flash_crc;
+		else
+			LOG_DEBUG("can't checksum flash at " TARGET_ADDR_FMT ", writing it",
+					c->base + offset);
+
+		if (changed) {
+			if (dirty_end != offset) {
+				/* not adjacent to the pending changes, flush them */
+				if (dirty_end > dirty_start) {
+					retval = flash_write_range(target, c, buffer + dirty_start - start,
+							c->base + dirty_start, dirty_end - dirty_start,
+							erase, unlock);
+					if (retval != ERROR_OK)
+						return retval;
+					*written += dirty_end - dirty_start;
+				}
+				dirty_start = offset;
+			}
+			dirty_end = chunk_end;
+		} else {
+			LOG_DEBUG("skipping unchanged flash at " TARGET_ADDR_FMT
+					", %" PRIu32 " bytes", c->base + offset, chunk_end - offset);
+		}
+
+		offset = chunk_end;
+	}
+
+	if (dirty_end > dirty_start) {
+		retval = flash_write_range(target, c, buffer + dirty_start - start,
+				c->base + dirty_start, dirty_end - dirty_start, erase, unlock);
+		if (retval != ERROR_OK)
+			return retval;
+		*written += dirty_end - dirty_start;
+	}
+
+	return ERROR_OK;
+}
+
 int flash_write_unlock(struct target *target, struct image *image,
-	uint32_t *written, int erase, bool unlock)
+	uint32_t *written, int erase, bool unlock, bool incremental,
+	uint32_t *skipped)
 {
 	int retval = ERROR_OK;
 
@@ -711,6 +836,8 @@ int flash_write_unlock(struct target *target, struct image *image,
 
 	if (written)
 		*written = 0;
+	if (skipped)
+		*skipped = 0;
 
 	if (erase) {
 		/* assume all sectors need erasing - stops any problems
@@ -864,18 +991,42 @@ int flash_write_unlock(struct target *target, struct image *image,
 			run_size += delta;
 		}
 
-		/* allocate buffer */
-		buffer = malloc(run_size);
-		if (buffer == NULL) {
-			LOG_ERROR("Out of memory for flash bank buffer");
-			retval = ERROR_FAIL;
-			goto done;
-		}
+		/* KLUDGE!
+		 *
+		 * #¤%#"%¤% we have to figure out the section # from the sorted
+		 * list of pointers to sections to invoke image_read_section()...
+		 */
+		intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
+		int t_section_num = diff / sizeof(struct imagesection);
+
+		/* if the whole run lies inside one section which the image already
+		 * holds in memory, write straight from there without copying */
+		uint8_t *section_data = NULL;
+		if (padding_at_start == 0 && run_size <= sections[section]->size - section_offset)
+			section_data = image_section_data(image, t_section_num);
+
+		if (section_data) {
+			buffer = section_data + section_offset;
+			section_offset += run_size;
+			if (section_offset >= sections[section]->size) {
+				section++;
+				section_offset = 0;
+			}
+			buffer_idx = run_size;
+		} else {
+			/* allocate buffer */
+			buffer = malloc(run_size);
+			if (buffer == NULL) {
+				LOG_ERROR("Out of memory for flash bank buffer");
+				retval = ERROR_FAIL;
+				goto done;
+			}
 
-		if (padding_at_start)
-			memset(buffer, c->default_padded_value, padding_at_start);
+			if (padding_at_start)
+				memset(buffer, c->default_padded_value, padding_at_start);
 
-		buffer_idx = padding_at_start;
+			buffer_idx = padding_at_start;
+		}
 
 		/* read sections to the buffer */
 		while (buffer_idx < run_size) {
@@ -885,13 +1036,8 @@ int flash_write_unlock(struct target *target, struct image *image,
 			if (size_read > sections[section]->size - section_offset)
 				size_read = sections[section]->size - section_offset;
 
-			/* KLUDGE!
-			 *
-			 * #¤%#"%¤% we have to figure out the section # from the sorted
-			 * list of pointers to sections to invoke image_read_section()...
-			 */
-			intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
-			int t_section_num = diff / sizeof(struct imagesection);
+			diff = (intptr_t)sections[section] - (intptr_t)image->sections;
+			t_section_num = diff / sizeof(struct imagesection);
 
 			LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, "
 					"section_offset = %"PRIu32", buffer_idx = %"PRIu32", size_read = %zu",
@@ -919,24 +1065,16 @@ int flash_write_unlock(struct target *target, struct image *image,
 			}
 		}
 
-		retval = ERROR_OK;
-
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
-		if (retval == ERROR_OK) {
-			if (erase) {
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
-			}
-		}
-
-		if (retval == ERROR_OK) {
-			/* write flash sectors */
-			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
-		}
+		uint32_t run_written = run_size;
+		if (incremental)
+			retval = flash_write_changed(target, c, buffer, run_address, run_size,
+					erase, unlock, &run_written);
+		else
+			retval = flash_write_range(target, c, buffer, run_address, run_size,
+					erase, unlock);
 
-		free(buffer);
+		if (!section_data)
+			free(buffer);
 
 		if (retval != ERROR_OK) {
 			/* abort operation */
@@ -944,7 +1082,9 @@ int flash_write_unlock(struct target *target, struct image *image,
 		}
 
 		if (written != NULL)
-			*written += run_size;	/* add run size to total written counter */
+			*written += run_written;	/* add run size to total written counter */
+		if (skipped != NULL)
+			*skipped += run_size - run_written;
 	}
 
 done:
@@ -957,7 +1097,7 @@ done:
 int flash_write(struct target *target, struct image *image,
 	uint32_t *written, int erase)
 {
-	return flash_write_unlock(target, image, written, erase, false);
+	return flash_write_unlock(target, image, written, erase, false, false, NULL);
 }
 
 struct flash_sector *alloc_block_array(uint32_t offset, uint32_t size, int num_blocks)
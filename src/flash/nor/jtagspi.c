@@ -26,12 +26,21 @@
 
 #define JTAGSPI_MAX_TIMEOUT 3000
 
+/* Typical page program time of a 256 byte page, on the slow side of
+ * what datasheets quote.  Sizes the status polling queued behind each
+ * page; slower parts just need a retry. */
+#define JTAGSPI_PAGE_PROGRAM_TYP_US 700
+#define JTAGSPI_MAX_STATUS_READS 64
+/* Page data queued per jtag_execute_queue() while writing */
+#define JTAGSPI_QUEUE_BYTES 16384
 
 struct jtagspi_flash_bank {
 	struct jtag_tap *tap;
 	const struct flash_device *dev;
 	int probed;
 	uint32_t ir;
+	unsigned int addr_len;	/* 3 or 4 byte addresses */
+	uint8_t read_cmd;
 };
 
 FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
@@ -50,6 +59,8 @@ FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
 
 	info->tap = NULL;
 	info->probed = 0;
+	info->addr_len = 3;
+	info->read_cmd = SPIFLASH_FAST_READ;
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[6], info->ir);
 
 	return ERROR_OK;
@@ -75,23 +86,24 @@ static void flip_u8(uint8_t *in, uint8_t *out, int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
-		uint32_t *addr, uint8_t *data, int len)
+/* Queue one SPI transfer of @a len bits, without executing it.  @a out
+ * has to be bit reversed already (see flip_u8()); it is copied into the
+ * JTAG queue.  @a in receives bit reversed data when the queue executes.
+ * @a dummy_bits are clocked out between the address and the data. */
+static void jtagspi_queue_cmd(struct flash_bank *bank, uint8_t cmd,
+		const uint32_t *addr, unsigned int dummy_bits,
+		const uint8_t *out, uint8_t *in, unsigned int len)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
-	struct scan_field fields[6];
+	struct scan_field fields[7];
 	uint8_t marker = 1;
 	uint8_t xfer_bits_buf[4];
-	uint8_t addr_buf[3];
-	uint8_t *data_buf;
+	uint8_t addr_buf[4];
+	uint8_t dummy_buf[4] = { 0 };
 	uint32_t xfer_bits;
-	int is_read, lenb, n;
-
-	/* LOG_DEBUG("cmd=0x%02x len=%i", cmd, len); */
+	int n;
 
-	is_read = (len < 0);
-	if (is_read)
-		len = -len;
+	/* LOG_DEBUG("cmd=0x%02x len=%u", cmd, len); */
 
 	n = 0;
 
@@ -100,10 +112,10 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	fields[n].in_value = NULL;
 	n++;
 
-	xfer_bits = 8 + len - 1;
+	xfer_bits = 8 + dummy_bits + len - 1;
 	/* cmd + read/write - 1 due to the counter implementation */
 	if (addr)
-		xfer_bits += 24;
+		xfer_bits += 8 * info->addr_len;
 	h_u32_to_be(xfer_bits_buf, xfer_bits);
 	flip_u8(xfer_bits_buf, xfer_bits_buf, 4);
 	fields[n].num_bits = 32;
@@ -118,32 +130,35 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	n++;
 
 	if (addr) {
-		h_u24_to_be(addr_buf, *addr);
-		flip_u8(addr_buf, addr_buf, 3);
-		fields[n].num_bits = 24;
+		if (info->addr_len == 4)
+			h_u32_to_be(addr_buf, *addr);
+		else
+			h_u24_to_be(addr_buf, *addr);
+		flip_u8(addr_buf, addr_buf, info->addr_len);
+		fields[n].num_bits = 8 * info->addr_len;
 		fields[n].out_value = addr_buf;
 		fields[n].in_value = NULL;
 		n++;
 	}
 
-	lenb = DIV_ROUND_UP(len, 8);
-	data_buf = malloc(lenb);
-	if (lenb > 0) {
-		if (data_buf == NULL) {
-			LOG_ERROR("no memory for spi buffer");
-			return ERROR_FAIL;
-		}
-		if (is_read) {
+	if (dummy_bits) {
+		fields[n].num_bits = dummy_bits;
+		fields[n].out_value = dummy_buf;
+		fields[n].in_value = NULL;
+		n++;
+	}
+
+	if (len > 0) {
+		if (in) {
 			fields[n].num_bits = jtag_tap_count_enabled();
 			fields[n].out_value = NULL;
 			fields[n].in_value = NULL;
 			n++;
 
 			fields[n].out_value = NULL;
-			fields[n].in_value = data_buf;
+			fields[n].in_value = in;
 		} else {
-			flip_u8(data, data_buf, lenb);
-			fields[n].out_value = data_buf;
+			fields[n].out_value = out;
 			fields[n].in_value = NULL;
 		}
 		fields[n].num_bits = len;
@@ -153,12 +168,37 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	jtagspi_set_ir(bank);
 	/* passing from an IR scan to SHIFT-DR clears BYPASS registers */
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	jtag_execute_queue();
+}
+
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint32_t *addr, uint8_t *data, int len)
+{
+	uint8_t *data_buf = NULL;
+	int is_read, lenb, retval;
 
+	is_read = (len < 0);
 	if (is_read)
+		len = -len;
+
+	lenb = DIV_ROUND_UP(len, 8);
+	if (lenb > 0) {
+		data_buf = malloc(lenb);
+		if (data_buf == NULL) {
+			LOG_ERROR("no memory for spi buffer");
+			return ERROR_FAIL;
+		}
+		if (!is_read)
+			flip_u8(data, data_buf, lenb);
+	}
+
+	jtagspi_queue_cmd(bank, cmd, addr, 0, is_read ? NULL : data_buf,
+			is_read ? data_buf : NULL, len);
+	retval = jtag_execute_queue();
+
+	if (is_read && retval == ERROR_OK)
 		flip_u8(data_buf, data, lenb);
 	free(data_buf);
-	return ERROR_OK;
+	return retval;
 }
 
 static int jtagspi_probe(struct flash_bank *bank)
@@ -201,8 +241,18 @@ static int jtagspi_probe(struct flash_bank *bank)
 	bank->size = info->dev->size_in_bytes;
 	if (bank->size <= (1UL << 16))
 		LOG_WARNING("device needs 2-byte addresses - not implemented");
-	if (bank->size > (1UL << 24))
-		LOG_WARNING("device needs paging or 4-byte addresses - not implemented");
+
+	/* Large parts are listed with their 4-byte address commands, which
+	 * unlike the 4-byte address mode leave the device state alone (and
+	 * thus a booting FPGA working) */
+	info->addr_len = 3;
+	if (bank->size > (1UL << 24)) {
+		if (info->dev->read_cmd == SPIFLASH_READ_4B)
+			info->addr_len = 4;
+		else
+			LOG_WARNING("device needs paging or 4-byte addresses - not implemented");
+	}
+	info->read_cmd = (info->addr_len == 4) ? SPIFLASH_FAST_READ_4B : SPIFLASH_FAST_READ;
 
 	/* if no sectors, treat whole bank as single sector */
 	sectorsize = info->dev->sectorsize ?
@@ -364,32 +414,81 @@ static int jtagspi_protect(struct flash_bank *bank, int set, int first, int last
 static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
+	int retval;
 
 	if (!(info->probed)) {
 		LOG_ERROR("Flash bank not yet probed.");
 		return ERROR_FLASH_BANK_NOT_PROBED;
 	}
 
-	jtagspi_cmd(bank, SPIFLASH_READ, &offset, buffer, -count*8);
+	/* fast read, with 8 dummy clocks, is not limited to low SPI clocks */
+	jtagspi_queue_cmd(bank, info->read_cmd, &offset, 8, NULL, buffer, count * 8);
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	flip_u8(buffer, buffer, count);
 	return ERROR_OK;
 }
 
-static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
+/* A page program queued by jtagspi_write(), with the raw (bit reversed)
+ * status register values read back in the same queue */
+struct jtagspi_page {
+	uint32_t offset;
+	uint32_t count;
+	const uint8_t *data;
+	uint8_t wren_status;
+	uint8_t status[JTAGSPI_MAX_STATUS_READS];
+};
+
+/* Number of status reads to queue behind a page program, so that a
+ * typical page has finished by the last one. */
+static unsigned int jtagspi_status_reads(struct flash_bank *bank, uint32_t pagesize)
 {
-	int retval;
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	unsigned int khz = jtag_get_speed_khz();
 
-	retval = jtagspi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
-	jtagspi_cmd(bank, SPIFLASH_PAGE_PROGRAM, &offset, (uint8_t *) buffer, count*8);
-	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+	/* FRAMs write at bus speed */
+	if (info->dev->pagesize == 0)
+		return 1;
+
+	/* adaptive clocking, no idea how long a scan takes */
+	if (khz == 0)
+		return JTAGSPI_MAX_STATUS_READS / 4;
+
+	/* IR scan, then marker, length, command, bypass bits and status,
+	 * plus a few TCK for moving between the TAP states */
+	unsigned int bits = info->tap->ir_length + 1 + 32 + 8
+		+ jtag_tap_count_enabled() + 8 + 12;
+	uint64_t typ_us = (uint64_t)JTAGSPI_PAGE_PROGRAM_TYP_US * pagesize / 256;
+	uint64_t reads = DIV_ROUND_UP(typ_us * khz / 1000, bits);
+
+	return MAX(1, MIN(reads, JTAGSPI_MAX_STATUS_READS));
+}
+
+static void jtagspi_queue_page(struct flash_bank *bank, struct jtagspi_page *page,
+		uint8_t *flip_buf, unsigned int status_reads)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+
+	flip_u8((uint8_t *)page->data, flip_buf, page->count);
+
+	jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, 0, NULL, NULL, 0);
+	jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, NULL, &page->wren_status, 8);
+	jtagspi_queue_cmd(bank, info->dev->pprog_cmd, &page->offset, 0, flip_buf, NULL,
+			page->count * 8);
+	for (unsigned int i = 0; i < status_reads; i++)
+		jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, NULL, &page->status[i], 8);
 }
 
 static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
-	int retval;
+	struct jtagspi_page *pages;
+	uint8_t *flip_buf;
+	int retval = ERROR_OK;
 	uint32_t n, pagesize;
+	unsigned int max_pages, queued = 0, status_reads;
 
 	if (!(info->probed)) {
 		LOG_ERROR("Flash bank not yet probed.");
@@ -399,16 +498,94 @@ static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 	/* if no write pagesize, use reasonable default */
 	pagesize = info->dev->pagesize ? info->dev->pagesize : SPIFLASH_DEF_PAGESIZE;
 
-	for (n = 0; n < count; n += pagesize) {
-		retval = jtagspi_page_write(bank, buffer + n, offset + n,
-				MIN(count - n, pagesize));
-		if (retval != ERROR_OK) {
-			LOG_ERROR("page write error");
-			return retval;
+	/* Each round queues write enable, page program and a number of status
+	 * reads for several pages and executes them at once.  A page sent
+	 * while the previous one is still programming gets rejected by the
+	 * flash (WEL stays clear); only those pages are queued again. */
+	max_pages = MAX(1, JTAGSPI_QUEUE_BYTES / pagesize);
+	status_reads = jtagspi_status_reads(bank, pagesize);
+	LOG_DEBUG("%u pages per queue, %u status reads per page", max_pages, status_reads);
+
+	pages = malloc(max_pages * sizeof(*pages));
+	flip_buf = malloc(pagesize);
+	if (pages == NULL || flip_buf == NULL) {
+		LOG_ERROR("no memory for page buffers");
+		free(pages);
+		free(flip_buf);
+		return ERROR_FAIL;
+	}
+
+	n = 0;
+	while (n < count || queued > 0) {
+		/* don't cross page boundaries, the address would wrap around */
+		while (queued < max_pages && n < count) {
+			struct jtagspi_page *page = &pages[queued++];
+			page->offset = offset + n;
+			page->count = MIN(count - n, pagesize - (page->offset % pagesize));
+			page->data = buffer + n;
+			n += page->count;
+		}
+
+		for (unsigned int i = 0; i < queued; i++)
+			jtagspi_queue_page(bank, &pages[i], flip_buf, status_reads);
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			break;
+
+		/* the last status read tells whether the flash is still busy */
+		bool busy = flip_u32(pages[queued - 1].status[status_reads - 1], 8) & SPIFLASH_BSY_BIT;
+
+		unsigned int rejected = 0;
+		bool slow = false;
+		for (unsigned int i = 0; i < queued; i++) {
+			struct jtagspi_page *page = &pages[i];
+			uint32_t status = flip_u32(page->wren_status, 8);
+
+			if ((status & SPIFLASH_BSY_BIT) || !(status & SPIFLASH_WE_BIT)) {
+				/* The first page is sent to an idle device, so the write
+				 * enable itself failed */
+				if (i == 0 && !(status & SPIFLASH_BSY_BIT)) {
+					LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
+					retval = ERROR_FAIL;
+					break;
+				}
+				pages[rejected++] = *page;
+				continue;
+			}
+
+			unsigned int j;
+			for (j = 0; j < status_reads; j++)
+				if (!(flip_u32(page->status[j], 8) & SPIFLASH_BSY_BIT))
+					break;
+			if (j == status_reads)
+				slow = true;
+			LOG_DEBUG("wrote page at 0x%08" PRIx32, page->offset);
+		}
+		if (retval != ERROR_OK)
+			break;
+
+		/* poll a bit longer for the next pages, to avoid retries */
+		if (slow && status_reads < JTAGSPI_MAX_STATUS_READS) {
+			status_reads = MIN(2 * status_reads, JTAGSPI_MAX_STATUS_READS);
+			LOG_DEBUG("page program slower than expected, %u status reads per page",
+					status_reads);
+		}
+
+		queued = rejected;
+
+		if (busy) {
+			retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+			if (retval != ERROR_OK)
+				break;
 		}
-		LOG_DEBUG("wrote page at 0x%08" PRIx32, offset + n);
 	}
-	return ERROR_OK;
+
+	free(flip_buf);
+	free(pages);
+
+	if (retval != ERROR_OK)
+		LOG_ERROR("page write error");
+	return retval;
 }
 
 static int jtagspi_info(struct flash_bank *bank, char *buf, int buf_size)
@@ -1269,23 +1269,20 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		buffer_size = (target->working_area_size/2);
 
 	/* allocate working area with flash programming code */
-	if (target_alloc_working_area(target, sizeof(kinetis_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
-		LOG_WARNING("no working area available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-		sizeof(kinetis_flash_write_code), kinetis_flash_write_code);
-	if (retval != ERROR_OK)
+	retval = target_alloc_algorithm(target, kinetis_flash_write_code,
+			sizeof(kinetis_flash_write_code), &write_algorithm);
+	if (retval != ERROR_OK) {
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			LOG_WARNING("no working area available, can't do block memory writes");
 		return retval;
+	}
 
 	/* memory buffer */
 	while (target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
 		buffer_size /= 4;
 		if (buffer_size <= 256) {
 			/* free working area, write algorithm already allocated */
-			target_free_working_area(target, write_algorithm);
+			target_free_algorithm(target, write_algorithm);
 
 			LOG_WARNING("No large enough working area available, can't do block memory writes");
 			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
@@ -1330,7 +1327,7 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		LOG_ERROR("Error executing kinetis Flash programming algorithm");
 
 	target_free_working_area(target, source);
-	target_free_working_area(target, write_algorithm);
+	target_free_algorithm(target, write_algorithm);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -718,17 +718,11 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_FAIL;
 	}
 
-	if (target_alloc_working_area(target, sizeof(stm32x_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
-		LOG_WARNING("no working area available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-			sizeof(stm32x_flash_write_code),
-			stm32x_flash_write_code);
+	retval = target_alloc_algorithm(target, stm32x_flash_write_code,
+			sizeof(stm32x_flash_write_code), &write_algorithm);
 	if (retval != ERROR_OK) {
-		target_free_working_area(target, write_algorithm);
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			LOG_WARNING("no working area available, can't do block memory writes");
 		return retval;
 	}
 
@@ -738,7 +732,7 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		if (buffer_size <= 256) {
 			/* we already allocated the writing code, but failed to get a
 			 * buffer, free the algorithm */
-			target_free_working_area(target, write_algorithm);
+			target_free_algorithm(target, write_algorithm);
 
 			LOG_WARNING("no large enough working area available, can't do block memory writes");
 			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
@@ -784,7 +778,7 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	}
 
 	target_free_working_area(target, source);
-	target_free_working_area(target, write_algorithm);
+	target_free_algorithm(target, write_algorithm);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
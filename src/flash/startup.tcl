@@ -3,7 +3,7 @@
 #
 # program utility proc
 # usage: program filename
-# optional args: verify, reset, exit and address
+# optional args: preverify, incremental, verify, reset, exit and address
 #
 
 proc program_error {description exit} {
@@ -22,6 +22,8 @@ proc program {filename args} {
 	foreach arg $args {
 		if {[string equal $arg "preverify"]} {
 			set preverify 1
+		} elseif {[string equal $arg "incremental"]} {
+			set incremental 1
 		} elseif {[string equal $arg "verify"]} {
 			set verify 1
 		} elseif {[string equal $arg "reset"]} {
@@ -65,7 +67,13 @@ proc program {filename args} {
 	if {$needsflash == 1} {
 		echo "** Programming Started **"
 
-		if {[catch {eval flash write_image erase $flash_args}] == 0} {
+		if {[info exists incremental]} {
+			set write_args "erase incremental"
+		} else {
+			set write_args "erase"
+		}
+
+		if {[catch {eval flash write_image $write_args $flash_args}] == 0} {
 			echo "** Programming Finished **"
 			if {[info exists verify]} {
 				# verify phase
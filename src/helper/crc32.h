@@ -0,0 +1,34 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_HELPER_CRC32_H
+#define OPENOCD_HELPER_CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * The CRC-32 gdb uses for "compare-sections" (qCRC): polynomial
+ * 0x04c11db7, MSB first, no final inversion.  Start with 0xffffffff.
+ */
+
+/** Fold @a len bytes into @a crc, eight bytes per step (slicing-by-8). */
+uint32_t crc32_be_update(uint32_t crc, const uint8_t *buffer, size_t len);
+
+/** Same result as crc32_be_update(), one byte per step as gdb does it. */
+uint32_t crc32_be_update_bytewise(uint32_t crc, const uint8_t *buffer, size_t len);
+
+#endif /* OPENOCD_HELPER_CRC32_H */
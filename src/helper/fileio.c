@@ -30,12 +30,17 @@
 #include "configuration.h"
 #include "fileio.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 struct fileio {
 	char *url;
 	size_t size;
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	uint8_t *map;	/* contents mapped by fileio_map(), or NULL */
 };
 
 static inline int fileio_close_local(struct fileio *fileio)
@@ -127,6 +132,7 @@ int fileio_open(struct fileio **fileio, const char *url,
 	tmp->type = type;
 	tmp->access = access_type;
 	tmp->url = strdup(url);
+	tmp->map = NULL;
 
 	retval = fileio_open_local(tmp);
 
@@ -145,6 +151,11 @@ int fileio_close(struct fileio *fileio)
 {
 	int retval;
 
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->map)
+		munmap(fileio->map, fileio->size);
+#endif
+
 	retval = fileio_close_local(fileio);
 
 	free(fileio->url);
@@ -272,3 +283,31 @@ int fileio_size(struct fileio *fileio, size_t *size)
 
 	return ERROR_OK;
 }
+
+int fileio_map(struct fileio *fileio, uint8_t **data)
+{
+	if (fileio->map) {
+		*data = fileio->map;
+		return ERROR_OK;
+	}
+
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->access != FILEIO_READ || fileio->size == 0)
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+	/* The mapping is private: users may modify the contents in place,
+	 * without affecting the file. */
+	void *map = mmap(NULL, fileio->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+			fileno(fileio->file), 0);
+	if (map == MAP_FAILED) {
+		LOG_DEBUG("couldn't map %s: %s", fileio->url, strerror(errno));
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+	}
+
+	fileio->map = map;
+	*data = fileio->map;
+	return ERROR_OK;
+#else
+	return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+#endif
+}
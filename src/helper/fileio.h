@@ -60,6 +60,14 @@ int fileio_read_u32(struct fileio *fileio, uint32_t *data);
 int fileio_write_u32(struct fileio *fileio, uint32_t data);
 int fileio_size(struct fileio *fileio, size_t *size);
 
+/**
+ * Map the contents of a file opened for reading into memory.  The mapping
+ * is private: changes to it do not reach the file.  It stays valid until
+ * the file is closed.  Returns ERROR_FILEIO_OPERATION_NOT_SUPPORTED if
+ * the file cannot be mapped, callers then use fileio_read().
+ */
+int fileio_map(struct fileio *fileio, uint8_t **data);
+
 #define ERROR_FILEIO_LOCATION_UNKNOWN			(-1200)
 #define ERROR_FILEIO_NOT_FOUND					(-1201)
 #define ERROR_FILEIO_OPERATION_FAILED			(-1202)
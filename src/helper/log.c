@@ -32,6 +32,11 @@
 
 #include <stdarg.h>
 
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE)
+#include <pthread.h>
+#define LOG_ASYNC_SUPPORTED
+#endif
+
 #ifdef _DEBUG_FREE_SPACE_
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
@@ -61,6 +66,269 @@ static const char * const log_strings[6] = {
 
 static int count;
 
+/* Messages up to this length are formatted without a heap allocation */
+#define LOG_INLINE_SIZE	512
+
+#ifdef LOG_ASYNC_SUPPORTED
+/*
+ * Asynchronous log output.
+ *
+ * The main thread formats each message and copies it into a ring buffer,
+ * from where a writer thread prints it to the log file.  The ring buffer
+ * has a single producer and a single consumer, which only publish their
+ * positions with atomic stores, so neither side ever takes a lock.  When
+ * the ring buffer is full messages are dropped and counted; the writer
+ * reports the number of dropped messages once it caught up.  Callbacks
+ * are still called synchronously by the main thread.
+ */
+#define LOG_RING_SIZE		(1024 * 1024)
+/* Longest time a message waits in the ring buffer, in ms */
+#define LOG_WRITER_INTERVAL	20
+#define LOG_RECORD_ALIGN	8
+/* Record size of the padding that fills up the end of the ring buffer */
+#define LOG_RECORD_PADDING	(-100)
+
+struct log_record {
+	/* total size of the record, including the message */
+	size_t size;
+	int level;
+	int count;
+	int64_t time;
+	const char *file;
+	int line;
+	const char *function;
+	char string[];
+};
+
+static struct {
+	bool running;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool stop;
+	uint8_t *ring;
+	/* Positions increase monotonically, the offset into the ring is
+	 * position modulo LOG_RING_SIZE. */
+	size_t head;
+	size_t tail;
+	/* dropped since the writer last looked, and in total */
+	unsigned int dropped;
+	unsigned int dropped_total;
+	unsigned int written;
+} log_async;
+#endif
+
+static void log_write(enum log_levels level, int msg_count, int64_t t,
+	const char *file, int line, const char *function, const char *string)
+{
+	if (level == LOG_LVL_OUTPUT) {
+		/* do not prepend any headers, just print out what we were given */
+		fputs(string, log_output);
+		return;
+	}
+
+	if (debug_level >= LOG_LVL_DEBUG) {
+		/* print with count and time information */
+#ifdef _DEBUG_FREE_SPACE_
+		struct mallinfo info;
+		info = mallinfo();
+#endif
+		fprintf(log_output, "%s%d %" PRId64 " %s:%d %s()"
+#ifdef _DEBUG_FREE_SPACE_
+			" %d"
+#endif
+			": %s", log_strings[level + 1], msg_count, t, file, line, function,
+#ifdef _DEBUG_FREE_SPACE_
+			info.fordblks,
+#endif
+			string);
+	} else {
+		/* if we are using gdb through pipes then we do not want any output
+		 * to the pipe otherwise we get repeated strings */
+		fprintf(log_output, "%s%s",
+			(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
+	}
+}
+
+#ifdef LOG_ASYNC_SUPPORTED
+static struct log_record *log_async_record(size_t offset)
+{
+	/* offsets are multiples of LOG_RECORD_ALIGN */
+	void *record = &log_async.ring[offset];
+	return record;
+}
+
+static void log_async_drain(void)
+{
+	size_t head = __atomic_load_n(&log_async.head, __ATOMIC_ACQUIRE);
+	size_t tail = log_async.tail;
+
+	while (tail != head) {
+		size_t offset = tail % LOG_RING_SIZE;
+
+		/* too little room at the end of the ring even for padding */
+		if (LOG_RING_SIZE - offset < sizeof(struct log_record)) {
+			tail += LOG_RING_SIZE - offset;
+			__atomic_store_n(&log_async.tail, tail, __ATOMIC_RELEASE);
+			continue;
+		}
+
+		const struct log_record *record = log_async_record(offset);
+
+		if (record->level != LOG_RECORD_PADDING) {
+			log_write(record->level, record->count, record->time, record->file,
+				record->line, record->function, record->string);
+			__atomic_add_fetch(&log_async.written, 1, __ATOMIC_RELAXED);
+		}
+
+		tail += record->size;
+		__atomic_store_n(&log_async.tail, tail, __ATOMIC_RELEASE);
+	}
+
+	unsigned int dropped = __atomic_exchange_n(&log_async.dropped, 0, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&log_async.dropped_total, dropped, __ATOMIC_RELAXED);
+	if (dropped)
+		fprintf(log_output, "%s%u log messages dropped, log buffer full\n",
+			log_strings[LOG_LVL_WARNING + 1], dropped);
+
+	fflush(log_output);
+}
+
+static void *log_async_writer(void *arg)
+{
+	pthread_mutex_lock(&log_async.mutex);
+	while (!log_async.stop) {
+		struct timespec deadline;
+
+		pthread_mutex_unlock(&log_async.mutex);
+		log_async_drain();
+		pthread_mutex_lock(&log_async.mutex);
+
+		if (log_async.stop)
+			break;
+
+		int64_t wake = timeval_ms() + LOG_WRITER_INTERVAL;
+		deadline.tv_sec = wake / 1000;
+		deadline.tv_nsec = (wake % 1000) * 1000000;
+		pthread_cond_timedwait(&log_async.cond, &log_async.mutex, &deadline);
+	}
+	pthread_mutex_unlock(&log_async.mutex);
+
+	log_async_drain();
+
+	return NULL;
+}
+
+/* Copy a message into the ring buffer, returns false if it is full */
+static bool log_async_push(enum log_levels level, int64_t t, const char *file,
+	int line, const char *function, const char *string)
+{
+	size_t length = strlen(string) + 1;
+	size_t size = (sizeof(struct log_record) + length + LOG_RECORD_ALIGN - 1)
+		& ~(size_t)(LOG_RECORD_ALIGN - 1);
+	size_t head = log_async.head;
+	size_t tail = __atomic_load_n(&log_async.tail, __ATOMIC_ACQUIRE);
+	size_t offset = head % LOG_RING_SIZE;
+
+	/* records are contiguous, skip the end of the ring if needed */
+	size_t padding = offset + size > LOG_RING_SIZE ? LOG_RING_SIZE - offset : 0;
+
+	if (size > LOG_RING_SIZE / 2 || head + padding + size - tail > LOG_RING_SIZE) {
+		__atomic_add_fetch(&log_async.dropped, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	if (padding) {
+		/* the writer skips a tail too short for a record by itself */
+		if (padding >= sizeof(struct log_record)) {
+			struct log_record *pad = log_async_record(offset);
+			pad->size = padding;
+			pad->level = LOG_RECORD_PADDING;
+		}
+		head += padding;
+		offset = 0;
+	}
+
+	struct log_record *record = log_async_record(offset);
+	record->size = size;
+	record->level = level;
+	record->count = count;
+	record->time = t;
+	record->file = file;
+	record->line = line;
+	record->function = function;
+	memcpy(record->string, string, length);
+
+	__atomic_store_n(&log_async.head, head + size, __ATOMIC_RELEASE);
+
+	/* wake the writer early when the buffer fills up */
+	if (head + size - tail > LOG_RING_SIZE / 2)
+		pthread_cond_signal(&log_async.cond);
+
+	return true;
+}
+
+static void log_async_stop(void);
+
+static int log_async_start(void)
+{
+	static bool at_exit_registered;
+
+	if (log_async.running)
+		return ERROR_OK;
+
+	/* print pending messages before exiting */
+	if (!at_exit_registered) {
+		atexit(log_async_stop);
+		at_exit_registered = true;
+	}
+
+	log_async.ring = malloc(LOG_RING_SIZE);
+	if (!log_async.ring)
+		return ERROR_FAIL;
+
+	log_async.head = 0;
+	log_async.tail = 0;
+	log_async.stop = false;
+	pthread_mutex_init(&log_async.mutex, NULL);
+	pthread_cond_init(&log_async.cond, NULL);
+
+	if (pthread_create(&log_async.thread, NULL, log_async_writer, NULL)) {
+		pthread_cond_destroy(&log_async.cond);
+		pthread_mutex_destroy(&log_async.mutex);
+		free(log_async.ring);
+		log_async.ring = NULL;
+		return ERROR_FAIL;
+	}
+
+	log_async.running = true;
+	return ERROR_OK;
+}
+
+/* Stop the writer thread after it printed all pending messages */
+static void log_async_stop(void)
+{
+	if (!log_async.running)
+		return;
+
+	pthread_mutex_lock(&log_async.mutex);
+	log_async.stop = true;
+	pthread_cond_signal(&log_async.cond);
+	pthread_mutex_unlock(&log_async.mutex);
+
+	pthread_join(log_async.thread, NULL);
+	pthread_cond_destroy(&log_async.cond);
+	pthread_mutex_destroy(&log_async.mutex);
+	free(log_async.ring);
+	log_async.ring = NULL;
+	log_async.running = false;
+}
+#else
+static void log_async_stop(void)
+{
+}
+#endif
+
 /* forward the log to the listeners */
 static void log_forward(const char *file, unsigned line, const char *function, const char *string)
 {
@@ -91,52 +359,73 @@ static void log_puts(enum log_levels level,
 	const char *string)
 {
 	char *f;
-	if (level == LOG_LVL_OUTPUT) {
-		/* do not prepend any headers, just print out what we were given and return */
-		fputs(string, log_output);
-		fflush(log_output);
-		return;
-	}
+	int64_t t = 0;
+
+	if (level != LOG_LVL_OUTPUT) {
+		f = strrchr(file, '/');
+		if (f != NULL)
+			file = f + 1;
 
-	f = strrchr(file, '/');
-	if (f != NULL)
-		file = f + 1;
+		if (debug_level >= LOG_LVL_DEBUG)
+			t = timeval_ms() - start;
+	}
 
+	/* Empty strings are sent to log callbacks to keep e.g. gdbserver alive,
+	 * they are not logged. */
 	if (strlen(string) > 0) {
-		if (debug_level >= LOG_LVL_DEBUG) {
-			/* print with count and time information */
-			int64_t t = timeval_ms() - start;
-#ifdef _DEBUG_FREE_SPACE_
-			struct mallinfo info;
-			info = mallinfo();
-#endif
-			fprintf(log_output, "%s%d %" PRId64 " %s:%d %s()"
-#ifdef _DEBUG_FREE_SPACE_
-				" %d"
-#endif
-				": %s", log_strings[level + 1], count, t, file, line, function,
-#ifdef _DEBUG_FREE_SPACE_
-				info.fordblks,
+#ifdef LOG_ASYNC_SUPPORTED
+		if (log_async.running)
+			log_async_push(level, t, file, line, function, string);
+		else
 #endif
-				string);
-		} else {
-			/* if we are using gdb through pipes then we do not want any output
-			 * to the pipe otherwise we get repeated strings */
-			fprintf(log_output, "%s%s",
-				(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
+		{
+			log_write(level, count, t, file, line, function, string);
+			fflush(log_output);
 		}
-	} else {
-		/* Empty strings are sent to log callbacks to keep e.g. gdbserver alive, here we do
-		 *nothing. */
 	}
 
-	fflush(log_output);
+	/* do not forward plain output, it has no headers */
+	if (level == LOG_LVL_OUTPUT)
+		return;
 
 	/* Never forward LOG_LVL_DEBUG, too verbose and they can be found in the log if need be */
 	if (level <= LOG_LVL_INFO)
 		log_forward(file, line, function, string);
 }
 
+/* Format a message into buf if it fits, otherwise into an allocated
+ * string, and optionally append a newline.  The result must be freed if
+ * it is not buf. */
+static char *log_format(char *buf, size_t size, bool lf, const char *format,
+	va_list ap)
+{
+	va_list ap_copy;
+	char *string = buf;
+	int len;
+
+	/* keep one byte spare for the newline */
+	va_copy(ap_copy, ap);
+	len = vsnprintf(buf, size - 1, format, ap_copy);
+	va_end(ap_copy);
+
+	if (len < 0)
+		return NULL;
+
+	if ((size_t)len >= size - 1) {
+		/* alloc_vprintf() guarantees one spare byte as well */
+		string = alloc_vprintf(format, ap);
+		if (!string)
+			return NULL;
+	}
+
+	if (lf) {
+		string[len] = '\n';
+		string[len + 1] = '\0';
+	}
+
+	return string;
+}
+
 void log_printf(enum log_levels level,
 	const char *file,
 	unsigned line,
@@ -144,6 +433,7 @@ void log_printf(enum log_levels level,
 	const char *format,
 	...)
 {
+	char buf[LOG_INLINE_SIZE];
 	char *string;
 	va_list ap;
 
@@ -153,10 +443,11 @@ void log_printf(enum log_levels level,
 
 	va_start(ap, format);
 
-	string = alloc_vprintf(format, ap);
+	string = log_format(buf, sizeof(buf), false, format, ap);
 	if (string != NULL) {
 		log_puts(level, file, line, function, string);
-		free(string);
+		if (string != buf)
+			free(string);
 	}
 
 	va_end(ap);
@@ -165,6 +456,7 @@ void log_printf(enum log_levels level,
 void log_vprintf_lf(enum log_levels level, const char *file, unsigned line,
 		const char *function, const char *format, va_list args)
 {
+	char buf[LOG_INLINE_SIZE];
 	char *tmp;
 
 	count++;
@@ -172,18 +464,13 @@ void log_vprintf_lf(enum log_levels level, const char *file, unsigned line,
 	if (level > debug_level)
 		return;
 
-	tmp = alloc_vprintf(format, args);
-
+	tmp = log_format(buf, sizeof(buf), true, format, args);
 	if (!tmp)
 		return;
 
-	/*
-	 * Note: alloc_vprintf() guarantees that the buffer is at least one
-	 * character longer.
-	 */
-	strcat(tmp, "\n");
 	log_puts(level, file, line, function, tmp);
-	free(tmp);
+	if (tmp != buf)
+		free(tmp);
 }
 
 void log_printf_lf(enum log_levels level,
@@ -226,14 +513,53 @@ COMMAND_HANDLER(handle_log_output_command)
 			LOG_ERROR("failed to open output log '%s'", CMD_ARGV[0]);
 			return ERROR_FAIL;
 		}
+#ifdef LOG_ASYNC_SUPPORTED
+		/* the writer thread must not use the old file any more */
+		bool async = log_async.running;
+		log_async_stop();
+#endif
 		if (log_output != stderr && log_output != NULL) {
 			/* Close previous log file, if it was open and wasn't stderr. */
 			fclose(log_output);
 		}
 		log_output = file;
+#ifdef LOG_ASYNC_SUPPORTED
+		if (async && log_async_start() != ERROR_OK)
+			LOG_WARNING("failed to restart asynchronous logging");
+#endif
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_log_async_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+#ifdef LOG_ASYNC_SUPPORTED
+	if (CMD_ARGC == 1) {
+		bool enable;
+
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+		if (enable) {
+			if (log_async_start() != ERROR_OK) {
+				LOG_ERROR("failed to start the log writer thread");
+				return ERROR_FAIL;
+			}
+		} else
+			log_async_stop();
 	}
 
+	command_print(CMD, "asynchronous logging %s, %u messages written, %u dropped",
+		log_async.running ? "on" : "off",
+		__atomic_load_n(&log_async.written, __ATOMIC_RELAXED),
+		__atomic_load_n(&log_async.dropped_total, __ATOMIC_RELAXED));
 	return ERROR_OK;
+#else
+	command_print(CMD, "asynchronous logging is not supported by this build");
+	return CMD_ARGC ? ERROR_FAIL : ERROR_OK;
+#endif
 }
 
 static const struct command_registration log_command_handlers[] = {
@@ -244,6 +570,14 @@ static const struct command_registration log_command_handlers[] = {
 		.help = "redirect logging to a file (default: stderr)",
 		.usage = "file_name",
 	},
+	{
+		.name = "log_async",
+		.handler = handle_log_async_command,
+		.mode = COMMAND_ANY,
+		.help = "write the log from a separate thread, dropping "
+			"messages when it can not keep up",
+		.usage = "['on'|'off']",
+	},
 	{
 		.name = "debug_level",
 		.handler = handle_debug_level_command,
@@ -287,6 +621,7 @@ void log_init(void)
 
 int set_log_output(struct command_context *cmd_ctx, FILE *output)
 {
+	log_async_stop();
 	log_output = output;
 	return ERROR_OK;
 }
@@ -42,6 +42,8 @@ int timeval_compare(const struct timeval *x, const struct timeval *y);
 
 /** @returns gettimeofday() timeval as 64-bit in ms */
 int64_t timeval_ms(void);
+/** @returns @a tv as 64-bit in ms, in the same time base as timeval_ms() */
+int64_t timeval_to_ms(const struct timeval *tv);
 
 struct duration {
 	struct timeval start;
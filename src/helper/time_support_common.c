@@ -37,5 +37,10 @@ int64_t timeval_ms(void)
 	int retval = gettimeofday(&now, NULL);
 	if (retval < 0)
 		return retval;
-	return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+	return timeval_to_ms(&now);
+}
+
+int64_t timeval_to_ms(const struct timeval *tv)
+{
+	return (int64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
 }
@@ -33,16 +33,26 @@
 #include <jtag/jtag.h>
 #include "commands.h"
 
+/*
+ * Command queue memory is carved out of pages that are kept across
+ * queue flushes: jtag_command_queue_reset() only rewinds them, so a
+ * steady-state flush does not touch the heap at all.  Pages that are
+ * no longer needed can be released with jtag_command_queue_trim().
+ */
 struct cmd_queue_page {
 	struct cmd_queue_page *next;
 	void *address;
+	size_t size;
 	size_t used;
 };
 
 #define CMD_QUEUE_PAGE_SIZE (1024 * 1024)
 static struct cmd_queue_page *cmd_queue_pages;
+/* page currently being filled; pages after it are empty */
 static struct cmd_queue_page *cmd_queue_pages_tail;
 
+static struct jtag_command_queue_stats cmd_queue_stats;
+
 struct jtag_command *jtag_command_queue;
 static struct jtag_command **next_command_pointer = &jtag_command_queue;
 
@@ -60,10 +70,25 @@ void jtag_queue_command(struct jtag_command *cmd)
 	next_command_pointer = &cmd->next;
 }
 
+static struct cmd_queue_page *cmd_queue_page_new(size_t size)
+{
+	struct cmd_queue_page *page = malloc(sizeof(struct cmd_queue_page));
+	page->next = NULL;
+	page->size = (size < CMD_QUEUE_PAGE_SIZE) ? CMD_QUEUE_PAGE_SIZE : size;
+	page->address = malloc(page->size);
+	page->used = 0;
+
+	cmd_queue_stats.pages++;
+	cmd_queue_stats.bytes += page->size;
+	cmd_queue_stats.page_allocs++;
+
+	return page;
+}
+
 void *cmd_queue_alloc(size_t size)
 {
-	struct cmd_queue_page **p_page = &cmd_queue_pages;
-	int offset;
+	struct cmd_queue_page *page = cmd_queue_pages_tail;
+	size_t offset;
 	uint8_t *t;
 
 	/*
@@ -98,50 +123,82 @@ void *cmd_queue_alloc(size_t size)
 	size = (size + ALIGN_SIZE - 1) & (~(ALIGN_SIZE - 1));
 	/* Done... */
 
-	if (*p_page) {
-		p_page = &cmd_queue_pages_tail;
-		if (CMD_QUEUE_PAGE_SIZE - (*p_page)->used < size)
-			p_page = &((*p_page)->next);
+	if (!page) {
+		page = cmd_queue_page_new(size);
+		cmd_queue_pages = page;
+	} else if (page->size - page->used < size) {
+		/* move on to the next retained page, unless it is too small
+		 * for this request; then splice a fresh page in front of it */
+		struct cmd_queue_page *next = page->next;
+		if (!next || next->size < size) {
+			struct cmd_queue_page *fresh = cmd_queue_page_new(size);
+			fresh->next = next;
+			page->next = fresh;
+			next = fresh;
+		}
+		page = next;
 	}
+	cmd_queue_pages_tail = page;
 
-	if (!*p_page) {
-		*p_page = malloc(sizeof(struct cmd_queue_page));
-		(*p_page)->used = 0;
-		size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
-					CMD_QUEUE_PAGE_SIZE : size;
-		(*p_page)->address = malloc(alloc_size);
-		(*p_page)->next = NULL;
-		cmd_queue_pages_tail = *p_page;
-	}
+	offset = page->used;
+	page->used += size;
 
-	offset = (*p_page)->used;
-	(*p_page)->used += size;
+	cmd_queue_stats.used += size;
+	if (cmd_queue_stats.used > cmd_queue_stats.high_water)
+		cmd_queue_stats.high_water = cmd_queue_stats.used;
 
-	t = (*p_page)->address;
+	t = page->address;
 	return t + offset;
 }
 
-static void cmd_queue_free(void)
+void jtag_command_queue_reset(void)
 {
 	struct cmd_queue_page *page = cmd_queue_pages;
 
+	/* only pages up to the tail have been used since the last reset */
+	while (page) {
+		page->used = 0;
+		if (page == cmd_queue_pages_tail)
+			break;
+		page = page->next;
+	}
+
+	cmd_queue_pages_tail = cmd_queue_pages;
+	cmd_queue_stats.used = 0;
+	cmd_queue_stats.flushes++;
+
+	jtag_command_queue = NULL;
+	next_command_pointer = &jtag_command_queue;
+}
+
+void jtag_command_queue_trim(void)
+{
+	struct cmd_queue_page **p_page = &cmd_queue_pages;
+
+	/* keep the pages backing commands that are still queued */
+	if (cmd_queue_pages_tail && cmd_queue_pages_tail->used)
+		p_page = &cmd_queue_pages_tail->next;
+	else
+		cmd_queue_pages_tail = NULL;
+
+	struct cmd_queue_page *page = *p_page;
+	*p_page = NULL;
+
 	while (page) {
 		struct cmd_queue_page *last = page;
+		cmd_queue_stats.pages--;
+		cmd_queue_stats.bytes -= page->size;
 		free(page->address);
 		page = page->next;
 		free(last);
 	}
 
-	cmd_queue_pages = NULL;
-	cmd_queue_pages_tail = NULL;
+	cmd_queue_stats.high_water = cmd_queue_stats.used;
 }
 
-void jtag_command_queue_reset(void)
+void jtag_command_queue_get_stats(struct jtag_command_queue_stats *stats)
 {
-	cmd_queue_free();
-
-	jtag_command_queue = NULL;
-	next_command_pointer = &jtag_command_queue;
+	*stats = cmd_queue_stats;
 }
 
 /**
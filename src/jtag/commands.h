@@ -163,10 +163,30 @@ struct jtag_command {
 /** The current queue of jtag_command_s structures. */
 extern struct jtag_command *jtag_command_queue;
 
+/** Memory usage of the command queue, as reported by 'jtag queue_stats'. */
+struct jtag_command_queue_stats {
+	/** Number of pages currently retained. */
+	unsigned pages;
+	/** Total size of the retained pages. */
+	size_t bytes;
+	/** Bytes allocated by the commands currently queued. */
+	size_t used;
+	/** Largest number of bytes used by one queue since the last trim. */
+	size_t high_water;
+	/** Number of times the queue has been reset (flushed). */
+	uint64_t flushes;
+	/** Number of pages ever obtained from malloc(). */
+	uint64_t page_allocs;
+};
+
 void *cmd_queue_alloc(size_t size);
 
 void jtag_queue_command(struct jtag_command *cmd);
+/** Empty the queue; its pages are kept for reuse by the next one. */
 void jtag_command_queue_reset(void);
+/** Release all retained pages not used by currently queued commands. */
+void jtag_command_queue_trim(void);
+void jtag_command_queue_get_stats(struct jtag_command_queue_stats *stats);
 
 void jtag_scan_field_clone(struct scan_field *dst, const struct scan_field *src);
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
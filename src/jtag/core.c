@@ -31,6 +31,7 @@
 #endif
 
 #include "jtag.h"
+#include "commands.h"
 #include "swd.h"
 #include "interface.h"
 #include <transport/transport.h>
@@ -1550,6 +1551,9 @@ int adapter_quit(void)
 		t = n;
 	}
 
+	jtag_command_queue_reset();
+	jtag_command_queue_trim();
+
 	return ERROR_OK;
 }
 
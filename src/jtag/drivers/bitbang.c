@@ -200,25 +200,74 @@ static int bitbang_stableclocks(int num_cycles)
 	return ERROR_OK;
 }
 
-static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
+/* Number of scan bits handed to write_edges() at a time, a multiple of 8 */
+#define BITBANG_EDGES_CHUNK_BITS 4096
+
+/* For each TDI byte the 16 edges that shift it out, with and without
+ * TDO sampling on the falling edges. */
+static uint8_t bitbang_edge_table[2][256][16];
+static bool bitbang_edge_table_ready;
+
+static void bitbang_edge_table_init(void)
+{
+	for (unsigned sample = 0; sample < 2; sample++) {
+		for (unsigned byte = 0; byte < 256; byte++) {
+			uint8_t *edges = bitbang_edge_table[sample][byte];
+			for (unsigned i = 0; i < 8; i++) {
+				uint8_t tdi = (byte >> i) & 1 ? BITBANG_EDGE_TDI : 0;
+				edges[2 * i] = tdi | (sample ? BITBANG_EDGE_SAMPLE : 0);
+				edges[2 * i + 1] = tdi | BITBANG_EDGE_TCK;
+			}
+		}
+	}
+	bitbang_edge_table_ready = true;
+}
+
+static int bitbang_scan_edges(enum scan_type type, uint8_t *buffer,
 		unsigned scan_size)
 {
-	tap_state_t saved_end_state = tap_get_end_state();
-	unsigned bit_cnt;
+	static uint8_t edges[2 * BITBANG_EDGES_CHUNK_BITS];
+	static uint8_t tdo[BITBANG_EDGES_CHUNK_BITS / 8];
+	bool sample = type != SCAN_OUT;
 
-	if (!((!ir_scan &&
-			(tap_get_state() == TAP_DRSHIFT)) ||
-			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
-		if (ir_scan)
-			bitbang_end_state(TAP_IRSHIFT);
-		else
-			bitbang_end_state(TAP_DRSHIFT);
+	if (!bitbang_edge_table_ready)
+		bitbang_edge_table_init();
 
-		if (bitbang_state_move(0) != ERROR_OK)
+	for (unsigned offset = 0; offset < scan_size; offset += BITBANG_EDGES_CHUNK_BITS) {
+		unsigned num_bits = MIN(scan_size - offset, BITBANG_EDGES_CHUNK_BITS);
+		const uint8_t *in = buffer + offset / 8;
+
+		for (unsigned i = 0; i < DIV_ROUND_UP(num_bits, 8); i++)
+			memcpy(edges + 16 * i,
+					bitbang_edge_table[sample][type != SCAN_IN ? in[i] : 0], 16);
+
+		/* TMS goes high on the last bit to leave the shift state */
+		if (offset + num_bits == scan_size) {
+			edges[2 * num_bits - 2] |= BITBANG_EDGE_TMS;
+			edges[2 * num_bits - 1] |= BITBANG_EDGE_TMS;
+		}
+
+		if (bitbang_interface->write_edges(edges, 2 * num_bits, tdo) != ERROR_OK)
 			return ERROR_FAIL;
-		bitbang_end_state(saved_end_state);
+
+		if (sample) {
+			uint8_t *out = buffer + offset / 8;
+			memcpy(out, tdo, num_bits / 8);
+			if (num_bits % 8) {
+				uint8_t mask = (1 << (num_bits % 8)) - 1;
+				out[num_bits / 8] = (out[num_bits / 8] & ~mask) | (tdo[num_bits / 8] & mask);
+			}
+		}
 	}
 
+	return ERROR_OK;
+}
+
+static int bitbang_scan_bits(enum scan_type type, uint8_t *buffer,
+		unsigned scan_size)
+{
+	unsigned bit_cnt;
+
 	size_t buffered = 0;
 	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
 		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
@@ -278,6 +327,41 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		}
 	}
 
+	return ERROR_OK;
+}
+
+static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
+		unsigned scan_size)
+{
+	tap_state_t saved_end_state = tap_get_end_state();
+
+	if (!((!ir_scan &&
+			(tap_get_state() == TAP_DRSHIFT)) ||
+			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
+		if (ir_scan)
+			bitbang_end_state(TAP_IRSHIFT);
+		else
+			bitbang_end_state(TAP_DRSHIFT);
+
+		if (bitbang_state_move(0) != ERROR_OK)
+			return ERROR_FAIL;
+		bitbang_end_state(saved_end_state);
+	}
+
+	if (bitbang_interface->shift) {
+		/* TDO lands in the buffer by the time the queue is flushed */
+		if (bitbang_interface->shift(scan_size, NULL,
+					type != SCAN_IN ? buffer : NULL,
+					type != SCAN_OUT ? buffer : NULL) != ERROR_OK)
+			return ERROR_FAIL;
+	} else if (bitbang_interface->write_edges) {
+		if (bitbang_scan_edges(type, buffer, scan_size) != ERROR_OK)
+			return ERROR_FAIL;
+	} else {
+		if (bitbang_scan_bits(type, buffer, scan_size) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
 	if (tap_get_state() != tap_get_end_state()) {
 		/* we *KNOW* the above loop transitioned out of
 		 * the shift state, so we skip the first state
@@ -289,6 +373,27 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 	return ERROR_OK;
 }
 
+/* Scan buffers whose TDO bits arrive when the queue is flushed */
+struct bitbang_deferred_scan {
+	struct scan_command *scan;
+	uint8_t *buffer;
+};
+
+static int bitbang_complete_scans(struct bitbang_deferred_scan *scans,
+		unsigned count, bool flushed)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; i < count; i++) {
+		if (flushed && jtag_read_buffer(scans[i].buffer, scans[i].scan) != ERROR_OK)
+			retval = ERROR_JTAG_QUEUE_FAILED;
+		free(scans[i].buffer);
+	}
+	free(scans);
+
+	return retval;
+}
+
 int bitbang_execute_queue(void)
 {
 	struct jtag_command *cmd = jtag_command_queue;	/* currently processed command */
@@ -296,6 +401,8 @@ int bitbang_execute_queue(void)
 	enum scan_type type;
 	uint8_t *buffer;
 	int retval;
+	struct bitbang_deferred_scan *deferred = NULL;
+	unsigned deferred_count = 0;
 
 	if (!bitbang_interface) {
 		LOG_ERROR("BUG: Bitbang interface called, but not yet initialized");
@@ -323,7 +430,7 @@ int bitbang_execute_queue(void)
 					tap_set_state(TAP_RESET);
 				if (bitbang_interface->reset(cmd->cmd.reset->trst,
 							cmd->cmd.reset->srst) != ERROR_OK)
-					return ERROR_FAIL;
+					goto error;
 				break;
 			case JTAG_RUNTEST:
 				LOG_DEBUG_IO("runtest %i cycles, end in %s",
@@ -331,7 +438,7 @@ int bitbang_execute_queue(void)
 						tap_state_name(cmd->cmd.runtest->end_state));
 				bitbang_end_state(cmd->cmd.runtest->end_state);
 				if (bitbang_runtest(cmd->cmd.runtest->num_cycles) != ERROR_OK)
-					return ERROR_FAIL;
+					goto error;
 				break;
 
 			case JTAG_STABLECLOCKS:
@@ -339,7 +446,7 @@ int bitbang_execute_queue(void)
 				 * state was done in jtag_add_clocks()
 				 */
 				if (bitbang_stableclocks(cmd->cmd.stableclocks->num_cycles) != ERROR_OK)
-					return ERROR_FAIL;
+					goto error;
 				break;
 
 			case JTAG_TLR_RESET:
@@ -347,14 +454,14 @@ int bitbang_execute_queue(void)
 						tap_state_name(cmd->cmd.statemove->end_state));
 				bitbang_end_state(cmd->cmd.statemove->end_state);
 				if (bitbang_state_move(0) != ERROR_OK)
-					return ERROR_FAIL;
+					goto error;
 				break;
 			case JTAG_PATHMOVE:
 				LOG_DEBUG_IO("pathmove: %i states, end in %s",
 						cmd->cmd.pathmove->num_states,
 						tap_state_name(cmd->cmd.pathmove->path[cmd->cmd.pathmove->num_states - 1]));
 				if (bitbang_path_move(cmd->cmd.pathmove) != ERROR_OK)
-					return ERROR_FAIL;
+					goto error;
 				break;
 			case JTAG_SCAN:
 				bitbang_end_state(cmd->cmd.scan->end_state);
@@ -364,16 +471,37 @@ int bitbang_execute_queue(void)
 						scan_size,
 					tap_state_name(cmd->cmd.scan->end_state));
 				type = jtag_scan_type(cmd->cmd.scan);
+				if (bitbang_interface->shift) {
+					/* keep the buffer until the queue has been flushed */
+					struct bitbang_deferred_scan *d = realloc(deferred,
+							(deferred_count + 1) * sizeof(*deferred));
+					if (!d) {
+						LOG_ERROR("Out of memory");
+						free(buffer);
+						goto error;
+					}
+					deferred = d;
+					deferred[deferred_count].scan = cmd->cmd.scan;
+					deferred[deferred_count].buffer = buffer;
+					deferred_count++;
+				}
 				if (bitbang_scan(cmd->cmd.scan->ir_scan, type, buffer,
-							scan_size) != ERROR_OK)
-					return ERROR_FAIL;
-				if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
-					retval = ERROR_JTAG_QUEUE_FAILED;
-				if (buffer)
-					free(buffer);
+							scan_size) != ERROR_OK) {
+					if (!bitbang_interface->shift)
+						free(buffer);
+					goto error;
+				}
+				if (!bitbang_interface->shift) {
+					if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
+						retval = ERROR_JTAG_QUEUE_FAILED;
+					if (buffer)
+						free(buffer);
+				}
 				break;
 			case JTAG_SLEEP:
 				LOG_DEBUG_IO("sleep %" PRIi32, cmd->cmd.sleep->us);
+				if (bitbang_interface->flush && bitbang_interface->flush() != ERROR_OK)
+					goto error;
 				jtag_sleep(cmd->cmd.sleep->us);
 				break;
 			case JTAG_TMS:
@@ -387,10 +515,22 @@ int bitbang_execute_queue(void)
 	}
 	if (bitbang_interface->blink) {
 		if (bitbang_interface->blink(0) != ERROR_OK)
-			return ERROR_FAIL;
+			goto error;
+	}
+
+	if (bitbang_interface->flush) {
+		if (bitbang_interface->flush() != ERROR_OK)
+			goto error;
 	}
 
+	if (bitbang_complete_scans(deferred, deferred_count, true) != ERROR_OK)
+		retval = ERROR_JTAG_QUEUE_FAILED;
+
 	return retval;
+
+error:
+	bitbang_complete_scans(deferred, deferred_count, false);
+	return ERROR_FAIL;
 }
 
 
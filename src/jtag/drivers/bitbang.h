@@ -30,6 +30,13 @@ typedef enum {
 	BB_ERROR
 } bb_value_t;
 
+/* Lines set by an entry of the vector passed to write_edges() */
+#define BITBANG_EDGE_TDI	0x01
+#define BITBANG_EDGE_TMS	0x02
+#define BITBANG_EDGE_TCK	0x04
+/* Sample TDO after setting the lines of this entry */
+#define BITBANG_EDGE_SAMPLE	0x08
+
 /** Low level callbacks (for bitbang).
  *
  * Either read(), or sample() and read_sample() must be implemented.
@@ -55,6 +62,24 @@ struct bitbang_interface {
 	int (*blink)(int on);
 	int (*swdio_read)(void);
 	void (*swdio_drive)(bool on);
+
+	/** Optional: clock num_bits TCK cycles in one go.  Each cycle drives TCK
+	 * low with the next TMS and TDI bit, samples TDO and drives TCK high.
+	 * Bits are packed LSB first.  If tms is NULL, TMS is low except on the
+	 * last cycle; if tdi is NULL, TDI is low.  The TDO bits are stored in tdo
+	 * (unless it is NULL) at the latest by the next flush(), and tms and tdi
+	 * must stay valid until then, too.  Requires flush(). */
+	int (*shift)(unsigned num_bits, const uint8_t *tms, const uint8_t *tdi,
+			uint8_t *tdo);
+	/** Optional: set TCK, TMS and TDI for each of num_edges entries of
+	 * edges, as write() would, and sample TDO after each entry that has
+	 * BITBANG_EDGE_SAMPLE set.  The samples are packed LSB first into tdo
+	 * before returning. */
+	int (*write_edges)(const uint8_t *edges, unsigned num_edges, uint8_t *tdo);
+
+	/** Optional: send any buffered output and complete outstanding reads.
+	 * Called at the end of each queue and before sleeping. */
+	int (*flush)(void);
 };
 
 const struct swd_driver bitbang_swd;
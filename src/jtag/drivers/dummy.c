@@ -72,6 +72,25 @@ static int dummy_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+static int dummy_write_edges(const uint8_t *edges, unsigned num_edges, uint8_t *tdo)
+{
+	unsigned sampled = 0;
+
+	for (unsigned i = 0; i < num_edges; i++) {
+		dummy_write(!!(edges[i] & BITBANG_EDGE_TCK), !!(edges[i] & BITBANG_EDGE_TMS),
+				!!(edges[i] & BITBANG_EDGE_TDI));
+
+		if (edges[i] & BITBANG_EDGE_SAMPLE) {
+			if (dummy_read() == BB_HIGH)
+				tdo[sampled / 8] |= 1 << (sampled % 8);
+			else
+				tdo[sampled / 8] &= ~(1 << (sampled % 8));
+			sampled++;
+		}
+	}
+	return ERROR_OK;
+}
+
 static int dummy_reset(int trst, int srst)
 {
 	dummy_clock = 0;
@@ -91,6 +110,7 @@ static int dummy_led(int on)
 static struct bitbang_interface dummy_bitbang = {
 		.read = &dummy_read,
 		.write = &dummy_write,
+		.write_edges = &dummy_write_edges,
 		.reset = &dummy_reset,
 		.blink = &dummy_led,
 	};
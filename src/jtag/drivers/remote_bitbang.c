@@ -22,64 +22,368 @@
 
 #ifndef _WIN32
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <netdb.h>
+#include <poll.h>
 #endif
 #include <jtag/interface.h>
+#include <jtag/swd.h>
+#include <target/arm_adi_v5.h>
 #include "bitbang.h"
 
 /* arbitrary limit on host name length: */
 #define REMOTE_BITBANG_HOST_MAX 255
 
+/* Protocol extension advertised by the remote process in reply to 'V':
+ * 1 adds the bulk JTAG shift request 'J'. */
+#define REMOTE_BITBANG_VERSION_BULK 1
+
+/* Flags of the 'J' request */
+#define REMOTE_BITBANG_BULK_CAPTURE	0x01	/* TDO is sent back */
+#define REMOTE_BITBANG_BULK_TMS_EXIT	0x02	/* no TMS bits, TMS is high on the last cycle only */
+
+/* Send the staged requests once this much has accumulated */
+#define REMOTE_BITBANG_SEND_THRESHOLD (64 * 1024)
+
+/* Give up when the remote side makes no progress for this long */
+#define REMOTE_BITBANG_TIMEOUT_MS 10000
+
 static char *remote_bitbang_host;
 static char *remote_bitbang_port;
 
-static FILE *remote_bitbang_file;
 static int remote_bitbang_fd;
+static int remote_bitbang_version;
+
+/* Number of response bytes that may be outstanding before the staged
+ * requests are sent and the responses collected. */
+static size_t remote_bitbang_read_ahead = 4096;
+
+/*
+ * Requests are staged and sent with one writev() per flush.  Small
+ * requests are copied into remote_bitbang_send_buf; bulk TDI/TMS data is
+ * referenced in place, the bitbang core keeps it alive until the flush.
+ */
+struct remote_bitbang_segment {
+	const uint8_t *data;	/* NULL: data is in remote_bitbang_send_buf */
+	size_t offset;
+	size_t len;
+};
+
+static uint8_t *remote_bitbang_send_buf;
+static size_t remote_bitbang_send_len;
+static size_t remote_bitbang_send_size;
+static struct remote_bitbang_segment *remote_bitbang_segments;
+static unsigned remote_bitbang_segment_count;
+static unsigned remote_bitbang_segment_size;
+static size_t remote_bitbang_staged;
 
-/* Circular buffer. When start == end, the buffer is empty. */
-static char remote_bitbang_buf[64];
+/*
+ * Responses still expected from the remote process, in request order.
+ * Bulk TDO data is read straight into its destination; single samples
+ * (dest == NULL) go to the sample buffer below.
+ */
+struct remote_bitbang_reply {
+	uint8_t *dest;
+	size_t len;
+};
+
+static struct remote_bitbang_reply *remote_bitbang_replies;
+static unsigned remote_bitbang_reply_head;
+static unsigned remote_bitbang_reply_count;
+static unsigned remote_bitbang_reply_size;
+static size_t remote_bitbang_reply_bytes;
+
+/* Circular buffer of samples. When start == end, the buffer is empty. */
+static char *remote_bitbang_buf;
+static size_t remote_bitbang_buf_size;
 static unsigned remote_bitbang_start;
 static unsigned remote_bitbang_end;
 
-static int remote_bitbang_buf_full(void)
+/*
+ * SWD transactions are queued like the JTAG scans: the requests of a whole
+ * queue are sent in one go, and the acknowledgements (and read data) are
+ * collected and checked by remote_bitbang_swd_run_queue().
+ */
+#define REMOTE_BITBANG_SWD_RESPONSE_BITS (1 + 3 + 32 + 1 + 1)
+
+static struct remote_bitbang_swd_cmd {
+	uint8_t cmd;
+	uint32_t *dst;
+	/* sampled SWDIO, one ASCII digit per cycle: trn, ack, data, parity, trn */
+	char response[REMOTE_BITBANG_SWD_RESPONSE_BITS];
+} *remote_bitbang_swd_queue;
+static size_t remote_bitbang_swd_queue_length;
+static size_t remote_bitbang_swd_queue_alloced;
+static int remote_bitbang_swd_retval;
+
+static int remote_bitbang_stage(const uint8_t *data, size_t len, bool copy)
 {
-	return remote_bitbang_end ==
-		((remote_bitbang_start + sizeof(remote_bitbang_buf) - 1) %
-		 sizeof(remote_bitbang_buf));
+	if (!len)
+		return ERROR_OK;
+
+	struct remote_bitbang_segment *last = remote_bitbang_segment_count ?
+		&remote_bitbang_segments[remote_bitbang_segment_count - 1] : NULL;
+
+	if (copy) {
+		if (remote_bitbang_send_len + len > remote_bitbang_send_size) {
+			size_t size = remote_bitbang_send_size * 2;
+			while (size < remote_bitbang_send_len + len)
+				size *= 2;
+			uint8_t *buf = realloc(remote_bitbang_send_buf, size);
+			if (!buf) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+			remote_bitbang_send_buf = buf;
+			remote_bitbang_send_size = size;
+		}
+		memcpy(remote_bitbang_send_buf + remote_bitbang_send_len, data, len);
+
+		/* append to the previous segment if that is staged data, too */
+		if (last && !last->data &&
+				last->offset + last->len == remote_bitbang_send_len) {
+			last->len += len;
+			remote_bitbang_send_len += len;
+			remote_bitbang_staged += len;
+			return ERROR_OK;
+		}
+	}
+
+	if (remote_bitbang_segment_count == remote_bitbang_segment_size) {
+		unsigned size = remote_bitbang_segment_size * 2;
+		struct remote_bitbang_segment *segments = realloc(remote_bitbang_segments,
+				size * sizeof(*segments));
+		if (!segments) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		remote_bitbang_segments = segments;
+		remote_bitbang_segment_size = size;
+	}
+
+	struct remote_bitbang_segment *seg =
+		&remote_bitbang_segments[remote_bitbang_segment_count++];
+	seg->len = len;
+	if (copy) {
+		seg->data = NULL;
+		seg->offset = remote_bitbang_send_len;
+		remote_bitbang_send_len += len;
+	} else {
+		seg->data = data;
+		seg->offset = 0;
+	}
+	remote_bitbang_staged += len;
+
+	return ERROR_OK;
 }
 
-/* Read any incoming data, placing it into the buffer. */
-static int remote_bitbang_fill_buf(void)
+static int remote_bitbang_expect(uint8_t *dest, size_t len)
 {
-	socket_nonblock(remote_bitbang_fd);
-	while (!remote_bitbang_buf_full()) {
-		unsigned contiguous_available_space;
+	/* consecutive samples share one entry */
+	if (!dest && remote_bitbang_reply_count) {
+		struct remote_bitbang_reply *last = &remote_bitbang_replies[
+			(remote_bitbang_reply_head + remote_bitbang_reply_count - 1) %
+			remote_bitbang_reply_size];
+		if (!last->dest) {
+			last->len += len;
+			remote_bitbang_reply_bytes += len;
+			return ERROR_OK;
+		}
+	}
+
+	if (remote_bitbang_reply_count == remote_bitbang_reply_size) {
+		unsigned size = remote_bitbang_reply_size * 2;
+		struct remote_bitbang_reply *replies = malloc(size * sizeof(*replies));
+		if (!replies) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		for (unsigned i = 0; i < remote_bitbang_reply_count; i++)
+			replies[i] = remote_bitbang_replies[(remote_bitbang_reply_head + i) %
+				remote_bitbang_reply_size];
+		free(remote_bitbang_replies);
+		remote_bitbang_replies = replies;
+		remote_bitbang_reply_head = 0;
+		remote_bitbang_reply_size = size;
+	}
+
+	struct remote_bitbang_reply *reply = &remote_bitbang_replies[
+		(remote_bitbang_reply_head + remote_bitbang_reply_count) %
+		remote_bitbang_reply_size];
+	reply->dest = dest;
+	reply->len = len;
+	remote_bitbang_reply_count++;
+	remote_bitbang_reply_bytes += len;
+
+	return ERROR_OK;
+}
+
+/* There is a response to wait for, and room for it.  Samples can't be
+ * received while the sample buffer is full; they are read once the
+ * buffered ones have been consumed. */
+static bool remote_bitbang_can_receive(void)
+{
+	if (!remote_bitbang_reply_count)
+		return false;
+	if (remote_bitbang_replies[remote_bitbang_reply_head].dest)
+		return true;
+	return (remote_bitbang_end + 1) % remote_bitbang_buf_size != remote_bitbang_start;
+}
+
+/* Read responses that have arrived (but no more than expected). */
+static int remote_bitbang_receive(void)
+{
+	struct remote_bitbang_reply *reply = &remote_bitbang_replies[remote_bitbang_reply_head];
+	void *dest;
+	size_t len;
+
+	if (reply->dest) {
+		dest = reply->dest;
+		len = reply->len;
+	} else {
+		/* contiguous free space in the sample buffer */
 		if (remote_bitbang_end >= remote_bitbang_start) {
-			contiguous_available_space = sizeof(remote_bitbang_buf) -
-				remote_bitbang_end;
+			len = remote_bitbang_buf_size - remote_bitbang_end;
 			if (remote_bitbang_start == 0)
-				contiguous_available_space -= 1;
+				len -= 1;
 		} else {
-			contiguous_available_space = remote_bitbang_start -
-				remote_bitbang_end - 1;
+			len = remote_bitbang_start - remote_bitbang_end - 1;
 		}
-		ssize_t count = read(remote_bitbang_fd,
-				remote_bitbang_buf + remote_bitbang_end,
-				contiguous_available_space);
-		if (count > 0) {
-			remote_bitbang_end += count;
-			if (remote_bitbang_end == sizeof(remote_bitbang_buf))
-				remote_bitbang_end = 0;
-		} else if (count == 0) {
+		if (len > reply->len)
+			len = reply->len;
+		dest = remote_bitbang_buf + remote_bitbang_end;
+	}
+
+	/* a read of 0 bytes would look like a closed connection */
+	if (len == 0)
+		return ERROR_OK;
+
+	ssize_t count = read(remote_bitbang_fd, dest, len);
+	if (count == 0) {
+		LOG_ERROR("remote_bitbang: connection closed by the remote side");
+		return ERROR_FAIL;
+	} else if (count < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return ERROR_OK;
+		LOG_ERROR("remote_bitbang: read: %s (%d)", strerror(errno), errno);
+		return ERROR_FAIL;
+	}
+
+	if (reply->dest) {
+		reply->dest += count;
+	} else {
+		remote_bitbang_end += count;
+		if (remote_bitbang_end == remote_bitbang_buf_size)
+			remote_bitbang_end = 0;
+	}
+
+	reply->len -= count;
+	remote_bitbang_reply_bytes -= count;
+	if (!reply->len) {
+		remote_bitbang_reply_head = (remote_bitbang_reply_head + 1) % remote_bitbang_reply_size;
+		remote_bitbang_reply_count--;
+	}
+
+	return ERROR_OK;
+}
+
+static int remote_bitbang_send(void)
+{
+	struct iovec iov[64];
+	int iovcnt = 0;
+
+	for (unsigned i = 0; i < remote_bitbang_segment_count && iovcnt < (int)ARRAY_SIZE(iov); i++) {
+		struct remote_bitbang_segment *seg = &remote_bitbang_segments[i];
+		iov[iovcnt].iov_base = (void *)(seg->data ? seg->data :
+				remote_bitbang_send_buf + seg->offset);
+		iov[iovcnt].iov_len = seg->len;
+		iovcnt++;
+	}
+
+	ssize_t count = writev(remote_bitbang_fd, iov, iovcnt);
+	if (count < 0) {
+		if (errno == EAGAIN || errno == EINTR)
 			return ERROR_OK;
-		} else if (count < 0) {
-			if (errno == EAGAIN) {
-				return ERROR_OK;
-			} else {
-				LOG_ERROR("remote_bitbang_fill_buf: %s (%d)",
-						strerror(errno), errno);
+		LOG_ERROR("remote_bitbang: writev: %s (%d)", strerror(errno), errno);
+		return ERROR_FAIL;
+	}
+
+	/* drop what has been sent */
+	unsigned done = 0;
+	remote_bitbang_staged -= count;
+	while (count > 0) {
+		struct remote_bitbang_segment *seg = &remote_bitbang_segments[done];
+		if ((size_t)count < seg->len) {
+			if (seg->data)
+				seg->data += count;
+			else
+				seg->offset += count;
+			seg->len -= count;
+			break;
+		}
+		count -= seg->len;
+		done++;
+	}
+	remote_bitbang_segment_count -= done;
+	memmove(remote_bitbang_segments, remote_bitbang_segments + done,
+			remote_bitbang_segment_count * sizeof(*remote_bitbang_segments));
+	if (!remote_bitbang_segment_count)
+		remote_bitbang_send_len = 0;
+
+	return ERROR_OK;
+}
+
+/* Forget everything staged and every outstanding response, after the
+ * connection failed and nothing more can be received into the buffers. */
+static void remote_bitbang_discard(void)
+{
+	remote_bitbang_segment_count = 0;
+	remote_bitbang_send_len = 0;
+	remote_bitbang_staged = 0;
+	remote_bitbang_reply_head = 0;
+	remote_bitbang_reply_count = 0;
+	remote_bitbang_reply_bytes = 0;
+}
+
+/* Send all staged requests and collect all outstanding responses.  Both
+ * directions are served together, so the remote side never blocks on a
+ * full socket while we are still writing. */
+static int remote_bitbang_flush(void)
+{
+	while (remote_bitbang_staged || remote_bitbang_can_receive()) {
+		bool receive = remote_bitbang_can_receive();
+		struct pollfd pfd;
+		pfd.fd = remote_bitbang_fd;
+		pfd.events = 0;
+		if (remote_bitbang_staged)
+			pfd.events |= POLLOUT;
+		if (receive)
+			pfd.events |= POLLIN;
+
+		int ret = poll(&pfd, 1, REMOTE_BITBANG_TIMEOUT_MS);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_ERROR("remote_bitbang: poll: %s (%d)", strerror(errno), errno);
+			return ERROR_FAIL;
+		}
+		if (ret == 0) {
+			LOG_ERROR("remote_bitbang: remote side did not respond within %d ms",
+					REMOTE_BITBANG_TIMEOUT_MS);
+			return ERROR_FAIL;
+		}
+
+		if (receive && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+			if (remote_bitbang_receive() != ERROR_OK)
+				return ERROR_FAIL;
+		} else if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+			LOG_ERROR("remote_bitbang: connection lost");
+			return ERROR_FAIL;
+		}
+
+		if (remote_bitbang_staged && (pfd.revents & POLLOUT)) {
+			if (remote_bitbang_send() != ERROR_OK)
 				return ERROR_FAIL;
-			}
 		}
 	}
 
@@ -88,37 +392,49 @@ static int remote_bitbang_fill_buf(void)
 
 static int remote_bitbang_putc(int c)
 {
-	if (EOF == fputc(c, remote_bitbang_file)) {
-		LOG_ERROR("remote_bitbang_putc: %s", strerror(errno));
+	uint8_t byte = c;
+
+	if (remote_bitbang_stage(&byte, 1, true) != ERROR_OK)
 		return ERROR_FAIL;
-	}
+
+	if (remote_bitbang_staged >= REMOTE_BITBANG_SEND_THRESHOLD)
+		return remote_bitbang_flush();
+
 	return ERROR_OK;
 }
 
 static int remote_bitbang_quit(void)
 {
-	if (EOF == fputc('Q', remote_bitbang_file)) {
-		LOG_ERROR("fputs: %s", strerror(errno));
-		return ERROR_FAIL;
-	}
+	int retval = ERROR_OK;
 
-	if (EOF == fflush(remote_bitbang_file)) {
-		LOG_ERROR("fflush: %s", strerror(errno));
-		return ERROR_FAIL;
-	}
+	if (remote_bitbang_fd >= 0) {
+		if (remote_bitbang_putc('Q') != ERROR_OK ||
+				remote_bitbang_flush() != ERROR_OK)
+			retval = ERROR_FAIL;
 
-	/* We only need to close one of the FILE*s, because they both use the same */
-	/* underlying file descriptor. */
-	if (EOF == fclose(remote_bitbang_file)) {
-		LOG_ERROR("fclose: %s", strerror(errno));
-		return ERROR_FAIL;
+		if (close(remote_bitbang_fd) != 0) {
+			LOG_ERROR("close: %s", strerror(errno));
+			retval = ERROR_FAIL;
+		}
+		remote_bitbang_fd = -1;
 	}
 
+	free(remote_bitbang_send_buf);
+	remote_bitbang_send_buf = NULL;
+	free(remote_bitbang_segments);
+	remote_bitbang_segments = NULL;
+	free(remote_bitbang_replies);
+	remote_bitbang_replies = NULL;
+	free(remote_bitbang_buf);
+	remote_bitbang_buf = NULL;
+	free(remote_bitbang_swd_queue);
+	remote_bitbang_swd_queue = NULL;
+
 	free(remote_bitbang_host);
 	free(remote_bitbang_port);
 
 	LOG_INFO("remote_bitbang interface quit");
-	return ERROR_OK;
+	return retval;
 }
 
 static bb_value_t char_to_int(int c)
@@ -129,51 +445,32 @@ static bb_value_t char_to_int(int c)
 		case '1':
 			return BB_HIGH;
 		default:
-			remote_bitbang_quit();
 			LOG_ERROR("remote_bitbang: invalid read response: %c(%i)", c, c);
 			return BB_ERROR;
 	}
 }
 
-/* Get the next read response. */
-static bb_value_t remote_bitbang_rread(void)
-{
-	if (EOF == fflush(remote_bitbang_file)) {
-		remote_bitbang_quit();
-		LOG_ERROR("fflush: %s", strerror(errno));
-		return BB_ERROR;
-	}
-
-	/* Enable blocking access. */
-	socket_block(remote_bitbang_fd);
-	char c;
-	ssize_t count = read(remote_bitbang_fd, &c, 1);
-	if (count == 1) {
-		return char_to_int(c);
-	} else {
-		remote_bitbang_quit();
-		LOG_ERROR("read: count=%d, error=%s", (int) count, strerror(errno));
-		return BB_ERROR;
-	}
-}
-
 static int remote_bitbang_sample(void)
 {
-	if (remote_bitbang_fill_buf() != ERROR_OK)
+	if (remote_bitbang_expect(NULL, 1) != ERROR_OK)
 		return ERROR_FAIL;
-	assert(!remote_bitbang_buf_full());
 	return remote_bitbang_putc('R');
 }
 
 static bb_value_t remote_bitbang_read_sample(void)
 {
-	if (remote_bitbang_start != remote_bitbang_end) {
-		int c = remote_bitbang_buf[remote_bitbang_start];
-		remote_bitbang_start =
-			(remote_bitbang_start + 1) % sizeof(remote_bitbang_buf);
-		return char_to_int(c);
+	if (remote_bitbang_start == remote_bitbang_end) {
+		if (remote_bitbang_flush() != ERROR_OK)
+			return BB_ERROR;
+		if (remote_bitbang_start == remote_bitbang_end) {
+			LOG_ERROR("remote_bitbang: no sample requested");
+			return BB_ERROR;
+		}
 	}
-	return remote_bitbang_rread();
+
+	int c = remote_bitbang_buf[remote_bitbang_start];
+	remote_bitbang_start = (remote_bitbang_start + 1) % remote_bitbang_buf_size;
+	return char_to_int(c);
 }
 
 static int remote_bitbang_write(int tck, int tms, int tdi)
@@ -194,15 +491,384 @@ static int remote_bitbang_blink(int on)
 	return remote_bitbang_putc(c);
 }
 
+static int remote_bitbang_write_edges(const uint8_t *edges, unsigned num_edges,
+		uint8_t *tdo)
+{
+	char request[512];
+	unsigned request_len = 0;
+	unsigned num_samples = 0;
+	unsigned sampled = 0;
+
+	for (unsigned i = 0; i < num_edges; i++) {
+		request[request_len++] = '0' + (edges[i] & (BITBANG_EDGE_TCK |
+					BITBANG_EDGE_TMS | BITBANG_EDGE_TDI));
+		if (edges[i] & BITBANG_EDGE_SAMPLE) {
+			request[request_len++] = 'R';
+			num_samples++;
+		}
+
+		/* the samples go to the sample buffer; collect them whenever it
+		 * is full and at the end of the vector */
+		bool last = i == num_edges - 1;
+		bool collect = num_samples && (last ||
+				num_samples == remote_bitbang_read_ahead);
+		if (request_len + 2 > sizeof(request) || collect || last) {
+			if (remote_bitbang_stage((uint8_t *)request, request_len, true) != ERROR_OK)
+				return ERROR_FAIL;
+			request_len = 0;
+		}
+		if (!collect)
+			continue;
+
+		if (remote_bitbang_expect(NULL, num_samples) != ERROR_OK ||
+				remote_bitbang_flush() != ERROR_OK)
+			return ERROR_FAIL;
+		for (; num_samples; num_samples--, sampled++) {
+			switch (remote_bitbang_read_sample()) {
+				case BB_LOW:
+					tdo[sampled / 8] &= ~(1 << (sampled % 8));
+					break;
+				case BB_HIGH:
+					tdo[sampled / 8] |= 1 << (sampled % 8);
+					break;
+				default:
+					return ERROR_FAIL;
+			}
+		}
+	}
+
+	if (remote_bitbang_staged >= REMOTE_BITBANG_SEND_THRESHOLD)
+		return remote_bitbang_flush();
+
+	return ERROR_OK;
+}
+
+static const uint8_t remote_bitbang_zeros[256];
+
+static int remote_bitbang_shift(unsigned num_bits, const uint8_t *tms,
+		const uint8_t *tdi, uint8_t *tdo)
+{
+	size_t num_bytes = DIV_ROUND_UP(num_bits, 8);
+
+	if (!num_bits)
+		return ERROR_OK;
+
+	/* keep the outstanding responses within the read-ahead window */
+	if (tdo && remote_bitbang_reply_bytes &&
+			remote_bitbang_reply_bytes + num_bytes > remote_bitbang_read_ahead) {
+		if (remote_bitbang_flush() != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	uint8_t header[6];
+	header[0] = 'J';
+	h_u32_to_le(header + 1, num_bits);
+	header[5] = (tdo ? REMOTE_BITBANG_BULK_CAPTURE : 0) |
+		(tms ? 0 : REMOTE_BITBANG_BULK_TMS_EXIT);
+	if (remote_bitbang_stage(header, sizeof(header), true) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (tms && remote_bitbang_stage(tms, num_bytes, false) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (tdi) {
+		/* TDO may arrive while TDI is still being sent; copy if they share a buffer */
+		if (remote_bitbang_stage(tdi, num_bytes, tdi == tdo) != ERROR_OK)
+			return ERROR_FAIL;
+	} else {
+		for (size_t i = 0; i < num_bytes; i += sizeof(remote_bitbang_zeros)) {
+			size_t len = MIN(num_bytes - i, sizeof(remote_bitbang_zeros));
+			if (remote_bitbang_stage(remote_bitbang_zeros, len, false) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+	}
+
+	if (tdo && remote_bitbang_expect(tdo, num_bytes) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (remote_bitbang_staged >= REMOTE_BITBANG_SEND_THRESHOLD)
+		return remote_bitbang_flush();
+
+	return ERROR_OK;
+}
+
+static int remote_bitbang_swd_drive(bool on)
+{
+	return remote_bitbang_putc(on ? 'O' : 'o');
+}
+
+/* Clock out bit_cnt bits of buf starting at offset, or low bits if buf is NULL */
+static int remote_bitbang_swd_write(const uint8_t *buf, unsigned offset, unsigned bit_cnt)
+{
+	for (unsigned i = offset; i < offset + bit_cnt; i++) {
+		int swdio = buf && (buf[i / 8] & (1 << (i % 8)));
+		if (remote_bitbang_putc('d' + swdio) != ERROR_OK ||
+				remote_bitbang_putc('f' + swdio) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+/* Clock in bit_cnt bits; the samples are stored in response by the next flush */
+static int remote_bitbang_swd_read(char *response, unsigned bit_cnt)
+{
+	if (remote_bitbang_reply_bytes &&
+			remote_bitbang_reply_bytes + bit_cnt > remote_bitbang_read_ahead) {
+		if (remote_bitbang_flush() != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	for (unsigned i = 0; i < bit_cnt; i++) {
+		if (remote_bitbang_putc('d') != ERROR_OK ||
+				remote_bitbang_putc('c') != ERROR_OK ||
+				remote_bitbang_putc('f') != ERROR_OK)
+			return ERROR_FAIL;
+	}
+	return remote_bitbang_expect((uint8_t *)response, bit_cnt);
+}
+
+static uint32_t remote_bitbang_swd_response_bits(const char *response,
+		unsigned offset, unsigned bit_cnt)
+{
+	uint32_t value = 0;
+	for (unsigned i = 0; i < bit_cnt; i++)
+		if (response[offset + i] == '1')
+			value |= 1u << i;
+	return value;
+}
+
+static int remote_bitbang_swd_init(void)
+{
+	remote_bitbang_swd_queue_alloced = 64;
+	remote_bitbang_swd_queue_length = 0;
+	remote_bitbang_swd_retval = ERROR_OK;
+	remote_bitbang_swd_queue = malloc(remote_bitbang_swd_queue_alloced *
+			sizeof(*remote_bitbang_swd_queue));
+	if (!remote_bitbang_swd_queue) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static int remote_bitbang_swd_switch_seq(enum swd_special_seq seq)
+{
+	const uint8_t *sequence;
+	unsigned len;
+
+	switch (seq) {
+	case LINE_RESET:
+		LOG_DEBUG("SWD line reset");
+		sequence = swd_seq_line_reset;
+		len = swd_seq_line_reset_len;
+		break;
+	case JTAG_TO_SWD:
+		LOG_DEBUG("JTAG-to-SWD");
+		sequence = swd_seq_jtag_to_swd;
+		len = swd_seq_jtag_to_swd_len;
+		break;
+	case SWD_TO_JTAG:
+		LOG_DEBUG("SWD-to-JTAG");
+		sequence = swd_seq_swd_to_jtag;
+		len = swd_seq_swd_to_jtag_len;
+		break;
+	default:
+		LOG_ERROR("Sequence %d not supported", seq);
+		return ERROR_FAIL;
+	}
+
+	if (remote_bitbang_swd_drive(true) != ERROR_OK ||
+			remote_bitbang_swd_write(sequence, 0, len) != ERROR_OK)
+		return ERROR_FAIL;
+
+	return remote_bitbang_flush();
+}
+
+static int remote_bitbang_swd_run_queue(void)
+{
+	LOG_DEBUG_IO("Executing %zu queued transactions", remote_bitbang_swd_queue_length);
+
+	if (remote_bitbang_swd_retval != ERROR_OK) {
+		LOG_DEBUG_IO("Skipping due to previous errors: %d", remote_bitbang_swd_retval);
+		goto skip;
+	}
+
+	/* A transaction must be followed by another transaction or at least 8 idle cycles to
+	 * ensure that data is clocked through the AP. */
+	if (remote_bitbang_swd_write(NULL, 0, 8) != ERROR_OK ||
+			remote_bitbang_flush() != ERROR_OK) {
+		remote_bitbang_discard();
+		remote_bitbang_swd_retval = ERROR_FAIL;
+		goto skip;
+	}
+
+	for (size_t i = 0; i < remote_bitbang_swd_queue_length; i++) {
+		struct remote_bitbang_swd_cmd *q = &remote_bitbang_swd_queue[i];
+		int ack = remote_bitbang_swd_response_bits(q->response, 1, 3);
+
+		LOG_DEBUG_IO("%s %s %s reg %X",
+				ack == SWD_ACK_OK ? "OK" : ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK",
+				q->cmd & SWD_CMD_APnDP ? "AP" : "DP",
+				q->cmd & SWD_CMD_RnW ? "read" : "write",
+				(q->cmd & SWD_CMD_A32) >> 1);
+
+		if (ack != SWD_ACK_OK) {
+			remote_bitbang_swd_retval = ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
+			goto skip;
+		} else if (q->cmd & SWD_CMD_RnW) {
+			uint32_t data = remote_bitbang_swd_response_bits(q->response, 1 + 3, 32);
+			int parity = remote_bitbang_swd_response_bits(q->response, 1 + 3 + 32, 1);
+
+			if (parity != parity_u32(data)) {
+				LOG_ERROR("SWD Read data parity mismatch");
+				remote_bitbang_swd_retval = ERROR_FAIL;
+				goto skip;
+			}
+
+			if (q->dst)
+				*q->dst = data;
+		}
+	}
+
+skip:
+	/* The responses of an aborted queue are still outstanding and point
+	 * into it; collect them (or drop them) before the queue is reused. */
+	if (remote_bitbang_reply_count && remote_bitbang_flush() != ERROR_OK) {
+		remote_bitbang_discard();
+		remote_bitbang_swd_retval = ERROR_FAIL;
+	}
+	remote_bitbang_swd_queue_length = 0;
+	int retval = remote_bitbang_swd_retval;
+	remote_bitbang_swd_retval = ERROR_OK;
+	return retval;
+}
+
+static void remote_bitbang_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data,
+		uint32_t ap_delay_clk)
+{
+	if (remote_bitbang_swd_queue_length >= remote_bitbang_swd_queue_alloced) {
+		/* The outstanding responses point into the queue, so run it
+		 * before growing it; that collects or drops all of them. */
+		remote_bitbang_swd_retval = remote_bitbang_swd_run_queue();
+		struct remote_bitbang_swd_cmd *q = realloc(remote_bitbang_swd_queue,
+				remote_bitbang_swd_queue_alloced * 2 * sizeof(*remote_bitbang_swd_queue));
+		if (q) {
+			remote_bitbang_swd_queue = q;
+			remote_bitbang_swd_queue_alloced *= 2;
+		}
+	}
+
+	if (remote_bitbang_swd_retval != ERROR_OK)
+		return;
+
+	struct remote_bitbang_swd_cmd *q =
+		&remote_bitbang_swd_queue[remote_bitbang_swd_queue_length++];
+	q->cmd = cmd | SWD_CMD_START | SWD_CMD_PARK;
+	q->dst = dst;
+
+	int retval = remote_bitbang_swd_write(&q->cmd, 0, 8);
+	if (retval == ERROR_OK)
+		retval = remote_bitbang_swd_drive(false);
+
+	if (q->cmd & SWD_CMD_RnW) {
+		if (retval == ERROR_OK)
+			retval = remote_bitbang_swd_read(q->response, REMOTE_BITBANG_SWD_RESPONSE_BITS);
+		if (retval == ERROR_OK)
+			retval = remote_bitbang_swd_drive(true);
+	} else {
+		uint8_t data_parity[DIV_ROUND_UP(32 + 1, 8)] = { 0 };
+		buf_set_u32(data_parity, 0, 32, data);
+		buf_set_u32(data_parity, 32, 1, parity_u32(data));
+
+		if (retval == ERROR_OK)
+			retval = remote_bitbang_swd_read(q->response, 1 + 3 + 1);
+		if (retval == ERROR_OK)
+			retval = remote_bitbang_swd_drive(true);
+		if (retval == ERROR_OK)
+			retval = remote_bitbang_swd_write(data_parity, 0, 32 + 1);
+	}
+
+	/* Insert idle cycles after AP accesses to avoid WAIT */
+	if (retval == ERROR_OK && (cmd & SWD_CMD_APnDP))
+		retval = remote_bitbang_swd_write(NULL, 0, ap_delay_clk);
+
+	if (retval != ERROR_OK)
+		remote_bitbang_swd_retval = retval;
+}
+
+static void remote_bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+{
+	assert(cmd & SWD_CMD_RnW);
+	remote_bitbang_swd_queue_cmd(cmd, value, 0, ap_delay_clk);
+}
+
+static void remote_bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+{
+	assert(!(cmd & SWD_CMD_RnW));
+	remote_bitbang_swd_queue_cmd(cmd, NULL, value, ap_delay_clk);
+}
+
+static const struct swd_driver remote_bitbang_swd = {
+	.init = remote_bitbang_swd_init,
+	.switch_seq = remote_bitbang_swd_switch_seq,
+	.read_reg = remote_bitbang_swd_read_reg,
+	.write_reg = remote_bitbang_swd_write_reg,
+	.run = remote_bitbang_swd_run_queue,
+};
+
 static struct bitbang_interface remote_bitbang_bitbang = {
-	.buf_size = sizeof(remote_bitbang_buf) - 1,
 	.sample = &remote_bitbang_sample,
 	.read_sample = &remote_bitbang_read_sample,
 	.write = &remote_bitbang_write,
 	.reset = &remote_bitbang_reset,
 	.blink = &remote_bitbang_blink,
+	.write_edges = &remote_bitbang_write_edges,
+	.flush = &remote_bitbang_flush,
 };
 
+static int remote_bitbang_receive_byte(void)
+{
+	if (remote_bitbang_expect(NULL, 1) != ERROR_OK ||
+			remote_bitbang_flush() != ERROR_OK)
+		return -1;
+
+	int c = remote_bitbang_buf[remote_bitbang_start];
+	remote_bitbang_start = (remote_bitbang_start + 1) % remote_bitbang_buf_size;
+	return c;
+}
+
+/* Ask for the protocol version.  'V' is followed by a plain read request:
+ * remote processes that do not know 'V' ignore it and only answer the
+ * read, newer ones answer 'V' and a version digit first. */
+static int remote_bitbang_negotiate(void)
+{
+	remote_bitbang_version = 0;
+
+	if (remote_bitbang_putc('V') != ERROR_OK ||
+			remote_bitbang_putc('R') != ERROR_OK)
+		return ERROR_FAIL;
+
+	int c = remote_bitbang_receive_byte();
+	if (c == 'V') {
+		c = remote_bitbang_receive_byte();
+		if (c < '1' || c > '9') {
+			LOG_ERROR("remote_bitbang: invalid version %c(%i)", c, c);
+			return ERROR_FAIL;
+		}
+		remote_bitbang_version = c - '0';
+		c = remote_bitbang_receive_byte();
+	}
+	if (c < 0 || char_to_int(c) == BB_ERROR)
+		return ERROR_FAIL;
+
+	LOG_INFO("remote_bitbang protocol version %d", remote_bitbang_version);
+
+	if (remote_bitbang_version >= REMOTE_BITBANG_VERSION_BULK)
+		remote_bitbang_bitbang.shift = &remote_bitbang_shift;
+
+	return ERROR_OK;
+}
+
 static int remote_bitbang_init_tcp(void)
 {
 	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
@@ -277,6 +943,30 @@ static int remote_bitbang_init(void)
 {
 	bitbang_interface = &remote_bitbang_bitbang;
 
+	remote_bitbang_send_size = 4096;
+	remote_bitbang_send_buf = malloc(remote_bitbang_send_size);
+	remote_bitbang_segment_size = 64;
+	remote_bitbang_segments = malloc(remote_bitbang_segment_size *
+			sizeof(*remote_bitbang_segments));
+	remote_bitbang_reply_size = 64;
+	remote_bitbang_replies = malloc(remote_bitbang_reply_size *
+			sizeof(*remote_bitbang_replies));
+	/* one slot of the circular buffer always stays empty */
+	remote_bitbang_buf_size = remote_bitbang_read_ahead + 1;
+	remote_bitbang_buf = malloc(remote_bitbang_buf_size);
+	if (!remote_bitbang_send_buf || !remote_bitbang_segments ||
+			!remote_bitbang_replies || !remote_bitbang_buf) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	remote_bitbang_bitbang.buf_size = remote_bitbang_read_ahead;
+
+	remote_bitbang_send_len = 0;
+	remote_bitbang_segment_count = 0;
+	remote_bitbang_staged = 0;
+	remote_bitbang_reply_head = 0;
+	remote_bitbang_reply_count = 0;
+	remote_bitbang_reply_bytes = 0;
 	remote_bitbang_start = 0;
 	remote_bitbang_end = 0;
 
@@ -289,10 +979,12 @@ static int remote_bitbang_init(void)
 	if (remote_bitbang_fd < 0)
 		return remote_bitbang_fd;
 
-	remote_bitbang_file = fdopen(remote_bitbang_fd, "w+");
-	if (remote_bitbang_file == NULL) {
-		LOG_ERROR("fdopen: failed to open write stream");
+	socket_nonblock(remote_bitbang_fd);
+
+	if (remote_bitbang_negotiate() != ERROR_OK) {
+		LOG_ERROR("remote_bitbang: no valid response from the remote side");
 		close(remote_bitbang_fd);
+		remote_bitbang_fd = -1;
 		return ERROR_FAIL;
 	}
 
@@ -312,6 +1004,19 @@ COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_port_command)
 	return ERROR_COMMAND_SYNTAX_ERROR;
 }
 
+COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_read_ahead_command)
+{
+	if (CMD_ARGC == 1) {
+		uint32_t size;
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], size);
+		if (size == 0)
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		remote_bitbang_read_ahead = size;
+		return ERROR_OK;
+	}
+	return ERROR_COMMAND_SYNTAX_ERROR;
+}
+
 COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_host_command)
 {
 	if (CMD_ARGC == 1) {
@@ -339,13 +1044,24 @@ static const struct command_registration remote_bitbang_command_handlers[] = {
 			"  if port is 0 or unset, this is the name of the unix socket to use.",
 		.usage = "host_name",
 	},
+	{
+		.name = "remote_bitbang_read_ahead",
+		.handler = remote_bitbang_handle_remote_bitbang_read_ahead_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the number of response bytes that may be outstanding\n"
+			"  before waiting for the remote jtag to answer.",
+		.usage = "bytes",
+	},
 	COMMAND_REGISTRATION_DONE,
 };
 
+static const char * const remote_bitbang_transports[] = { "jtag", "swd", NULL };
+
 struct jtag_interface remote_bitbang_interface = {
 	.name = "remote_bitbang",
 	.execute_queue = &bitbang_execute_queue,
-	.transports = jtag_only,
+	.transports = remote_bitbang_transports,
+	.swd = &remote_bitbang_swd,
 	.commands = remote_bitbang_command_handlers,
 	.init = &remote_bitbang_init,
 	.quit = &remote_bitbang_quit,
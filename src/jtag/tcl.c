@@ -31,6 +31,7 @@
 #endif
 
 #include "jtag.h"
+#include "commands.h"
 #include "swd.h"
 #include "minidriver.h"
 #include "interface.h"
@@ -854,6 +855,33 @@ COMMAND_HANDLER(handle_jtag_init_command)
 	return jtag_init(CMD_CTX);
 }
 
+COMMAND_HANDLER(handle_jtag_queue_stats_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct jtag_command_queue_stats stats;
+	jtag_command_queue_get_stats(&stats);
+
+	command_print(CMD, "pages: %u (%zu bytes)", stats.pages, stats.bytes);
+	command_print(CMD, "queued: %zu bytes, high-water: %zu bytes",
+			stats.used, stats.high_water);
+	command_print(CMD, "flushes: %" PRIu64 ", page allocations: %" PRIu64,
+			stats.flushes, stats.page_allocs);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_queue_trim_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	jtag_command_queue_trim();
+
+	return ERROR_OK;
+}
+
 static const struct command_registration jtag_subcommand_handlers[] = {
 	{
 		.name = "init",
@@ -936,6 +964,20 @@ static const struct command_registration jtag_subcommand_handlers[] = {
 		.jim_handler = jim_jtag_names,
 		.help = "Returns list of all JTAG tap names.",
 	},
+	{
+		.name = "queue_stats",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_queue_stats_command,
+		.help = "Report memory usage of the JTAG command queue.",
+		.usage = "",
+	},
+	{
+		.name = "queue_trim",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_queue_trim_command,
+		.help = "Release JTAG command queue pages not currently in use.",
+		.usage = "",
+	},
 	{
 		.chain = jtag_command_handlers_to_move,
 	},
@@ -313,15 +313,17 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 	uint32_t previous;
 	uint32_t older;
 
-	current = rlist;
 	previous = rlist;
+	retval = target_read_u32(rtos->target,
+							 rlist + signature->cf_off_newer, &current);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Could not read next ChibiOS thread");
+		return retval;
+	}
 	while (1) {
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_newer, &current);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read next ChibiOS thread");
-			return retval;
-		}
+		uint8_t older_buf[4];
+		uint8_t newer_buf[4];
+
 		/* Could be NULL if the kernel is not initialized yet or if the
 		 * registry is corrupted. */
 		if (current == 0) {
@@ -330,9 +332,15 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 			rtos_valid = 0;
 			break;
 		}
-		/* Fetch previous thread in the list as a integrity check. */
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_older, &older);
+		/* Fetch previous thread in the list as a integrity check, along
+		 * with the next one. */
+		struct target_memory_read link_reads[] = {
+			{ current + signature->cf_off_older, 4, older_buf },
+			{ current + signature->cf_off_newer, 4, newer_buf },
+		};
+		retval = target_read_memory_vector(rtos->target, link_reads,
+				ARRAY_SIZE(link_reads));
+		older = target_buffer_get_u32(rtos->target, older_buf);
 		if ((retval != ERROR_OK) || (older == 0) || (older != previous)) {
 			LOG_ERROR("ChibiOS registry integrity check failed, "
 						"double linked list violation");
@@ -344,6 +352,7 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 			break;
 		tasks_found++;
 		previous = current;
+		current = target_buffer_get_u32(rtos->target, newer_buf);
 	}
 	if (!rtos_valid) {
 		/* No RTOS, there is always at least the current execution, though */
@@ -382,16 +391,21 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 	rtos->thread_count = tasks_found;
 	/* Loop through linked list. */
 	struct thread_detail *curr_thrd_details = rtos->thread_details;
+	retval = target_read_u32(rtos->target,
+							 rlist + signature->cf_off_newer, &current);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Could not read next ChibiOS thread");
+		return -6;
+	}
 	while (curr_thrd_details < rtos->thread_details + tasks_found) {
 		uint32_t name_ptr = 0;
+		uint8_t name_ptr_buf[4];
+		uint8_t newer_buf[4];
 		char tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE];
 
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_newer, &current);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read next ChibiOS thread");
-			return -6;
-		}
+		/* State info */
+		uint8_t threadState;
+		const char *state_desc;
 
 		/* Check for full iteration of the linked list. */
 		if (current == rlist)
@@ -400,43 +414,43 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		/* Save the thread pointer */
 		curr_thrd_details->threadid = current;
 
-		/* read the name pointer */
-		retval = target_read_u32(rtos->target,
-								 current + signature->cf_off_name, &name_ptr);
+		/* read the name pointer, the state and the next thread */
+		struct target_memory_read thread_reads[] = {
+			{ current + signature->cf_off_name, 4, name_ptr_buf },
+			{ current + signature->cf_off_state, 1, &threadState },
+			{ current + signature->cf_off_newer, 4, newer_buf },
+		};
+		retval = target_read_memory_vector(rtos->target, thread_reads,
+				ARRAY_SIZE(thread_reads));
 		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read ChibiOS thread name pointer from target");
+			LOG_ERROR("Could not read ChibiOS thread from target");
 			return retval;
 		}
+		name_ptr = target_buffer_get_u32(rtos->target, name_ptr_buf);
+		curr_thrd_details->name_check = name_ptr;
+
+		/* Read the thread name, unless it is already known */
+		const char *cached_name = rtos_cached_thread_name(rtos, current, name_ptr);
+		if (cached_name) {
+			snprintf(tmp_str, sizeof(tmp_str), "%s", cached_name);
+		} else {
+			retval = target_read_buffer(rtos->target, name_ptr,
+										CHIBIOS_THREAD_NAME_STR_SIZE,
+										(uint8_t *)&tmp_str);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Error reading thread name from ChibiOS target");
+				return retval;
+			}
+			tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE - 1] = '\x00';
 
-		/* Read the thread name */
-		retval = target_read_buffer(rtos->target, name_ptr,
-									CHIBIOS_THREAD_NAME_STR_SIZE,
-									(uint8_t *)&tmp_str);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread name from ChibiOS target");
-			return retval;
+			if (tmp_str[0] == '\x00')
+				strcpy(tmp_str, "No Name");
 		}
-		tmp_str[CHIBIOS_THREAD_NAME_STR_SIZE - 1] = '\x00';
-
-		if (tmp_str[0] == '\x00')
-			strcpy(tmp_str, "No Name");
 
 		curr_thrd_details->thread_name_str = malloc(
 				strlen(tmp_str) + 1);
 		strcpy(curr_thrd_details->thread_name_str, tmp_str);
 
-		/* State info */
-		uint8_t threadState;
-		const char *state_desc;
-
-		retval = target_read_u8(rtos->target,
-								current + signature->cf_off_state, &threadState);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread state from ChibiOS target");
-			return retval;
-		}
-
-
 		if (threadState < CHIBIOS_NUM_STATES)
 			state_desc = ChibiOS_thread_states[threadState];
 		else
@@ -449,6 +463,7 @@ static int ChibiOS_update_threads(struct rtos *rtos)
 		curr_thrd_details->exists = true;
 
 		curr_thrd_details++;
+		current = target_buffer_get_u32(rtos->target, newer_buf);
 	}
 
 	uint32_t current_thrd;
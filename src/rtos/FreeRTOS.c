@@ -35,6 +35,9 @@
 
 #define FREERTOS_MAX_PRIORITIES	63
 
+/* Bytes of the thread name compared with the cached name */
+#define FREERTOS_THREAD_NAME_CHECK_SIZE	8
+
 #define FreeRTOS_STRUCT(int_type, ptr_type, list_prev_offset)
 
 struct FreeRTOS_params {
@@ -46,6 +49,7 @@ struct FreeRTOS_params {
 	const unsigned char list_elem_next_offset;
 	const unsigned char list_elem_content_offset;
 	const unsigned char thread_stack_offset;
+	const unsigned char thread_stack_base_offset;
 	const unsigned char thread_name_offset;
 	const struct rtos_register_stacking *stacking_info_cm3;
 	const struct rtos_register_stacking *stacking_info_cm4f;
@@ -62,6 +66,7 @@ static const struct FreeRTOS_params FreeRTOS_params_list[] = {
 	8,						/* list_elem_next_offset; */
 	12,						/* list_elem_content_offset */
 	0,						/* thread_stack_offset; */
+	48,						/* thread_stack_base_offset; */
 	52,						/* thread_name_offset; */
 	&rtos_standard_Cortex_M3_stacking,	/* stacking_info */
 	&rtos_standard_Cortex_M4F_stacking,
@@ -76,6 +81,7 @@ static const struct FreeRTOS_params FreeRTOS_params_list[] = {
 	8,						/* list_elem_next_offset; */
 	12,						/* list_elem_content_offset */
 	0,						/* thread_stack_offset; */
+	48,						/* thread_stack_base_offset; */
 	52,						/* thread_name_offset; */
 	&rtos_standard_Cortex_M3_stacking,	/* stacking_info */
 	&rtos_standard_Cortex_M4F_stacking,
@@ -90,6 +96,7 @@ static const struct FreeRTOS_params FreeRTOS_params_list[] = {
 	8,						/* list_elem_next_offset; */
 	12,						/* list_elem_content_offset */
 	0,						/* thread_stack_offset; */
+	48,						/* thread_stack_base_offset; */
 	52,						/* thread_name_offset; */
 	&rtos_standard_NDS32_N1068_stacking,	/* stacking_info */
 	&rtos_standard_Cortex_M4F_stacking,
@@ -177,11 +184,16 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		return -2;
 	}
 
+	/* read the thread count and the current thread in one go */
 	int thread_list_size = 0;
-	retval = target_read_buffer(rtos->target,
-			rtos->symbols[FreeRTOS_VAL_uxCurrentNumberOfTasks].address,
-			param->thread_count_width,
-			(uint8_t *)&thread_list_size);
+	int64_t current_thread = 0;
+	struct target_memory_read reads[] = {
+		{ rtos->symbols[FreeRTOS_VAL_uxCurrentNumberOfTasks].address,
+			param->thread_count_width, (uint8_t *)&thread_list_size },
+		{ rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
+			param->pointer_width, (uint8_t *)&current_thread },
+	};
+	retval = target_read_memory_vector(rtos->target, reads, ARRAY_SIZE(reads));
 	LOG_DEBUG("FreeRTOS: Read uxCurrentNumberOfTasks at 0x%" PRIx64 ", value %d\r\n",
 										rtos->symbols[FreeRTOS_VAL_uxCurrentNumberOfTasks].address,
 										thread_list_size);
@@ -194,15 +206,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 	/* wipe out previous thread details if any */
 	rtos_free_threadlist(rtos);
 
-	/* read the current thread */
-	retval = target_read_buffer(rtos->target,
-			rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
-			param->pointer_width,
-			(uint8_t *)&rtos->current_thread);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Error reading current thread in FreeRTOS thread list");
-		return retval;
-	}
+	rtos->current_thread = current_thread;
 	LOG_DEBUG("FreeRTOS: Read pxCurrentTCB at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
 										rtos->current_thread);
@@ -284,14 +288,20 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		if (list_of_lists[i] == 0)
 			continue;
 
-		/* Read the number of threads in this list */
+		/* Read the number of threads in this list and the location
+		 * of its first item */
 		int64_t list_thread_count = 0;
-		retval = target_read_buffer(rtos->target,
-				list_of_lists[i],
-				param->thread_count_width,
-				(uint8_t *)&list_thread_count);
+		uint64_t prev_list_elem_ptr = -1;
+		uint64_t list_elem_ptr = 0;
+		struct target_memory_read list_reads[] = {
+			{ list_of_lists[i], param->thread_count_width, (uint8_t *)&list_thread_count },
+			{ list_of_lists[i] + param->list_next_offset, param->pointer_width,
+				(uint8_t *)&list_elem_ptr },
+		};
+		retval = target_read_memory_vector(rtos->target, list_reads,
+				ARRAY_SIZE(list_reads));
 		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
+			LOG_ERROR("Error reading FreeRTOS thread list header");
 			free(list_of_lists);
 			return retval;
 		}
@@ -301,30 +311,24 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		if (list_thread_count == 0)
 			continue;
 
-		/* Read the location of first list item */
-		uint64_t prev_list_elem_ptr = -1;
-		uint64_t list_elem_ptr = 0;
-		retval = target_read_buffer(rtos->target,
-				list_of_lists[i] + param->list_next_offset,
-				param->pointer_width,
-				(uint8_t *)&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
 		LOG_DEBUG("FreeRTOS: Read first item for list %d at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
 
 		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
+			/* Get the location of the thread structure and of the
+			 * next list item. */
+			uint64_t next_list_elem_ptr = 0;
 			rtos->thread_details[tasks_found].threadid = 0;
-			retval = target_read_buffer(rtos->target,
-					list_elem_ptr + param->list_elem_content_offset,
-					param->pointer_width,
-					(uint8_t *)&(rtos->thread_details[tasks_found].threadid));
+			struct target_memory_read item_reads[] = {
+				{ list_elem_ptr + param->list_elem_content_offset, param->pointer_width,
+					(uint8_t *)&(rtos->thread_details[tasks_found].threadid) },
+				{ list_elem_ptr + param->list_elem_next_offset, param->pointer_width,
+					(uint8_t *)&next_list_elem_ptr },
+			};
+			retval = target_read_memory_vector(rtos->target, item_reads,
+					ARRAY_SIZE(item_reads));
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
 				free(list_of_lists);
@@ -339,23 +343,51 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
 			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
-			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
-					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
+			/* The stack base and the start of the name tell the thread
+			 * from an earlier one whose control block it reuses */
+			uint64_t stack_base = 0;
+			char name_start[FREERTOS_THREAD_NAME_CHECK_SIZE + 1] = { 0 };
+			struct target_memory_read tcb_reads[] = {
+				{ rtos->thread_details[tasks_found].threadid + param->thread_stack_base_offset,
+					param->pointer_width, (uint8_t *)&stack_base },
+				{ rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+					FREERTOS_THREAD_NAME_CHECK_SIZE, (uint8_t *)name_start },
+			};
+			retval = target_read_memory_vector(rtos->target, tcb_reads,
+					ARRAY_SIZE(tcb_reads));
 			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
+				LOG_ERROR("Error reading thread control block in FreeRTOS thread list");
 				free(list_of_lists);
 				return retval;
 			}
-			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
-			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value \"%s\"\r\n",
-										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-										tmp_str);
-
-			if (tmp_str[0] == '\x00')
-				strcpy(tmp_str, "No Name");
+			rtos->thread_details[tasks_found].name_check = stack_base;
+
+			/* Read the thread name, unless it is already known */
+			const char *cached_name = rtos_cached_thread_name(rtos,
+					rtos->thread_details[tasks_found].threadid, stack_base);
+			if (cached_name && strncmp(cached_name, name_start[0] ? name_start : "No Name",
+						FREERTOS_THREAD_NAME_CHECK_SIZE))
+				cached_name = NULL;
+			if (cached_name) {
+				snprintf(tmp_str, sizeof(tmp_str), "%s", cached_name);
+			} else {
+				retval = target_read_buffer(rtos->target,
+						rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+						FREERTOS_THREAD_NAME_STR_SIZE,
+						(uint8_t *)&tmp_str);
+				if (retval != ERROR_OK) {
+					LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
+					free(list_of_lists);
+					return retval;
+				}
+				tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
+				LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value \"%s\"\r\n",
+											rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
+											tmp_str);
+
+				if (tmp_str[0] == '\x00')
+					strcpy(tmp_str, "No Name");
+			}
 
 			rtos->thread_details[tasks_found].thread_name_str =
 				malloc(strlen(tmp_str)+1);
@@ -375,16 +407,7 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 			list_thread_count--;
 
 			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = target_read_buffer(rtos->target,
-					prev_list_elem_ptr + param->list_elem_next_offset,
-					param->pointer_width,
-					(uint8_t *)&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
+			list_elem_ptr = next_list_elem_ptr;
 			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										prev_list_elem_ptr + param->list_elem_next_offset,
 										list_elem_ptr);
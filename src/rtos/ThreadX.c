@@ -283,30 +283,28 @@ static int ThreadX_update_threads(struct rtos *rtos)
 		return -2;
 	}
 
-	/* read the number of threads */
-	retval = target_read_buffer(rtos->target,
-			rtos->symbols[ThreadX_VAL_tx_thread_created_count].address,
-			4,
-			(uint8_t *)&thread_list_size);
-
+	/* read the number of threads, the current thread id and the
+	 * pointer to the first thread */
+	int64_t current_thread = 0;
+	int64_t thread_ptr = 0;
+	struct target_memory_read reads[] = {
+		{ rtos->symbols[ThreadX_VAL_tx_thread_created_count].address, 4,
+			(uint8_t *)&thread_list_size },
+		{ rtos->symbols[ThreadX_VAL_tx_thread_current_ptr].address, 4,
+			(uint8_t *)&current_thread },
+		{ rtos->symbols[ThreadX_VAL_tx_thread_created_ptr].address,
+			param->pointer_width, (uint8_t *)&thread_ptr },
+	};
+	retval = target_read_memory_vector(rtos->target, reads, ARRAY_SIZE(reads));
 	if (retval != ERROR_OK) {
-		LOG_ERROR("Could not read ThreadX thread count from target");
+		LOG_ERROR("Could not read ThreadX thread list from target");
 		return retval;
 	}
 
 	/* wipe out previous thread details if any */
 	rtos_free_threadlist(rtos);
 
-	/* read the current thread id */
-	retval = target_read_buffer(rtos->target,
-			rtos->symbols[ThreadX_VAL_tx_thread_current_ptr].address,
-			4,
-			(uint8_t *)&rtos->current_thread);
-
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Could not read ThreadX current thread from target");
-		return retval;
-	}
+	rtos->current_thread = current_thread;
 
 	if ((thread_list_size  == 0) || (rtos->current_thread == 0)) {
 		/* Either : No RTOS threads - there is always at least the current execution though */
@@ -333,17 +331,6 @@ static int ThreadX_update_threads(struct rtos *rtos)
 				sizeof(struct thread_detail) * thread_list_size);
 	}
 
-	/* Read the pointer to the first thread */
-	int64_t thread_ptr = 0;
-	retval = target_read_buffer(rtos->target,
-			rtos->symbols[ThreadX_VAL_tx_thread_created_ptr].address,
-			param->pointer_width,
-			(uint8_t *)&thread_ptr);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Could not read ThreadX thread location from target");
-		return retval;
-	}
-
 	/* loop over all threads */
 	int64_t prev_thread_ptr = 0;
 	while ((thread_ptr != prev_thread_ptr) && (tasks_found < thread_list_size)) {
@@ -353,49 +340,53 @@ static int ThreadX_update_threads(struct rtos *rtos)
 		unsigned int i = 0;
 		int64_t name_ptr = 0;
 
+		int64_t thread_status = 0;
+		int64_t next_thread_ptr = 0;
+
 		/* Save the thread pointer */
 		rtos->thread_details[tasks_found].threadid = thread_ptr;
 
-		/* read the name pointer */
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_name_offset,
-				param->pointer_width,
-				(uint8_t *)&name_ptr);
+		/* read the name pointer, the thread status and the next thread */
+		struct target_memory_read thread_reads[] = {
+			{ thread_ptr + param->thread_name_offset, param->pointer_width,
+				(uint8_t *)&name_ptr },
+			{ thread_ptr + param->thread_state_offset, 4,
+				(uint8_t *)&thread_status },
+			{ thread_ptr + param->thread_next_offset, param->pointer_width,
+				(uint8_t *)&next_thread_ptr },
+		};
+		retval = target_read_memory_vector(rtos->target, thread_reads,
+				ARRAY_SIZE(thread_reads));
 		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read ThreadX thread name pointer from target");
+			LOG_ERROR("Could not read ThreadX thread control block from target");
 			return retval;
 		}
 
-		/* Read the thread name */
-		retval =
-			target_read_buffer(rtos->target,
-				name_ptr,
-				THREADX_THREAD_NAME_STR_SIZE,
-				(uint8_t *)&tmp_str);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread name from ThreadX target");
-			return retval;
+		/* Read the thread name, unless it is already known */
+		rtos->thread_details[tasks_found].name_check = name_ptr;
+		const char *cached_name = rtos_cached_thread_name(rtos, thread_ptr, name_ptr);
+		if (cached_name) {
+			snprintf(tmp_str, sizeof(tmp_str), "%s", cached_name);
+		} else {
+			retval =
+				target_read_buffer(rtos->target,
+					name_ptr,
+					THREADX_THREAD_NAME_STR_SIZE,
+					(uint8_t *)&tmp_str);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Error reading thread name from ThreadX target");
+				return retval;
+			}
+			tmp_str[THREADX_THREAD_NAME_STR_SIZE-1] = '\x00';
+
+			if (tmp_str[0] == '\x00')
+				strcpy(tmp_str, "No Name");
 		}
-		tmp_str[THREADX_THREAD_NAME_STR_SIZE-1] = '\x00';
-
-		if (tmp_str[0] == '\x00')
-			strcpy(tmp_str, "No Name");
 
 		rtos->thread_details[tasks_found].thread_name_str =
 			malloc(strlen(tmp_str)+1);
 		strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
 
-		/* Read the thread status */
-		int64_t thread_status = 0;
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_state_offset,
-				4,
-				(uint8_t *)&thread_status);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread state from ThreadX target");
-			return retval;
-		}
-
 		for (i = 0; (i < THREADX_NUM_STATES) &&
 				(ThreadX_thread_states[i].value != thread_status); i++) {
 			/* empty */
@@ -416,16 +407,7 @@ static int ThreadX_update_threads(struct rtos *rtos)
 		tasks_found++;
 		prev_thread_ptr = thread_ptr;
 
-		/* Get the location of the next thread structure. */
-		thread_ptr = 0;
-		retval = target_read_buffer(rtos->target,
-				prev_thread_ptr + param->thread_next_offset,
-				param->pointer_width,
-				(uint8_t *) &thread_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading next thread pointer in ThreadX thread list");
-			return retval;
-		}
+		thread_ptr = next_thread_ptr;
 	}
 
 	rtos->thread_count = tasks_found;
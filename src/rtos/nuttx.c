@@ -274,6 +274,27 @@ static int nuttx_update_threads(struct rtos *rtos)
 		return ERROR_FAIL;
 	}
 
+	/* read the heads of all task queues at once */
+	uint8_t heads[TASK_QUEUE_NUM][4];
+	struct target_memory_read reads[TASK_QUEUE_NUM];
+	unsigned int num_reads = 0;
+
+	for (i = 0; i < TASK_QUEUE_NUM; i++) {
+		if (g_tasklist[i].addr == 0)
+			continue;
+
+		reads[num_reads].address = g_tasklist[i].addr;
+		reads[num_reads].size = sizeof(heads[i]);
+		reads[num_reads].buffer = heads[i];
+		num_reads++;
+	}
+
+	ret = target_read_memory_vector(rtos->target, reads, num_reads);
+	if (ret) {
+		LOG_ERROR("target_read_memory_vector : ret = %d\n", ret);
+		return ERROR_FAIL;
+	}
+
 	thread_count = 0;
 
 	for (i = 0; i < TASK_QUEUE_NUM; i++) {
@@ -281,13 +302,7 @@ static int nuttx_update_threads(struct rtos *rtos)
 		if (g_tasklist[i].addr == 0)
 			continue;
 
-		ret = target_read_u32(rtos->target, g_tasklist[i].addr,
-			&head);
-
-		if (ret) {
-			LOG_ERROR("target_read_u32 : ret = %d\n", ret);
-			return ERROR_FAIL;
-		}
+		head = target_buffer_get_u32(rtos->target, heads[i]);
 
 		/* readytorun head is current thread */
 		if (g_tasklist[i].addr == rtos->symbols[0].address)
@@ -72,6 +72,19 @@ static int rtos_target_for_threadid(struct connection *connection, int64_t threa
 	return ERROR_OK;
 }
 
+static int rtos_event_callback(struct target *target,
+		enum target_event event, void *priv)
+{
+	if (target != priv || !target->rtos)
+		return ERROR_OK;
+
+	/* After a reset thread control blocks may be reused by other threads */
+	if (event == TARGET_EVENT_RESET_ASSERT)
+		rtos_flush_thread_name_cache(target->rtos);
+
+	return ERROR_OK;
+}
+
 static int os_alloc(struct target *target, struct rtos_type *ostype)
 {
 	struct rtos *os = target->rtos = calloc(1, sizeof(struct rtos));
@@ -89,6 +102,8 @@ static int os_alloc(struct target *target, struct rtos_type *ostype)
 	os->gdb_thread_packet = rtos_thread_packet;
 	os->gdb_target_for_threadid = rtos_target_for_threadid;
 
+	target_register_event_callback(rtos_event_callback, target);
+
 	return JIM_OK;
 }
 
@@ -97,9 +112,13 @@ static void os_free(struct target *target)
 	if (!target->rtos)
 		return;
 
+	target_unregister_event_callback(rtos_event_callback, target);
+
 	if (target->rtos->symbols)
 		free(target->rtos->symbols);
 
+	rtos_flush_thread_name_cache(target->rtos);
+
 	free(target->rtos);
 	target->rtos = NULL;
 }
@@ -653,16 +672,77 @@ int rtos_update_threads(struct target *target)
 	return ERROR_OK;
 }
 
+static int rtos_thread_name_compare(const void *a, const void *b)
+{
+	const struct rtos_thread_name *na = a;
+	const struct rtos_thread_name *nb = b;
+
+	if (na->threadid < nb->threadid)
+		return -1;
+	return na->threadid > nb->threadid;
+}
+
+void rtos_flush_thread_name_cache(struct rtos *rtos)
+{
+	for (int j = 0; j < rtos->name_cache_count; j++)
+		free(rtos->name_cache[j].name);
+	free(rtos->name_cache);
+	rtos->name_cache = NULL;
+	rtos->name_cache_count = 0;
+}
+
+/**
+ * Look up the name a thread had in the previous thread list.  Thread
+ * names do not change during the life of a thread, so update_threads
+ * implementations use this to avoid reading the name of every thread
+ * from the target again on each halt.
+ *
+ * The address of a control block alone does not identify a thread: a
+ * deleted thread's block may be reused by a new one.  @a check is a value
+ * read from the control block along with the thread list (name pointer,
+ * stack base) and must match the one recorded in name_check last time.
+ *
+ * @returns the name, or NULL if the thread is new.
+ */
+const char *rtos_cached_thread_name(struct rtos *rtos, threadid_t threadid,
+		uint64_t check)
+{
+	struct rtos_thread_name key = { .threadid = threadid };
+	struct rtos_thread_name *entry;
+
+	if (!rtos->name_cache)
+		return NULL;
+
+	entry = bsearch(&key, rtos->name_cache, rtos->name_cache_count,
+			sizeof(*rtos->name_cache), rtos_thread_name_compare);
+
+	return entry && entry->check == check ? entry->name : NULL;
+}
+
 void rtos_free_threadlist(struct rtos *rtos)
 {
 	if (rtos->thread_details) {
 		int j;
 
+		/* Keep the names of the threads for the next update */
+		rtos_flush_thread_name_cache(rtos);
+		rtos->name_cache = calloc(rtos->thread_count, sizeof(*rtos->name_cache));
+
 		for (j = 0; j < rtos->thread_count; j++) {
 			struct thread_detail *current_thread = &rtos->thread_details[j];
-			free(current_thread->thread_name_str);
+			if (rtos->name_cache && current_thread->thread_name_str) {
+				struct rtos_thread_name *entry = &rtos->name_cache[rtos->name_cache_count++];
+				entry->threadid = current_thread->threadid;
+				entry->check = current_thread->name_check;
+				entry->name = current_thread->thread_name_str;
+			} else {
+				free(current_thread->thread_name_str);
+			}
 			free(current_thread->extra_info_str);
 		}
+		if (rtos->name_cache_count)
+			qsort(rtos->name_cache, rtos->name_cache_count,
+					sizeof(*rtos->name_cache), rtos_thread_name_compare);
 		free(rtos->thread_details);
 		rtos->thread_details = NULL;
 		rtos->thread_count = 0;
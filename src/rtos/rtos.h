@@ -42,6 +42,17 @@ struct thread_detail {
 	bool exists;
 	char *thread_name_str;
 	char *extra_info_str;
+	/* Read along with the thread id by RTOSes that use the name cache,
+	 * e.g. the name pointer; a control block reused by a new thread
+	 * gets a different value. */
+	uint64_t name_check;
+};
+
+/* Name of a thread seen by the previous update_threads */
+struct rtos_thread_name {
+	threadid_t threadid;
+	uint64_t check;
+	char *name;
 };
 
 struct rtos {
@@ -56,6 +67,9 @@ struct rtos {
 	threadid_t current_thread;
 	struct thread_detail *thread_details;
 	int thread_count;
+	/* Thread names of the previous thread list, sorted by thread id */
+	struct rtos_thread_name *name_cache;
+	int name_cache_count;
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
@@ -124,6 +138,9 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num);
 int rtos_get_gdb_reg_list(struct connection *connection);
 int rtos_update_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
+const char *rtos_cached_thread_name(struct rtos *rtos, threadid_t threadid,
+		uint64_t check);
+void rtos_flush_thread_name_cache(struct rtos *rtos);
 int rtos_smp_init(struct target *target);
 /*  function for handling symbol access */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size);
@@ -346,27 +346,23 @@ static int uCOS_III_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
-	/* read current thread address */
+	/* read current thread address and number of tasks */
 	symbol_address_t current_thread_address = 0;
+	uint8_t thread_count_buf[2];
 
-	retval = target_read_memory(rtos->target,
-			rtos->symbols[uCOS_III_VAL_OSTCBCurPtr].address,
-			params->pointer_width,
-			1,
-			(void *)&current_thread_address);
+	struct target_memory_read reads[] = {
+		{ rtos->symbols[uCOS_III_VAL_OSTCBCurPtr].address, params->pointer_width,
+			(void *)&current_thread_address },
+		{ rtos->symbols[uCOS_III_VAL_OSTaskQty].address, sizeof(thread_count_buf),
+			thread_count_buf },
+	};
+	retval = target_read_memory_vector(rtos->target, reads, ARRAY_SIZE(reads));
 	if (retval != ERROR_OK) {
-		LOG_ERROR("uCOS-III: failed to read current thread address");
+		LOG_ERROR("uCOS-III: failed to read current thread address and thread count");
 		return retval;
 	}
 
-	/* read number of tasks */
-	retval = target_read_u16(rtos->target,
-			rtos->symbols[uCOS_III_VAL_OSTaskQty].address,
-			(void *)&rtos->thread_count);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("uCOS-III: failed to read thread count");
-		return retval;
-	}
+	rtos->thread_count = target_buffer_get_u16(rtos->target, thread_count_buf);
 
 	rtos->thread_details = calloc(rtos->thread_count, sizeof(struct thread_detail));
 	if (rtos->thread_details == NULL) {
@@ -402,49 +398,45 @@ static int uCOS_III_update_threads(struct rtos *rtos)
 
 		thread_detail->exists = true;
 
-		/* read thread name */
+		/* read thread name address, extra info and previous thread address */
 		symbol_address_t thread_name_address = 0;
-
-		retval = target_read_memory(rtos->target,
-				thread_address + params->thread_name_offset,
-				params->pointer_width,
-				1,
-				(void *)&thread_name_address);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("uCOS-III: failed to name address");
-			return retval;
-		}
-
-		retval = target_read_buffer(rtos->target,
-				thread_name_address,
-				sizeof(thread_str_buffer),
-				(void *)thread_str_buffer);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("uCOS-III: failed to read thread name");
-			return retval;
-		}
-
-		thread_str_buffer[sizeof(thread_str_buffer) - 1] = '\0';
-		thread_detail->thread_name_str = strdup(thread_str_buffer);
-
-		/* read thread extra info */
+		symbol_address_t prev_thread_address = 0;
 		uint8_t thread_state;
 		uint8_t thread_priority;
 
-		retval = target_read_u8(rtos->target,
-				thread_address + params->thread_state_offset,
-				&thread_state);
+		struct target_memory_read thread_reads[] = {
+			{ thread_address + params->thread_name_offset, params->pointer_width,
+				(void *)&thread_name_address },
+			{ thread_address + params->thread_state_offset, 1, &thread_state },
+			{ thread_address + params->thread_priority_offset, 1, &thread_priority },
+			{ thread_address + params->thread_prev_offset, params->pointer_width,
+				(void *)&prev_thread_address },
+		};
+		retval = target_read_memory_vector(rtos->target, thread_reads,
+				ARRAY_SIZE(thread_reads));
 		if (retval != ERROR_OK) {
-			LOG_ERROR("uCOS-III: failed to read thread state");
+			LOG_ERROR("uCOS-III: failed to read thread control block");
 			return retval;
 		}
 
-		retval = target_read_u8(rtos->target,
-				thread_address + params->thread_priority_offset,
-				&thread_priority);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("uCOS-III: failed to read thread priority");
-			return retval;
+		/* read thread name, unless it is already known */
+		thread_detail->name_check = thread_name_address;
+		const char *cached_name = rtos_cached_thread_name(rtos, thread_detail->threadid,
+				thread_name_address);
+		if (cached_name) {
+			thread_detail->thread_name_str = strdup(cached_name);
+		} else {
+			retval = target_read_buffer(rtos->target,
+					thread_name_address,
+					sizeof(thread_str_buffer),
+					(void *)thread_str_buffer);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("uCOS-III: failed to read thread name");
+				return retval;
+			}
+
+			thread_str_buffer[sizeof(thread_str_buffer) - 1] = '\0';
+			thread_detail->thread_name_str = strdup(thread_str_buffer);
 		}
 
 		const char *thread_state_str;
@@ -458,16 +450,7 @@ static int uCOS_III_update_threads(struct rtos *rtos)
 				thread_state_str, thread_priority);
 		thread_detail->extra_info_str = strdup(thread_str_buffer);
 
-		/* read previous thread address */
-		retval = target_read_memory(rtos->target,
-				thread_address + params->thread_prev_offset,
-				params->pointer_width,
-				1,
-				(void *)&thread_address);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("uCOS-III: failed to read previous thread address");
-			return retval;
-		}
+		thread_address = prev_thread_address;
 	}
 
 	return ERROR_OK;
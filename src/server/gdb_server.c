@@ -61,11 +61,6 @@
  * found in most modern embedded processors.
  */
 
-struct target_desc_format {
-	char *tdesc;
-	uint32_t tdesc_length;
-};
-
 /* private connection data for GDB */
 struct gdb_connection {
 	char buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for nul-termination */
@@ -91,8 +86,6 @@ struct gdb_connection {
 	 * normally we reply with a S reply via gdb_last_signal_packet.
 	 * as a side note this behaviour only effects gdb > 6.8 */
 	bool attached;
-	/* temporarily used for target description support */
-	struct target_desc_format target_desc;
 	/* temporarily used for thread list support */
 	char *thread_list;
 };
@@ -355,17 +348,20 @@ static int gdb_write(struct connection *connection, void *data, int len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
+/* @a prefix, unless 0, is sent in front of @a buffer as part of the same
+ * packet, which lets callers send slices of a larger buffer in place */
 static int gdb_put_packet_inner(struct connection *connection,
-		char *buffer, int len)
+		char prefix, const char *buffer, int len)
 {
 	int i;
-	unsigned char my_checksum = 0;
+	unsigned char my_checksum = prefix;
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
 #endif
 	int reply;
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
+	int prefix_len = prefix ? 1 : 0;
 
 	for (i = 0; i < len; i++)
 		my_checksum += buffer[i];
@@ -400,27 +396,31 @@ static int gdb_put_packet_inner(struct connection *connection,
 	while (1) {
 #ifdef _DEBUG_GDB_IO_
 		debug_buffer = strndup(buffer, len);
-		LOG_DEBUG("sending packet '$%s#%2.2x'", debug_buffer, my_checksum);
+		LOG_DEBUG("sending packet '$%.*s%s#%2.2x'", prefix_len, &prefix,
+				debug_buffer, my_checksum);
 		free(debug_buffer);
 #endif
 
 		char local_buffer[1024];
 		local_buffer[0] = '$';
-		if ((size_t)len + 4 <= sizeof(local_buffer)) {
+		local_buffer[1] = prefix;
+		if ((size_t)len + prefix_len + 4 <= sizeof(local_buffer)) {
 			/* performance gain on smaller packets by only a single call to gdb_write() */
-			memcpy(local_buffer + 1, buffer, len++);
-			len += snprintf(local_buffer + len, sizeof(local_buffer) - len, "#%02x", my_checksum);
-			retval = gdb_write(connection, local_buffer, len);
+			int pos = 1 + prefix_len;
+			memcpy(local_buffer + pos, buffer, len);
+			pos += len;
+			pos += snprintf(local_buffer + pos, sizeof(local_buffer) - pos, "#%02x", my_checksum);
+			retval = gdb_write(connection, local_buffer, pos);
 			if (retval != ERROR_OK)
 				return retval;
 		} else {
 			/* larger packets are transmitted directly from caller supplied buffer
 			 * by several calls to gdb_write() to avoid dynamic allocation */
-			snprintf(local_buffer + 1, sizeof(local_buffer) - 1, "#%02x", my_checksum);
-			retval = gdb_write(connection, local_buffer, 1);
+			retval = gdb_write(connection, local_buffer, 1 + prefix_len);
 			if (retval != ERROR_OK)
 				return retval;
-			retval = gdb_write(connection, buffer, len);
+			snprintf(local_buffer + 1, sizeof(local_buffer) - 1, "#%02x", my_checksum);
+			retval = gdb_write(connection, (void *)buffer, len);
 			if (retval != ERROR_OK)
 				return retval;
 			retval = gdb_write(connection, local_buffer + 1, 3);
@@ -478,11 +478,12 @@ static int gdb_put_packet_inner(struct connection *connection,
 	return ERROR_OK;
 }
 
-int gdb_put_packet(struct connection *connection, char *buffer, int len)
+static int gdb_put_packet_prefixed(struct connection *connection,
+		char prefix, const char *buffer, int len)
 {
 	struct gdb_connection *gdb_con = connection->priv;
 	gdb_con->busy = true;
-	int retval = gdb_put_packet_inner(connection, buffer, len);
+	int retval = gdb_put_packet_inner(connection, prefix, buffer, len);
 	gdb_con->busy = false;
 
 	/* we sent some data, reset timer for keep alive messages */
@@ -491,6 +492,11 @@ int gdb_put_packet(struct connection *connection, char *buffer, int len)
 	return retval;
 }
 
+int gdb_put_packet(struct connection *connection, char *buffer, int len)
+{
+	return gdb_put_packet_prefixed(connection, 0, buffer, len);
+}
+
 static inline int fetch_packet(struct connection *connection,
 		int *checksum_ok, int noack, int *len, char *buffer)
 {
@@ -949,8 +955,6 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->sync = false;
 	gdb_connection->mem_write_error = false;
 	gdb_connection->attached = true;
-	gdb_connection->target_desc.tdesc = NULL;
-	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
 
 	/* send ACK to GDB for debug request */
@@ -1414,8 +1418,32 @@ static int gdb_error(struct connection *connection, int retval)
 	return ERROR_OK;
 }
 
+/* Encode len bytes of binary data found at buffer + in as a binary
+ * ('x' packet) reply starting at buffer + out, escaping the characters
+ * that are special to the remote protocol.  Each encoded byte takes at
+ * most two characters, so with in >= out + len the output never catches
+ * up with input that has not been read yet and buffers may overlap. */
+static size_t gdb_escape_binary(char *buffer, size_t out, size_t in, size_t len)
+{
+	size_t pos = out;
+
+	for (size_t i = 0; i < len; i++) {
+		char c = buffer[in + i];
+
+		if (c == '#' || c == '$' || c == '}' || c == '*') {
+			buffer[pos++] = '}';
+			buffer[pos++] = c ^ 0x20;
+		} else
+			buffer[pos++] = c;
+	}
+
+	return pos - out;
+}
+
 /* We don't have to worry about the default 2 second timeout for GDB packets,
  * because GDB breaks up large memory reads into smaller reads.
+ *
+ * Handles both hex ('m') and binary ('x') memory reads.
  */
 static int gdb_read_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
@@ -1424,9 +1452,10 @@ static int gdb_read_memory_packet(struct connection *connection,
 	char *separator;
 	uint64_t addr = 0;
 	uint32_t len = 0;
+	bool binary = (packet[0] == 'x');
 
 	uint8_t *buffer;
-	char *hex_buffer;
+	char *reply;
 
 	int retval = ERROR_OK;
 
@@ -1443,12 +1472,21 @@ static int gdb_read_memory_packet(struct connection *connection,
 	len = strtoul(separator + 1, NULL, 16);
 
 	if (!len) {
+		if (binary) {
+			gdb_put_packet(connection, "b", 1);
+			return ERROR_OK;
+		}
 		LOG_WARNING("invalid read memory packet received (len == 0)");
 		gdb_put_packet(connection, "", 0);
 		return ERROR_OK;
 	}
 
-	buffer = malloc(len);
+	/* The target data is read into the tail of the reply buffer and encoded
+	 * towards its front in place, so the reply is built without a second
+	 * buffer or copy.  hexify() walks forward two characters per byte and
+	 * never overtakes its input either. */
+	reply = malloc(2 * len + 1);
+	buffer = (uint8_t *)reply + len + 1;
 
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
@@ -1473,17 +1511,19 @@ static int gdb_read_memory_packet(struct connection *connection,
 	}
 
 	if (retval == ERROR_OK) {
-		hex_buffer = malloc(len * 2 + 1);
-
-		size_t pkt_len = hexify(hex_buffer, buffer, len, len * 2 + 1);
+		size_t pkt_len;
 
-		gdb_put_packet(connection, hex_buffer, pkt_len);
+		if (binary) {
+			reply[0] = 'b';
+			pkt_len = 1 + gdb_escape_binary(reply, 1, len + 1, len);
+		} else
+			pkt_len = hexify(reply, buffer, len, len * 2 + 1);
 
-		free(hex_buffer);
+		gdb_put_packet(connection, reply, pkt_len);
 	} else
 		retval = gdb_error(connection, retval);
 
-	free(buffer);
+	free(reply);
 
 	return retval;
 }
@@ -1807,35 +1847,168 @@ static int compare_bank(const void *a, const void *b)
 		return -1;
 }
 
-static int gdb_memory_map(struct connection *connection,
-		char const *packet, int packet_size)
+/* Generated XML documents are kept per target, across connections, and
+ * only regenerated when the register list or flash layout they describe
+ * changes.  The key is a copy of everything the document depends on,
+ * compared byte for byte, so it can't match a different layout.
+ */
+struct gdb_xml_key {
+	uint8_t *data;
+	size_t length;
+	size_t size;
+	bool failed;	/* out of memory, matches nothing */
+};
+
+struct gdb_xml_doc {
+	char *xml;
+	int length;
+	struct gdb_xml_key key;
+};
+
+struct gdb_xml_cache {
+	struct target *target;
+	struct gdb_xml_doc tdesc;
+	struct gdb_xml_doc memory_map;
+	struct gdb_xml_cache *next;
+};
+
+static struct gdb_xml_cache *gdb_xml_caches;
+
+static struct gdb_xml_cache *gdb_get_xml_cache(struct target *target)
+{
+	struct gdb_xml_cache *cache;
+
+	for (cache = gdb_xml_caches; cache; cache = cache->next)
+		if (cache->target == target)
+			return cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		LOG_ERROR("Unable to allocate memory");
+		return NULL;
+	}
+
+	cache->target = target;
+	cache->next = gdb_xml_caches;
+	gdb_xml_caches = cache;
+	return cache;
+}
+
+static void gdb_free_xml_caches(void)
+{
+	while (gdb_xml_caches) {
+		struct gdb_xml_cache *cache = gdb_xml_caches;
+		gdb_xml_caches = cache->next;
+		free(cache->tdesc.xml);
+		free(cache->tdesc.key.data);
+		free(cache->memory_map.xml);
+		free(cache->memory_map.key.data);
+		free(cache);
+	}
+}
+
+static void gdb_xml_key_add(struct gdb_xml_key *key, const void *data, size_t size)
+{
+	if (key->failed)
+		return;
+
+	if (key->length + size > key->size) {
+		size_t new_size = key->size ? key->size * 2 : 256;
+		while (new_size < key->length + size)
+			new_size *= 2;
+		uint8_t *new_data = realloc(key->data, new_size);
+		if (new_data == NULL) {
+			key->failed = true;
+			return;
+		}
+		key->data = new_data;
+		key->size = new_size;
+	}
+
+	memcpy(key->data + key->length, data, size);
+	key->length += size;
+}
+
+static void gdb_xml_key_add_str(struct gdb_xml_key *key, const char *str)
+{
+	/* include the terminator so that adjacent strings can't merge */
+	if (str == NULL)
+		str = "";
+	gdb_xml_key_add(key, str, strlen(str) + 1);
+}
+
+static bool gdb_xml_doc_matches(const struct gdb_xml_doc *doc, const struct gdb_xml_key *key)
+{
+	return doc->xml != NULL && !key->failed &&
+		doc->key.length == key->length &&
+		memcmp(doc->key.data, key->data, key->length) == 0;
+}
+
+/* Takes over @a xml and the data of @a key */
+static void gdb_xml_doc_set(struct gdb_xml_doc *doc, char *xml, int length,
+		struct gdb_xml_key *key)
+{
+	free(doc->xml);
+	free(doc->key.data);
+	doc->xml = xml;
+	doc->length = length;
+	doc->key = *key;
+	memset(key, 0, sizeof(*key));
+}
+
+/* Send the part of a cached document gdb asked for with qXfer, straight
+ * out of the document.  The first character of the reply is 'm' if
+ * there is *more* to transfer, 'l' for the *last* chunk.
+ */
+static int gdb_put_xml_slice(struct connection *connection,
+		const struct gdb_xml_doc *doc, int offset, unsigned int length)
+{
+	if (offset < 0 || offset > doc->length)
+		offset = doc->length;
+
+	unsigned int remaining = doc->length - offset;
+	if (length < remaining)
+		return gdb_put_packet_prefixed(connection, 'm', doc->xml + offset, length);
+
+	return gdb_put_packet_prefixed(connection, 'l', doc->xml + offset, remaining);
+}
+
+static void gdb_memory_map_key(struct target *target,
+		struct flash_bank **banks, int num_banks, struct gdb_xml_key *key)
+{
+	target_addr_t address_max = target_address_max(target);
+
+	gdb_xml_key_add(key, &address_max, sizeof(address_max));
+	gdb_xml_key_add(key, &num_banks, sizeof(num_banks));
+	for (int i = 0; i < num_banks; i++) {
+		struct flash_bank *p = banks[i];
+
+		gdb_xml_key_add(key, &p->base, sizeof(p->base));
+		gdb_xml_key_add(key, &p->size, sizeof(p->size));
+		gdb_xml_key_add(key, &p->num_sectors, sizeof(p->num_sectors));
+		for (int j = 0; j < p->num_sectors; j++) {
+			gdb_xml_key_add(key, &p->sectors[j].offset, sizeof(p->sectors[j].offset));
+			gdb_xml_key_add(key, &p->sectors[j].size, sizeof(p->sectors[j].size));
+		}
+	}
+}
+
+static int gdb_generate_memory_map(struct target *target,
+		struct flash_bank **banks, int target_flash_banks,
+		char **xml_out, int *length_out)
 {
 	/* We get away with only specifying flash here. Regions that are not
 	 * specified are treated as if we provided no memory map(if not we
 	 * could detect the holes and mark them as RAM).
-	 * Normally we only execute this code once, but no big deal if we
-	 * have to regenerate it a couple of times.
 	 */
 
-	struct target *target = get_target_from_connection(connection);
 	struct flash_bank *p;
 	char *xml = NULL;
 	int size = 0;
 	int pos = 0;
 	int retval = ERROR_OK;
-	struct flash_bank **banks;
-	int offset;
-	int length;
-	char *separator;
 	target_addr_t ram_start = 0;
 	int i;
-	int target_flash_banks = 0;
-
-	/* skip command character */
-	packet += 23;
-
-	offset = strtoul(packet, &separator, 16);
-	length = strtoul(separator + 1, &separator, 16);
 
 	xml_printf(&retval, &xml, &pos, &size, "<memory-map>\n");
 
@@ -1843,21 +2016,6 @@ static int gdb_memory_map(struct connection *connection,
 	 * memory as ram (or rather read/write) by default for GDB, since
 	 * it has no concept of non-cacheable read/write memory (i/o etc).
 	 */
-	banks = malloc(sizeof(struct flash_bank *)*flash_get_bank_count());
-
-	for (i = 0; i < flash_get_bank_count(); i++) {
-		p = get_flash_bank_by_num_noprobe(i);
-		if (p->target != target)
-			continue;
-		retval = get_flash_bank_by_num(i, &p);
-		if (retval != ERROR_OK) {
-			free(banks);
-			gdb_error(connection, retval);
-			return retval;
-		}
-		banks[target_flash_banks++] = p;
-	}
-
 	qsort(banks, target_flash_banks, sizeof(struct flash_bank *),
 		compare_bank);
 
@@ -1933,27 +2091,87 @@ static int gdb_memory_map(struct connection *connection,
 	/* ELSE a flash chip could be at the very end of the address space, in
 	 * which case ram_start will be precisely 0 */
 
-	free(banks);
-
 	xml_printf(&retval, &xml, &pos, &size, "</memory-map>\n");
 
 	if (retval != ERROR_OK) {
 		free(xml);
-		gdb_error(connection, retval);
 		return retval;
 	}
 
-	if (offset + length > pos)
-		length = pos - offset;
+	*xml_out = xml;
+	*length_out = pos;
+	return ERROR_OK;
+}
+
+static int gdb_memory_map(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	/* The map is regenerated only when the flash layout changes, e.g.
+	 * after a bank has been probed for the first time.
+	 */
+
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_xml_cache *cache = gdb_get_xml_cache(target);
+	struct flash_bank *p;
+	int retval = ERROR_OK;
+	struct flash_bank **banks;
+	int offset;
+	unsigned int length;
+	char *separator;
+	int i;
+	int target_flash_banks = 0;
+
+	if (cache == NULL) {
+		gdb_error(connection, ERROR_FAIL);
+		return ERROR_FAIL;
+	}
+
+	/* skip command character */
+	packet += 23;
+
+	offset = strtoul(packet, &separator, 16);
+	length = strtoul(separator + 1, &separator, 16);
 
-	char *t = malloc(length + 1);
-	t[0] = 'l';
-	memcpy(t + 1, xml + offset, length);
-	gdb_put_packet(connection, t, length + 1);
+	banks = malloc(sizeof(struct flash_bank *)*flash_get_bank_count());
+	if (banks == NULL) {
+		gdb_error(connection, ERROR_FAIL);
+		return ERROR_FAIL;
+	}
 
-	free(t);
-	free(xml);
-	return ERROR_OK;
+	for (i = 0; i < flash_get_bank_count(); i++) {
+		p = get_flash_bank_by_num_noprobe(i);
+		if (p->target != target)
+			continue;
+		retval = get_flash_bank_by_num(i, &p);
+		if (retval != ERROR_OK) {
+			free(banks);
+			gdb_error(connection, retval);
+			return retval;
+		}
+		banks[target_flash_banks++] = p;
+	}
+
+	struct gdb_xml_key key = { 0 };
+	gdb_memory_map_key(target, banks, target_flash_banks, &key);
+	if (!gdb_xml_doc_matches(&cache->memory_map, &key)) {
+		char *xml;
+		int xml_length;
+
+		retval = gdb_generate_memory_map(target, banks, target_flash_banks,
+				&xml, &xml_length);
+		if (retval != ERROR_OK) {
+			free(key.data);
+			free(banks);
+			gdb_error(connection, retval);
+			return retval;
+		}
+		gdb_xml_doc_set(&cache->memory_map, xml, xml_length, &key);
+	}
+
+	free(key.data);
+	free(banks);
+
+	return gdb_put_xml_slice(connection, &cache->memory_map, offset, length);
 }
 
 static const char *gdb_get_reg_type_name(enum reg_type type)
@@ -2339,57 +2557,121 @@ error:
 	return retval;
 }
 
-static int gdb_get_target_description_chunk(struct target *target, struct target_desc_format *target_desc,
-		char **chunk, int32_t offset, uint32_t length)
+/* Everything gdb_generate_reg_type_description() emits for @a type.  The
+ * types can be rebuilt in place (e.g. when a target is examined again), so
+ * their contents are part of the key, not their addresses. */
+static void gdb_reg_type_key(struct gdb_xml_key *key, const struct reg_data_type *type)
 {
-	if (target_desc == NULL) {
-		LOG_ERROR("Unable to Generate Target Description");
-		return ERROR_FAIL;
-	}
+	const uint8_t more = 1, end = 0;
 
-	char *tdesc = target_desc->tdesc;
-	uint32_t tdesc_length = target_desc->tdesc_length;
+	gdb_xml_key_add(key, &type->type, sizeof(type->type));
+	gdb_xml_key_add_str(key, type->id);
+	if (type->type != REG_TYPE_ARCH_DEFINED)
+		return;
 
-	if (tdesc == NULL) {
-		int retval = gdb_generate_target_description(target, &tdesc);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Unable to Generate Target Description");
-			return ERROR_FAIL;
+	gdb_xml_key_add(key, &type->type_class, sizeof(type->type_class));
+	if (type->type_class == REG_TYPE_CLASS_VECTOR) {
+		gdb_xml_key_add(key, &type->reg_type_vector->count,
+				sizeof(type->reg_type_vector->count));
+		gdb_reg_type_key(key, type->reg_type_vector->type);
+	} else if (type->type_class == REG_TYPE_CLASS_UNION) {
+		struct reg_data_type_union_field *field;
+		for (field = type->reg_type_union->fields; field; field = field->next) {
+			gdb_xml_key_add(key, &more, sizeof(more));
+			gdb_xml_key_add_str(key, field->name);
+			gdb_reg_type_key(key, field->type);
 		}
+	} else if (type->type_class == REG_TYPE_CLASS_STRUCT) {
+		struct reg_data_type_struct_field *field;
+		gdb_xml_key_add(key, &type->reg_type_struct->size,
+				sizeof(type->reg_type_struct->size));
+		for (field = type->reg_type_struct->fields; field; field = field->next) {
+			gdb_xml_key_add(key, &more, sizeof(more));
+			gdb_xml_key_add_str(key, field->name);
+			gdb_xml_key_add(key, &field->use_bitfields, sizeof(field->use_bitfields));
+			if (field->use_bitfields)
+				gdb_xml_key_add(key, field->bitfield, sizeof(*field->bitfield));
+			else
+				gdb_reg_type_key(key, field->type);
+		}
+	} else if (type->type_class == REG_TYPE_CLASS_FLAGS) {
+		struct reg_data_type_flags_field *field;
+		gdb_xml_key_add(key, &type->reg_type_flags->size,
+				sizeof(type->reg_type_flags->size));
+		for (field = type->reg_type_flags->fields; field; field = field->next) {
+			gdb_xml_key_add(key, &more, sizeof(more));
+			gdb_xml_key_add_str(key, field->name);
+			gdb_xml_key_add(key, field->bitfield, sizeof(*field->bitfield));
+		}
+	}
+	gdb_xml_key_add(key, &end, sizeof(end));
+}
 
-		tdesc_length = strlen(tdesc);
+static int gdb_target_description_key(struct target *target, struct gdb_xml_key *key)
+{
+	struct reg **reg_list = NULL;
+	int reg_list_size;
+	const uint8_t no_type = 0, has_type = 1;
+
+	int retval = target_get_gdb_reg_list_noread(target, &reg_list,
+			&reg_list_size, REG_CLASS_ALL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	gdb_xml_key_add_str(key, target_get_gdb_arch(target));
+	gdb_xml_key_add(key, &reg_list_size, sizeof(reg_list_size));
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *reg = reg_list[i];
+
+		gdb_xml_key_add(key, &reg->exist, sizeof(reg->exist));
+		if (!reg->exist)
+			continue;
+		gdb_xml_key_add_str(key, reg->name);
+		gdb_xml_key_add(key, &reg->number, sizeof(reg->number));
+		gdb_xml_key_add(key, &reg->size, sizeof(reg->size));
+		gdb_xml_key_add(key, &reg->caller_save, sizeof(reg->caller_save));
+		gdb_xml_key_add_str(key, reg->group);
+		gdb_xml_key_add_str(key, reg->feature ? reg->feature->name : NULL);
+		if (reg->reg_data_type) {
+			gdb_xml_key_add(key, &has_type, sizeof(has_type));
+			gdb_reg_type_key(key, reg->reg_data_type);
+		} else {
+			gdb_xml_key_add(key, &no_type, sizeof(no_type));
+		}
 	}
 
-	char transfer_type;
+	free(reg_list);
+	return ERROR_OK;
+}
 
-	if (length < (tdesc_length - offset))
-		transfer_type = 'm';
-	else
-		transfer_type = 'l';
+/* Return the target description of @a target, regenerating it only if
+ * the register list changed since it was last generated. */
+static int gdb_get_target_description(struct target *target,
+		const struct gdb_xml_doc **doc)
+{
+	struct gdb_xml_cache *cache = gdb_get_xml_cache(target);
+	struct gdb_xml_key key = { 0 };
 
-	*chunk = malloc(length + 2);
-	if (*chunk == NULL) {
-		LOG_ERROR("Unable to allocate memory");
+	if (cache == NULL || gdb_target_description_key(target, &key) != ERROR_OK) {
+		free(key.data);
+		LOG_ERROR("Unable to Generate Target Description");
 		return ERROR_FAIL;
 	}
 
-	(*chunk)[0] = transfer_type;
-	if (transfer_type == 'm') {
-		strncpy((*chunk) + 1, tdesc + offset, length);
-		(*chunk)[1 + length] = '\0';
-	} else {
-		strncpy((*chunk) + 1, tdesc + offset, tdesc_length - offset);
-		(*chunk)[1 + (tdesc_length - offset)] = '\0';
+	if (!gdb_xml_doc_matches(&cache->tdesc, &key)) {
+		char *tdesc;
+		int retval = gdb_generate_target_description(target, &tdesc);
+		if (retval != ERROR_OK) {
+			free(key.data);
+			LOG_ERROR("Unable to Generate Target Description");
+			return ERROR_FAIL;
+		}
 
-		/* After gdb-server sends out last chunk, invalidate tdesc. */
-		free(tdesc);
-		tdesc = NULL;
-		tdesc_length = 0;
+		gdb_xml_doc_set(&cache->tdesc, tdesc, strlen(tdesc), &key);
 	}
 
-	target_desc->tdesc = tdesc;
-	target_desc->tdesc_length = tdesc_length;
-
+	free(key.data);
+	*doc = &cache->tdesc;
 	return ERROR_OK;
 }
 
@@ -2595,7 +2877,8 @@ static int gdb_query_packet(struct connection *connection,
 		}
 	} else if (strncmp(packet, "qSupported", 10) == 0) {
 		/* we currently support packet size and qXfer:memory-map:read (if enabled)
-		 * qXfer:features:read is supported for some targets */
+		 * qXfer:features:read is supported for some targets
+		 * binary-upload announces the binary memory read packet 'x' */
 		int retval = ERROR_OK;
 		char *buffer = NULL;
 		int pos = 0;
@@ -2620,7 +2903,7 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+;binary-upload+",
 			GDB_BUFFER_SIZE,
 			((gdb_use_memory_map == 1) && (flash_get_bank_count() > 0)) ? '+' : '-',
 			(gdb_target_desc_supported == 1) ? '+' : '-');
@@ -2638,7 +2921,7 @@ static int gdb_query_packet(struct connection *connection,
 		   && (flash_get_bank_count() > 0))
 		return gdb_memory_map(connection, packet, packet_size);
 	else if (strncmp(packet, "qXfer:features:read:", 20) == 0) {
-		char *xml = NULL;
+		const struct gdb_xml_doc *tdesc;
 		int retval = ERROR_OK;
 
 		int offset;
@@ -2652,22 +2935,14 @@ static int gdb_query_packet(struct connection *connection,
 			return ERROR_OK;
 		}
 
-		/* Target should prepare correct target description for annex.
-		 * The first character of returned xml is 'm' or 'l'. 'm' for
-		 * there are *more* chunks to transfer. 'l' for it is the *last*
-		 * chunk of target description.
-		 */
-		retval = gdb_get_target_description_chunk(target, &gdb_connection->target_desc,
-				&xml, offset, length);
+		/* Target should prepare correct target description for annex. */
+		retval = gdb_get_target_description(target, &tdesc);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
 			return retval;
 		}
 
-		gdb_put_packet(connection, xml, strlen(xml));
-
-		free(xml);
-		return ERROR_OK;
+		return gdb_put_xml_slice(connection, tdesc, offset, length);
 	} else if (strncmp(packet, "qXfer:threads:read:", 19) == 0) {
 		char *xml = NULL;
 		int retval = ERROR_OK;
@@ -3294,6 +3569,7 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_set_register_packet(connection, packet, packet_size);
 					break;
 				case 'm':
+				case 'x':
 					retval = gdb_read_memory_packet(connection, packet, packet_size);
 					break;
 				case 'M':
@@ -3812,4 +4088,5 @@ void gdb_service_free(void)
 {
 	free(gdb_port);
 	free(gdb_port_next);
+	gdb_free_xml_caches();
 }
@@ -0,0 +1,174 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <target/rtt.h>
+
+#include "server.h"
+#include "rtt_server.h"
+
+/**
+ * @file
+ *
+ * Serves each RTT channel on its own TCP port.  Data read from the up
+ * channel is sent to all connections, data received from a connection is
+ * written to the down channel with the same number.
+ */
+
+#define RTT_SERVER_BUFFER_SIZE	1024
+
+struct rtt_service {
+	unsigned int channel;
+};
+
+static int rtt_connection_write(unsigned int channel, const uint8_t *buffer,
+		size_t length, void *user_data)
+{
+	struct connection *connection = user_data;
+
+	int retval = connection_write(connection, buffer, length);
+	if (retval < 0)
+		LOG_DEBUG("rtt: failed to send data of channel %u", channel);
+
+	return ERROR_OK;
+}
+
+static int rtt_new_connection(struct connection *connection)
+{
+	struct rtt_service *service = connection->service->priv;
+
+	LOG_DEBUG("rtt: new connection for channel %u", service->channel);
+	connection->edge_triggered = true;
+
+	return rtt_register_sink(service->channel, rtt_connection_write,
+			connection);
+}
+
+static int rtt_connection_closed(struct connection *connection)
+{
+	struct rtt_service *service = connection->service->priv;
+
+	rtt_unregister_sink(service->channel, rtt_connection_write, connection);
+	LOG_DEBUG("rtt: connection for channel %u closed", service->channel);
+
+	return ERROR_OK;
+}
+
+static int rtt_input(struct connection *connection)
+{
+	struct rtt_service *service = connection->service->priv;
+	uint8_t buffer[RTT_SERVER_BUFFER_SIZE];
+	int bytes_read;
+
+	bytes_read = connection_read(connection, buffer, sizeof(buffer));
+
+	if (bytes_read == 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	else if (bytes_read < 0) {
+		LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	size_t length = bytes_read;
+	rtt_write_channel(service->channel, buffer, &length);
+	if (length < (size_t)bytes_read)
+		LOG_DEBUG("rtt: down channel %u full, dropped %zu bytes",
+				service->channel, bytes_read - length);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_server_start_command)
+{
+	struct rtt_service *service;
+	unsigned int channel;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], channel);
+	if (channel >= RTT_MAX_CHANNELS)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	service = malloc(sizeof(*service));
+	if (!service) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	service->channel = channel;
+
+	int retval = add_service("rtt", CMD_ARGV[0], CONNECTION_LIMIT_UNLIMITED,
+			rtt_new_connection, rtt_input, rtt_connection_closed, service);
+	if (retval != ERROR_OK)
+		free(service);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_rtt_server_stop_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return remove_service("rtt", CMD_ARGV[0]);
+}
+
+static const struct command_registration rtt_server_subcommand_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_rtt_server_start_command,
+		.mode = COMMAND_ANY,
+		.help = "serve an RTT channel on a TCP port",
+		.usage = "port channel",
+	},
+	{
+		.name = "stop",
+		.handler = handle_rtt_server_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "stop serving the RTT channel of a TCP port",
+		.usage = "port",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration rtt_server_command_handlers[] = {
+	{
+		.name = "server",
+		.mode = COMMAND_ANY,
+		.help = "RTT server commands",
+		.usage = "",
+		.chain = rtt_server_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration rtt_command_handlers[] = {
+	{
+		.name = "rtt",
+		.mode = COMMAND_ANY,
+		.help = "Real Time Transfer commands",
+		.usage = "",
+		.chain = rtt_server_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int rtt_server_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, rtt_command_handlers);
+}
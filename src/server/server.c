@@ -30,6 +30,7 @@
 #include <target/target.h>
 #include <target/target_request.h>
 #include <target/openrisc/jsp_server.h>
+#include <helper/time_support.h>
 #include "openocd.h"
 #include "tcl_server.h"
 #include "telnet_server.h"
@@ -44,6 +45,11 @@
 #include <netinet/tcp.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#include <poll.h>
+#endif
+
 static struct service *services;
 
 enum shutdown_reason {
@@ -63,6 +69,413 @@ static int polling_period = 100;
 /* address by name on which to listen for incoming TCP/IP connections */
 static char *bindto_name;
 
+/*
+ * Descriptors server_loop() waits on are kept in a persistent registry:
+ * listening sockets and connections are registered when they are created
+ * and unregistered when they go away, instead of rebuilding an fd_set on
+ * every iteration.  The registry is served by one of the event backends
+ * below, picked at run time: epoll where available, poll() otherwise and
+ * select() as the last resort (and on Windows).
+ */
+struct server_fd {
+	int fd;
+	/* service owning the descriptor; NULL once unregistered */
+	struct service *service;
+	/* connection reading from the descriptor, NULL for a listener */
+	struct connection *connection;
+	/* position in server_fds[] */
+	int index;
+	/* descriptor can't be waited on (e.g. a regular file), always ready */
+	bool always_ready;
+	struct server_fd *next_dead;
+};
+
+struct server_event_backend {
+	const char *name;
+	int (*init)(void);
+	void (*quit)(void);
+	int (*add)(struct server_fd *sfd);
+	void (*remove)(struct server_fd *sfd);
+	/* wait up to timeout_ms for activity, store the ready descriptors
+	 * and return their count, or -1 on error with errno set */
+	int (*wait)(int timeout_ms, struct server_fd **ready, int max_ready);
+};
+
+static const struct server_event_backend *event_backend;
+
+static struct server_fd **server_fds;
+static int server_fds_count;
+static int server_fds_size;
+/* set whenever server_fds[] changes; poll() and select() rebuild from it */
+static bool server_fds_changed;
+static int server_fds_always_ready;
+/* unregistered entries, freed once no ready list can refer to them */
+static struct server_fd *server_fds_dead;
+static struct server_fd **server_fds_ready;
+
+static int server_fds_collect_always_ready(struct server_fd **ready, int count, int max_ready)
+{
+	for (int i = 0; i < server_fds_count && count < max_ready; i++) {
+		if (server_fds[i]->always_ready)
+			ready[count++] = server_fds[i];
+	}
+	return count;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#define EPOLL_MAX_EVENTS 64
+
+static int epoll_fd = -1;
+
+static int epoll_backend_init(void)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		LOG_DEBUG("epoll_create1: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static void epoll_backend_quit(void)
+{
+	close(epoll_fd);
+	epoll_fd = -1;
+}
+
+static int epoll_backend_add(struct server_fd *sfd)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	if (sfd->connection && sfd->connection->edge_triggered)
+		ev.events |= EPOLLET;
+	ev.data.ptr = sfd;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sfd->fd, &ev) == 0)
+		return ERROR_OK;
+
+	/* regular files are always readable but can't be added to epoll */
+	if (errno == EPERM) {
+		sfd->always_ready = true;
+		return ERROR_OK;
+	}
+
+	LOG_ERROR("epoll_ctl: %s", strerror(errno));
+	return ERROR_FAIL;
+}
+
+static void epoll_backend_remove(struct server_fd *sfd)
+{
+	if (!sfd->always_ready)
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sfd->fd, NULL);
+}
+
+static int epoll_backend_wait(int timeout_ms, struct server_fd **ready, int max_ready)
+{
+	struct epoll_event events[EPOLL_MAX_EVENTS];
+	int max_events = max_ready < EPOLL_MAX_EVENTS ? max_ready : EPOLL_MAX_EVENTS;
+
+	if (server_fds_always_ready)
+		timeout_ms = 0;
+
+	int n = epoll_wait(epoll_fd, events, max_events, timeout_ms);
+	if (n < 0)
+		return n;
+
+	for (int i = 0; i < n; i++)
+		ready[i] = events[i].data.ptr;
+
+	if (server_fds_always_ready)
+		n = server_fds_collect_always_ready(ready, n, max_ready);
+
+	return n;
+}
+
+static const struct server_event_backend epoll_backend = {
+	.name = "epoll",
+	.init = epoll_backend_init,
+	.quit = epoll_backend_quit,
+	.add = epoll_backend_add,
+	.remove = epoll_backend_remove,
+	.wait = epoll_backend_wait,
+};
+
+#endif /* HAVE_SYS_EPOLL_H */
+
+#if defined(HAVE_POLL_H) && !defined(_WIN32)
+
+static struct pollfd *poll_fds;
+static int poll_fds_count;
+
+static int poll_backend_init(void)
+{
+	return ERROR_OK;
+}
+
+static void poll_backend_quit(void)
+{
+	free(poll_fds);
+	poll_fds = NULL;
+	poll_fds_count = 0;
+}
+
+static int poll_backend_add(struct server_fd *sfd)
+{
+	return ERROR_OK;
+}
+
+static void poll_backend_remove(struct server_fd *sfd)
+{
+}
+
+static int poll_backend_wait(int timeout_ms, struct server_fd **ready, int max_ready)
+{
+	if (server_fds_changed) {
+		struct pollfd *fds = realloc(poll_fds, server_fds_size * sizeof(struct pollfd));
+		if (!fds && server_fds_size) {
+			errno = ENOMEM;
+			return -1;
+		}
+		poll_fds = fds;
+		for (int i = 0; i < server_fds_count; i++) {
+			poll_fds[i].fd = server_fds[i]->fd;
+			poll_fds[i].events = POLLIN;
+		}
+		poll_fds_count = server_fds_count;
+		server_fds_changed = false;
+	}
+
+	int n = poll(poll_fds, poll_fds_count, timeout_ms);
+	if (n <= 0)
+		return n;
+
+	int count = 0;
+	for (int i = 0; i < poll_fds_count && count < max_ready; i++) {
+		if (poll_fds[i].revents & POLLNVAL) {
+			errno = EBADF;
+			return -1;
+		}
+		if (poll_fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+			ready[count++] = server_fds[i];
+	}
+
+	return count;
+}
+
+static const struct server_event_backend poll_backend = {
+	.name = "poll",
+	.init = poll_backend_init,
+	.quit = poll_backend_quit,
+	.add = poll_backend_add,
+	.remove = poll_backend_remove,
+	.wait = poll_backend_wait,
+};
+
+#endif /* HAVE_POLL_H && !_WIN32 */
+
+static fd_set select_fds;
+static int select_fd_max;
+
+static int select_backend_init(void)
+{
+	return ERROR_OK;
+}
+
+static void select_backend_quit(void)
+{
+}
+
+static int select_backend_add(struct server_fd *sfd)
+{
+	return ERROR_OK;
+}
+
+static void select_backend_remove(struct server_fd *sfd)
+{
+}
+
+static int select_backend_wait(int timeout_ms, struct server_fd **ready, int max_ready)
+{
+	if (server_fds_changed) {
+		FD_ZERO(&select_fds);
+		select_fd_max = 0;
+		for (int i = 0; i < server_fds_count; i++) {
+			FD_SET(server_fds[i]->fd, &select_fds);
+			if (server_fds[i]->fd > select_fd_max)
+				select_fd_max = server_fds[i]->fd;
+		}
+		server_fds_changed = false;
+	}
+
+	fd_set read_fds = select_fds;
+	struct timeval tv;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	int n = socket_select(select_fd_max + 1, &read_fds, NULL, NULL, &tv);
+	if (n <= 0)
+		return n;
+
+	int count = 0;
+	for (int i = 0; i < server_fds_count && count < max_ready; i++) {
+		if (FD_ISSET(server_fds[i]->fd, &read_fds))
+			ready[count++] = server_fds[i];
+	}
+
+	return count;
+}
+
+static const struct server_event_backend select_backend = {
+	.name = "select",
+	.init = select_backend_init,
+	.quit = select_backend_quit,
+	.add = select_backend_add,
+	.remove = select_backend_remove,
+	.wait = select_backend_wait,
+};
+
+static const struct server_event_backend *event_backends[] = {
+#ifdef HAVE_SYS_EPOLL_H
+	&epoll_backend,
+#endif
+#if defined(HAVE_POLL_H) && !defined(_WIN32)
+	&poll_backend,
+#endif
+	&select_backend,
+	NULL,
+};
+
+static void server_fds_reap(void)
+{
+	while (server_fds_dead) {
+		struct server_fd *next = server_fds_dead->next_dead;
+		free(server_fds_dead);
+		server_fds_dead = next;
+	}
+}
+
+static void server_events_quit(void)
+{
+	server_fds_reap();
+
+	if (event_backend)
+		event_backend->quit();
+	event_backend = NULL;
+
+	free(server_fds);
+	server_fds = NULL;
+	free(server_fds_ready);
+	server_fds_ready = NULL;
+	server_fds_count = 0;
+	server_fds_size = 0;
+	server_fds_always_ready = 0;
+	server_fds_changed = true;
+}
+
+#define SERVER_FDS_INITIAL_SIZE 16
+
+static int server_events_init(void)
+{
+	server_fds = malloc(SERVER_FDS_INITIAL_SIZE * sizeof(*server_fds));
+	server_fds_ready = malloc(SERVER_FDS_INITIAL_SIZE * sizeof(*server_fds_ready));
+	if (!server_fds || !server_fds_ready) {
+		LOG_ERROR("Out of memory");
+		free(server_fds);
+		free(server_fds_ready);
+		server_fds = NULL;
+		server_fds_ready = NULL;
+		return ERROR_FAIL;
+	}
+	server_fds_size = SERVER_FDS_INITIAL_SIZE;
+	server_fds_changed = true;
+
+	for (unsigned i = 0; event_backends[i]; i++) {
+		if (event_backends[i]->init() == ERROR_OK) {
+			event_backend = event_backends[i];
+			LOG_DEBUG("using %s event backend", event_backend->name);
+			return ERROR_OK;
+		}
+	}
+
+	LOG_ERROR("no usable event backend");
+	server_events_quit();
+	return ERROR_FAIL;
+}
+
+static struct server_fd *server_fd_add(int fd, struct service *service,
+		struct connection *connection)
+{
+	if (!event_backend && server_events_init() != ERROR_OK)
+		return NULL;
+
+	if (server_fds_count == server_fds_size) {
+		int size = server_fds_size * 2;
+		struct server_fd **fds = realloc(server_fds, size * sizeof(*fds));
+		if (!fds)
+			goto error_alloc;
+		server_fds = fds;
+
+		struct server_fd **ready = realloc(server_fds_ready, size * sizeof(*ready));
+		if (!ready)
+			goto error_alloc;
+		server_fds_ready = ready;
+
+		server_fds_size = size;
+	}
+
+	struct server_fd *sfd = calloc(1, sizeof(struct server_fd));
+	if (!sfd)
+		goto error_alloc;
+
+	sfd->fd = fd;
+	sfd->service = service;
+	sfd->connection = connection;
+
+	if (event_backend->add(sfd) != ERROR_OK) {
+		free(sfd);
+		return NULL;
+	}
+
+	if (sfd->always_ready)
+		server_fds_always_ready++;
+
+	sfd->index = server_fds_count;
+	server_fds[server_fds_count++] = sfd;
+	server_fds_changed = true;
+
+	return sfd;
+
+error_alloc:
+	LOG_ERROR("Out of memory");
+	return NULL;
+}
+
+static void server_fd_remove(struct server_fd *sfd)
+{
+	if (!sfd)
+		return;
+
+	event_backend->remove(sfd);
+
+	if (sfd->always_ready)
+		server_fds_always_ready--;
+
+	server_fds[sfd->index] = server_fds[--server_fds_count];
+	server_fds[sfd->index]->index = sfd->index;
+	server_fds_changed = true;
+
+	/* a ready list may still point here, defer the free */
+	sfd->service = NULL;
+	sfd->connection = NULL;
+	sfd->next_dead = server_fds_dead;
+	server_fds_dead = sfd;
+}
+
+static int remove_connection(struct service *service, struct connection *connection);
+
 static int add_connection(struct service *service, struct command_context *cmd_ctx)
 {
 	socklen_t address_size;
@@ -77,6 +490,8 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	c->cmd_ctx = copy_command_context(cmd_ctx);
 	c->service = service;
 	c->input_pending = 0;
+	c->edge_triggered = false;
+	c->sfd = NULL;
 	c->priv = NULL;
 	c->next = NULL;
 
@@ -116,6 +531,8 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 #endif
 
 		/* do not check for new connections again on stdin */
+		server_fd_remove(service->sfd);
+		service->sfd = NULL;
 		service->fd = -1;
 
 		LOG_INFO("accepting '%s' connection from pipe", service->name);
@@ -129,6 +546,8 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	} else if (service->type == CONNECTION_PIPE) {
 		c->fd = service->fd;
 		/* do not check for new connections again on stdin */
+		server_fd_remove(service->sfd);
+		service->sfd = NULL;
 		service->fd = -1;
 
 		char *out_file = alloc_printf("%so", service->port);
@@ -159,6 +578,13 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
 		service->max_connections--;
 
+	c->sfd = server_fd_add(c->fd, service, c);
+	if (!c->sfd) {
+		LOG_ERROR("can't wait for input on '%s' connection", service->name);
+		remove_connection(service, c);
+		return ERROR_FAIL;
+	}
+
 	return ERROR_OK;
 }
 
@@ -171,11 +597,13 @@ static int remove_connection(struct service *service, struct connection *connect
 	while ((c = *p)) {
 		if (c->fd == connection->fd) {
 			service->connection_closed(c);
+			server_fd_remove(c->sfd);
 			if (service->type == CONNECTION_TCP)
 				close_socket(c->fd);
 			else if (service->type == CONNECTION_PIPE) {
 				/* The service will listen to the pipe again */
 				c->service->fd = c->fd;
+				c->service->sfd = server_fd_add(c->fd, c->service, NULL);
 			}
 
 			command_done(c->cmd_ctx);
@@ -222,6 +650,7 @@ int add_service(char *name,
 	c->port = strdup(port);
 	c->max_connections = 1;	/* Only TCP/IP ports can support more than one connection */
 	c->fd = -1;
+	c->sfd = NULL;
 	c->connections = NULL;
 	c->new_connection = new_connection_handler;
 	c->input = input_handler;
@@ -341,6 +770,14 @@ int add_service(char *name,
 #endif
 	}
 
+	c->sfd = server_fd_add(c->fd, c, NULL);
+	if (!c->sfd) {
+		if (c->type != CONNECTION_STDINOUT)
+			close_socket(c->fd);
+		free_service(c);
+		return ERROR_FAIL;
+	}
+
 	/* add to the end of linked list */
 	for (p = &services; *p; p = &(*p)->next)
 		;
@@ -380,6 +817,8 @@ int remove_service(const char *name, const char *port)
 			else
 				prev->next = tmp->next;
 
+			server_fd_remove(tmp->sfd);
+
 			if (tmp->type != CONNECTION_STDINOUT)
 				close_socket(tmp->fd);
 
@@ -403,6 +842,8 @@ static int remove_services(void)
 
 		remove_connections(c);
 
+		server_fd_remove(c->sfd);
+
 		if (c->name)
 			free(c->name);
 
@@ -428,17 +869,65 @@ static int remove_services(void)
 	return ERROR_OK;
 }
 
+static void server_accept(struct service *service, struct command_context *command_context)
+{
+	if (service->max_connections != 0) {
+		add_connection(service, command_context);
+		return;
+	}
+
+	if (service->type == CONNECTION_TCP) {
+		struct sockaddr_in sin;
+		socklen_t address_size = sizeof(sin);
+		int tmp_fd;
+		tmp_fd = accept(service->fd,
+				(struct sockaddr *)&service->sin,
+				&address_size);
+		close_socket(tmp_fd);
+	}
+	LOG_INFO("rejected '%s' connection, no more connections allowed",
+		service->name);
+}
+
+/* Data (or an EOF) left unread on an edge-triggered connection is not
+ * reported again */
+static bool server_input_available(struct connection *c)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct pollfd pfd = { .fd = c->fd, .events = POLLIN };
+
+	if (c->edge_triggered && poll(&pfd, 1, 0) == 1)
+		return pfd.revents & (POLLIN | POLLHUP | POLLERR);
+#endif
+	return false;
+}
+
+static void server_input(struct service *service, struct connection *c)
+{
+	int retval;
+
+	do {
+		retval = service->input(c);
+	} while (retval == ERROR_OK && server_input_available(c));
+	if (retval == ERROR_OK)
+		return;
+
+	if (service->type == CONNECTION_PIPE ||
+			service->type == CONNECTION_STDINOUT) {
+		/* if connection uses a pipe then
+		 * shutdown openocd on error */
+		shutdown_openocd = SHUTDOWN_REQUESTED;
+	}
+	remove_connection(service, c);
+	LOG_INFO("dropped '%s' connection", service->name);
+}
+
 int server_loop(struct command_context *command_context)
 {
 	struct service *service;
 
 	bool poll_ok = true;
 
-	/* used in select() */
-	fd_set read_fds;
-	int fd_max;
-
-	/* used in accept() */
 	int retval;
 
 #ifndef _WIN32
@@ -446,47 +935,30 @@ int server_loop(struct command_context *command_context)
 		LOG_ERROR("couldn't set SIGPIPE to SIG_IGN");
 #endif
 
-	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
-		/* monitor sockets for activity */
-		fd_max = 0;
-		FD_ZERO(&read_fds);
-
-		/* add service and connection fds to read_fds */
-		for (service = services; service; service = service->next) {
-			if (service->fd != -1) {
-				/* listen for new connections */
-				FD_SET(service->fd, &read_fds);
-
-				if (service->fd > fd_max)
-					fd_max = service->fd;
-			}
-
-			if (service->connections) {
-				struct connection *c;
+	if (!event_backend && server_events_init() != ERROR_OK)
+		return ERROR_FAIL;
 
-				for (c = service->connections; c; c = c->next) {
-					/* check for activity on the connection */
-					FD_SET(c->fd, &read_fds);
-					if (c->fd > fd_max)
-						fd_max = c->fd;
-				}
-			}
-		}
+	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
+		/* a handler may have registered a timer since the last round */
+		int64_t next_event = target_timer_next_event();
 
-		struct timeval tv;
-		tv.tv_sec = 0;
 		if (poll_ok) {
 			/* we're just polling this iteration, this is faster on embedded
 			 * hosts */
-			tv.tv_usec = 0;
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = event_backend->wait(0, server_fds_ready, server_fds_size);
 		} else {
-			/* Every 100ms, can be changed with "poll_period" command */
-			tv.tv_usec = polling_period * 1000;
+			/* Sleep until the next target timer is due, at most for
+			 * polling_period (100ms, can be changed with "poll_period") */
+			int64_t timeout_ms = next_event - timeval_ms();
+			if (timeout_ms < 0)
+				timeout_ms = 0;
+			else if (timeout_ms > polling_period)
+				timeout_ms = polling_period;
+
 			/* Only while we're sleeping we'll let others run */
 			openocd_sleep_prelude();
 			kept_alive();
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = event_backend->wait(timeout_ms, server_fds_ready, server_fds_size);
 			openocd_sleep_postlude();
 		}
 
@@ -496,38 +968,33 @@ int server_loop(struct command_context *command_context)
 			errno = WSAGetLastError();
 
 			if (errno == WSAEINTR)
-				FD_ZERO(&read_fds);
+				retval = 0;
 			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
+				LOG_ERROR("error during %s: %s", event_backend->name, strerror(errno));
 				return ERROR_FAIL;
 			}
 #else
 
 			if (errno == EINTR)
-				FD_ZERO(&read_fds);
+				retval = 0;
 			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
+				LOG_ERROR("error during %s: %s", event_backend->name, strerror(errno));
 				return ERROR_FAIL;
 			}
 #endif
 		}
 
-		if (retval == 0) {
-			/* We only execute these callbacks when there was nothing to do or we timed
-			 *out */
+		if (retval == 0 || timeval_ms() >= next_event) {
+			/* We execute these callbacks when there was nothing to do, when we
+			 * timed out, or when a timer became due despite constant activity */
 			target_call_timer_callbacks();
 			process_jim_events(command_context);
-
-			FD_ZERO(&read_fds);	/* eCos leaves read_fds unchanged in this case!  */
-
-			/* We timed out/there was nothing to do, timeout rather than poll next time
-			 **/
-			poll_ok = false;
-		} else {
-			/* There was something to do, next time we'll just poll */
-			poll_ok = true;
 		}
 
+		/* We timed out/there was nothing to do, timeout rather than poll next
+		 * time, otherwise there was something to do and we'll just poll */
+		poll_ok = retval != 0;
+
 		/* This is a simple back-off algorithm where we immediately
 		 * re-poll if we did something this time around.
 		 *
@@ -535,55 +1002,33 @@ int server_loop(struct command_context *command_context)
 		 */
 		poll_ok = poll_ok || target_got_message();
 
+		for (int i = 0; i < retval; i++) {
+			struct server_fd *sfd = server_fds_ready[i];
+
+			/* unregistered by a handler earlier in this round */
+			if (!sfd->service)
+				continue;
+
+			if (sfd->connection)
+				server_input(sfd->service, sfd->connection);
+			else
+				server_accept(sfd->service, command_context);
+		}
+
+		/* serve input that a handler has already buffered */
 		for (service = services; service; service = service->next) {
-			/* handle new connections on listeners */
-			if ((service->fd != -1)
-				&& (FD_ISSET(service->fd, &read_fds))) {
-				if (service->max_connections != 0)
-					add_connection(service, command_context);
-				else {
-					if (service->type == CONNECTION_TCP) {
-						struct sockaddr_in sin;
-						socklen_t address_size = sizeof(sin);
-						int tmp_fd;
-						tmp_fd = accept(service->fd,
-								(struct sockaddr *)&service->sin,
-								&address_size);
-						close_socket(tmp_fd);
-					}
-					LOG_INFO(
-						"rejected '%s' connection, no more connections allowed",
-						service->name);
-				}
-			}
+			struct connection *c;
 
-			/* handle activity on connections */
-			if (service->connections) {
-				struct connection *c;
-
-				for (c = service->connections; c; ) {
-					if ((FD_ISSET(c->fd, &read_fds)) || c->input_pending) {
-						retval = service->input(c);
-						if (retval != ERROR_OK) {
-							struct connection *next = c->next;
-							if (service->type == CONNECTION_PIPE ||
-									service->type == CONNECTION_STDINOUT) {
-								/* if connection uses a pipe then
-								 * shutdown openocd on error */
-								shutdown_openocd = SHUTDOWN_REQUESTED;
-							}
-							remove_connection(service, c);
-							LOG_INFO("dropped '%s' connection",
-								service->name);
-							c = next;
-							continue;
-						}
-					}
-					c = c->next;
-				}
+			for (c = service->connections; c; ) {
+				struct connection *next = c->next;
+				if (c->input_pending)
+					server_input(service, c);
+				c = next;
 			}
 		}
 
+		server_fds_reap();
+
 #ifdef _WIN32
 		MSG msg;
 		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
@@ -685,6 +1130,7 @@ int server_init(struct command_context *cmd_ctx)
 int server_quit(void)
 {
 	remove_services();
+	server_events_quit();
 	target_quit();
 
 #ifdef _WIN32
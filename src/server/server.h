@@ -43,6 +43,8 @@ enum connection_type {
 
 #define CONNECTION_LIMIT_UNLIMITED		(-1)
 
+struct server_fd;
+
 struct connection {
 	int fd;
 	int fd_out;	/* When using pipes we're writing to a different fd */
@@ -50,6 +52,11 @@ struct connection {
 	struct command_context *cmd_ctx;
 	struct service *service;
 	int input_pending;
+	/* Set by a new_connection handler of a high rate service; the server
+	 * then only reports the connection when new data arrives and calls
+	 * the input handler until all of it has been read (edge-triggered). */
+	bool edge_triggered;
+	struct server_fd *sfd;
 	void *priv;
 	struct connection *next;
 };
@@ -64,6 +71,7 @@ struct service {
 	char *port;
 	unsigned short portnumber;
 	int fd;
+	struct server_fd *sfd;
 	struct sockaddr_in sin;
 	int max_connections;
 	struct connection *connections;
@@ -33,6 +33,11 @@
 #include "svf.h"
 #include <helper/time_support.h>
 
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 /* SVF command */
 enum svf_command {
 	ENDDR,
@@ -206,23 +211,31 @@ struct svf_check_tdo_para {
 	int bit_len;		/* bit length to check */
 };
 
+/* initial number of check points, the array grows on demand so that TDO
+ * comparisons are only forced out together with the scan buffers */
 #define SVF_CHECK_TDO_PARA_SIZE 1024
 static struct svf_check_tdo_para *svf_check_tdo_para;
 static int svf_check_tdo_para_index;
+static int svf_check_tdo_para_size;
 
-static int svf_read_command_from_file(FILE *fd);
+static int svf_read_command_from_file(void);
 static int svf_check_tdo(void);
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len);
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
 static int svf_execute_tap(void);
 
 static FILE *svf_fd;
-static char *svf_read_line;
-static size_t svf_read_line_size;
+/* the whole svf file, mapped or read into memory */
+static const char *svf_file_data;
+static size_t svf_file_size;
+static size_t svf_file_pos;
+static bool svf_file_mapped;
+/* physical line holding the end of the last command, for logging */
+static const char *svf_read_line;
+static int svf_read_line_len;
 static char *svf_command_buffer;
 static size_t svf_command_buffer_size;
 static int svf_line_number;
-static int svf_getline(char **lineptr, size_t *n, FILE *stream);
 
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
 static uint8_t *svf_tdi_buffer, *svf_tdo_buffer, *svf_mask_buffer;
@@ -355,6 +368,124 @@ int svf_add_statemove(tap_state_t state_to)
 	return ERROR_FAIL;
 }
 
+/* read a stream of unknown size (pipe, FIFO, /dev/stdin) up to EOF */
+static int svf_read_stream(FILE *fd)
+{
+	size_t size = 0, alloc = 0;
+	char *data = NULL;
+
+	while (!feof(fd)) {
+		if (size == alloc) {
+			size_t new_alloc = alloc ? 2 * alloc : 64 * 1024;
+			char *ptr = realloc(data, new_alloc);
+			if (!ptr) {
+				LOG_ERROR("not enough memory");
+				free(data);
+				return ERROR_FAIL;
+			}
+			data = ptr;
+			alloc = new_alloc;
+		}
+		size += fread(data + size, 1, alloc - size, fd);
+		if (ferror(fd)) {
+			LOG_ERROR("fail to read svf file");
+			free(data);
+			return ERROR_FAIL;
+		}
+	}
+
+	if (size == 0) {
+		free(data);
+		data = NULL;
+	}
+	svf_file_data = data;
+	svf_file_size = size;
+
+	return ERROR_OK;
+}
+
+static int svf_load_file(FILE *fd)
+{
+	struct stat st;
+
+	if (fstat(fileno(fd), &st) != 0) {
+		LOG_ERROR("fail to get size of svf file: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	svf_file_pos = 0;
+	svf_file_mapped = false;
+
+	/* st_size is meaningless (usually 0) for anything but a regular file */
+	if (!S_ISREG(st.st_mode) || st.st_size == 0)
+		return svf_read_stream(fd);
+
+	svf_file_size = st.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+	void *map = mmap(NULL, svf_file_size, PROT_READ, MAP_PRIVATE, fileno(fd), 0);
+	if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+		madvise(map, svf_file_size, MADV_SEQUENTIAL);
+#endif
+		svf_file_data = map;
+		svf_file_mapped = true;
+		return ERROR_OK;
+	}
+#endif
+
+	/* regular file that can't be mapped (exotic file system, no mmap) */
+	char *data = malloc(svf_file_size);
+	if (!data) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+	if (fread(data, 1, svf_file_size, fd) != svf_file_size) {
+		LOG_ERROR("fail to read svf file");
+		free(data);
+		return ERROR_FAIL;
+	}
+	svf_file_data = data;
+
+	return ERROR_OK;
+}
+
+static void svf_unload_file(void)
+{
+	if (!svf_file_data)
+		return;
+
+#ifdef HAVE_SYS_MMAN_H
+	if (svf_file_mapped)
+		munmap((void *)svf_file_data, svf_file_size);
+	else
+#endif
+		free((void *)svf_file_data);
+
+	svf_file_data = NULL;
+	svf_file_size = 0;
+	svf_file_pos = 0;
+}
+
+static long svf_count_lines(void)
+{
+	const char *p = svf_file_data, *end = svf_file_data + svf_file_size;
+	long lines = 0;
+
+	while (p < end) {
+		p = memchr(p, '\n', end - p);
+		if (!p)
+			break;
+		p++;
+		lines++;
+	}
+	/* last line without terminating newline */
+	if (svf_file_size && svf_file_data[svf_file_size - 1] != '\n')
+		lines++;
+
+	return lines;
+}
+
 COMMAND_HANDLER(handle_svf_command)
 {
 #define SVF_MIN_NUM_OF_OPTIONS 1
@@ -398,7 +529,7 @@ COMMAND_HANDLER(handle_svf_command)
 				  "ignore_error") == 0) || (strcmp(CMD_ARGV[i], "-ignore_error") == 0))
 			svf_ignore_error = 1;
 		else {
-			svf_fd = fopen(CMD_ARGV[i], "r");
+			svf_fd = fopen(CMD_ARGV[i], "rb");
 			if (svf_fd == NULL) {
 				int err = errno;
 				command_print(CMD, "open(\"%s\"): %s", CMD_ARGV[i], strerror(err));
@@ -416,10 +547,18 @@ COMMAND_HANDLER(handle_svf_command)
 	time_measure_ms = timeval_ms();
 
 	/* init */
-	svf_line_number = 0;
+	svf_line_number = 1;
 	svf_command_buffer_size = 0;
+	svf_read_line = NULL;
+	svf_read_line_len = 0;
+
+	if (svf_load_file(svf_fd) != ERROR_OK) {
+		ret = ERROR_FAIL;
+		goto free_all;
+	}
 
 	svf_check_tdo_para_index = 0;
+	svf_check_tdo_para_size = SVF_CHECK_TDO_PARA_SIZE;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
 	if (NULL == svf_check_tdo_para) {
 		LOG_ERROR("not enough memory");
@@ -490,13 +629,11 @@ COMMAND_HANDLER(handle_svf_command)
 
 	if (svf_progress_enabled) {
 		/* Count total lines in file. */
-		while (!feof(svf_fd)) {
-			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
-			svf_total_lines++;
-		}
-		rewind(svf_fd);
+		svf_total_lines = svf_count_lines();
+		if (svf_total_lines == 0)
+			svf_total_lines = 1;
 	}
-	while (ERROR_OK == svf_read_command_from_file(svf_fd)) {
+	while (ERROR_OK == svf_read_command_from_file()) {
 		/* Log Output */
 		if (svf_quiet) {
 			if (svf_progress_enabled) {
@@ -509,9 +646,10 @@ COMMAND_HANDLER(handle_svf_command)
 		} else {
 			if (svf_progress_enabled) {
 				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
-				LOG_USER_N("%3d%%  %s", svf_percentage, svf_read_line);
+				LOG_USER_N("%3d%%  %.*s\n", svf_percentage,
+						svf_read_line_len, svf_read_line);
 			} else
-				LOG_USER_N("%s", svf_read_line);
+				LOG_USER_N("%.*s\n", svf_read_line_len, svf_read_line);
 		}
 		/* Run Command */
 		if (ERROR_OK != svf_run_command(CMD_CTX, svf_command_buffer)) {
@@ -542,6 +680,7 @@ COMMAND_HANDLER(handle_svf_command)
 
 free_all:
 
+	svf_unload_file();
 	fclose(svf_fd);
 	svf_fd = 0;
 
@@ -555,6 +694,7 @@ free_all:
 		free(svf_check_tdo_para);
 		svf_check_tdo_para = NULL;
 		svf_check_tdo_para_index = 0;
+		svf_check_tdo_para_size = 0;
 	}
 	if (svf_tdi_buffer) {
 		free(svf_tdi_buffer);
@@ -591,79 +731,72 @@ free_all:
 	return ret;
 }
 
-static int svf_getline(char **lineptr, size_t *n, FILE *stream)
+/* physical line around file offset pos, without line ending */
+static void svf_set_read_line(size_t pos)
 {
-#define MIN_CHUNK 16	/* Buffer is increased by this size each time as required */
-	size_t i = 0;
-
-	if (*lineptr == NULL) {
-		*n = MIN_CHUNK;
-		*lineptr = malloc(*n);
-		if (!*lineptr)
-			return -1;
-	}
-
-	(*lineptr)[0] = fgetc(stream);
-	while ((*lineptr)[i] != '\n') {
-		(*lineptr)[++i] = fgetc(stream);
-		if (feof(stream)) {
-			(*lineptr)[0] = 0;
-			return -1;
-		}
-		if ((i + 2) > *n) {
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
-		}
-	}
-
-	(*lineptr)[++i] = 0;
-
-	return sizeof(*lineptr);
+	const char *end = svf_file_data + svf_file_size;
+	const char *start = svf_file_data + pos;
+	const char *eol;
+
+	while (start > svf_file_data && start[-1] != '\n')
+		start--;
+	eol = memchr(svf_file_data + pos, '\n', end - (svf_file_data + pos));
+	if (!eol)
+		eol = end;
+	if (eol > start && eol[-1] == '\r')
+		eol--;
+
+	svf_read_line = start;
+	svf_read_line_len = eol - start;
 }
 
-#define SVFP_CMD_INC_CNT 1024
-static int svf_read_command_from_file(FILE *fd)
+/*
+ * Single pass over the in-memory file: comments are dropped, the command
+ * is upper-cased into svf_command_buffer and svf_line_number is kept on
+ * the line holding the terminating ';', so errors point at that line.
+ */
+static int svf_read_command_from_file(void)
 {
-	unsigned char ch;
-	int i = 0;
+	const char *data = svf_file_data;
+	size_t pos = svf_file_pos, size = svf_file_size;
 	size_t cmd_pos = 0;
-	int cmd_ok = 0, slash = 0;
+	char ch;
 
-	if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-		return ERROR_FAIL;
-	svf_line_number++;
-	ch = svf_read_line[0];
-	while (!cmd_ok && (ch != 0)) {
+	if (!svf_command_buffer) {
+		svf_command_buffer = malloc(256);
+		if (!svf_command_buffer) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		svf_command_buffer_size = 256;
+	}
+
+	while (pos < size) {
+		ch = data[pos++];
 		switch (ch) {
+			case '\0':
+				/* like the line based reader, a NUL byte ends the input */
+				LOG_WARNING("NUL byte in svf file at line %d, ignoring the rest", svf_line_number);
+				svf_file_pos = size;
+				return ERROR_FAIL;
 			case '!':
-				slash = 0;
-				if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-					return ERROR_FAIL;
-				svf_line_number++;
-				i = -1;
-				break;
 			case '/':
-				if (++slash == 2) {
-					slash = 0;
-					if (svf_getline(&svf_read_line, &svf_read_line_size,
-						svf_fd) <= 0)
-						return ERROR_FAIL;
-					svf_line_number++;
-					i = -1;
-				}
+				/* '!' and "//" start a comment, a lone '/' is dropped */
+				if (ch == '/' && (pos >= size || data[pos] != '/'))
+					break;
+				while (pos < size && data[pos] != '\n')
+					pos++;
 				break;
 			case ';':
-				slash = 0;
-				cmd_ok = 1;
-				break;
+				/* room for the terminating NUL is always kept */
+				svf_command_buffer[cmd_pos] = '\0';
+				svf_set_read_line(pos - 1);
+				svf_file_pos = pos;
+				return ERROR_OK;
 			case '\n':
 				svf_line_number++;
-				if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-					return ERROR_FAIL;
-				i = -1;
 				/* fallthrough */
 			case '\r':
-				slash = 0;
 				/* Don't save '\r' and '\n' if no data is parsed */
 				if (!cmd_pos)
 					break;
@@ -682,33 +815,31 @@ static int svf_read_command_from_file(FILE *fd)
 				 *  - terminating NUL ('\0')
 				 */
 				if (cmd_pos + 3 > svf_command_buffer_size) {
-					svf_command_buffer = realloc(svf_command_buffer, cmd_pos + 3);
-					svf_command_buffer_size = cmd_pos + 3;
-					if (svf_command_buffer == NULL) {
+					size_t new_size = 2 * svf_command_buffer_size;
+					char *ptr = realloc(svf_command_buffer, new_size);
+					if (ptr == NULL) {
 						LOG_ERROR("not enough memory");
 						return ERROR_FAIL;
 					}
+					svf_command_buffer = ptr;
+					svf_command_buffer_size = new_size;
 				}
 
 				/* insert a space before '(' */
 				if ('(' == ch)
 					svf_command_buffer[cmd_pos++] = ' ';
 
-				svf_command_buffer[cmd_pos++] = (char)toupper(ch);
+				svf_command_buffer[cmd_pos++] = (char)toupper((unsigned char)ch);
 
 				/* insert a space after ')' */
 				if (')' == ch)
 					svf_command_buffer[cmd_pos++] = ' ';
 				break;
 		}
-		ch = svf_read_line[++i];
 	}
 
-	if (cmd_ok) {
-		svf_command_buffer[cmd_pos] = '\0';
-		return ERROR_OK;
-	} else
-		return ERROR_FAIL;
+	svf_file_pos = pos;
+	return ERROR_FAIL;
 }
 
 static int svf_parse_cmd_string(char *str, int len, char **argus, int *num_of_argu)
@@ -890,9 +1021,16 @@ static int svf_check_tdo(void)
 
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len)
 {
-	if (svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE) {
-		LOG_ERROR("toooooo many operation undone");
-		return ERROR_FAIL;
+	if (svf_check_tdo_para_index >= svf_check_tdo_para_size) {
+		int new_size = 2 * svf_check_tdo_para_size;
+		struct svf_check_tdo_para *ptr = realloc(svf_check_tdo_para,
+				sizeof(struct svf_check_tdo_para) * new_size);
+		if (!ptr) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		svf_check_tdo_para = ptr;
+		svf_check_tdo_para_size = new_size;
 	}
 
 	svf_check_tdo_para[svf_check_tdo_para_index].line_num = svf_line_number;
@@ -1199,9 +1337,11 @@ XXR_common:
 							svf_para.tdr_para.len);
 					i += svf_para.tdr_para.len;
 
-					svf_add_check_para(1, svf_buffer_index, i);
+					if (ERROR_OK != svf_add_check_para(1, svf_buffer_index, i))
+						return ERROR_FAIL;
 				} else
-					svf_add_check_para(0, svf_buffer_index, i);
+					if (ERROR_OK != svf_add_check_para(0, svf_buffer_index, i))
+						return ERROR_FAIL;
 				field.num_bits = i;
 				field.out_value = &svf_tdi_buffer[svf_buffer_index];
 				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
@@ -1289,9 +1429,11 @@ XXR_common:
 							svf_para.tir_para.len);
 					i += svf_para.tir_para.len;
 
-					svf_add_check_para(1, svf_buffer_index, i);
+					if (ERROR_OK != svf_add_check_para(1, svf_buffer_index, i))
+						return ERROR_FAIL;
 				} else
-					svf_add_check_para(0, svf_buffer_index, i);
+					if (ERROR_OK != svf_add_check_para(0, svf_buffer_index, i))
+						return ERROR_FAIL;
 				field.num_bits = i;
 				field.out_value = &svf_tdi_buffer[svf_buffer_index];
 				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
@@ -1555,9 +1697,9 @@ XXR_common:
 		}
 	} else {
 		/* for fast executing, execute tap if necessary */
-		/* half of the buffer is for the next command */
-		if (((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT) ||
-				(svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) && \
+		/* half of the buffer is for the next command, TDO checks are
+		 * deferred until then however many scans they span */
+		if ((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT) && \
 				(((command != STATE) && (command != RUNTEST)) || \
 						((command == STATE) && (num_of_argu == 2))))
 			return svf_execute_tap();
@@ -570,6 +570,9 @@ static int aarch64_restore_one(struct target *target, int current,
 	if (!debug_execution)
 		target_free_all_working_areas(target);
 
+	/* page tables may change while running */
+	arm_mmu_walk_invalidate(&armv8->armv8_mmu.walk);
+
 	/* current = 1: continue on current pc, otherwise continue at <address> */
 	resume_pc = buf_get_u64(arm->pc->value, 0, 64);
 	if (!current)
@@ -2152,6 +2155,9 @@ static int aarch64_write_phys_memory(struct target *target,
 	int retval = ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (count && buffer) {
+		/* the write may hit a page table */
+		arm_mmu_walk_flush_tlb(&target_to_armv8(target)->armv8_mmu.walk);
+
 		/* write memory through APB-AP */
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
@@ -2179,6 +2185,10 @@ static int aarch64_write_memory(struct target *target, target_addr_t address,
 		if (retval != ERROR_OK)
 			return retval;
 	}
+
+	/* the write may hit a page table */
+	arm_mmu_walk_flush_tlb(&target_to_armv8(target)->armv8_mmu.walk);
+
 	return aarch64_write_cpu_memory(target, address, size, count, buffer);
 }
 
@@ -2371,6 +2381,18 @@ static int aarch64_init_target(struct command_context *cmd_ctx,
 	return ERROR_OK;
 }
 
+static int aarch64_mmu_walk_sync(struct target *target)
+{
+	struct armv8_cache_common *cache =
+		&target_to_armv8(target)->armv8_mmu.armv8_cache;
+
+	/* physical reads bypass the data cache the table walker may use */
+	if (cache->d_u_cache_enabled && cache->flush_all_data_cache)
+		return cache->flush_all_data_cache(target);
+
+	return ERROR_OK;
+}
+
 static int aarch64_init_arch_info(struct target *target,
 	struct aarch64_common *aarch64, struct adiv5_dap *dap)
 {
@@ -2385,6 +2407,8 @@ static int aarch64_init_arch_info(struct target *target,
 	armv8->post_debug_entry = aarch64_post_debug_entry;
 	armv8->pre_restore_context = NULL;
 	armv8->armv8_mmu.read_physical_memory = aarch64_read_phys_memory;
+	arm_mmu_walk_init(&armv8->armv8_mmu.walk, aarch64_read_phys_memory,
+			aarch64_mmu_walk_sync);
 
 	armv8_init_arch_info(target, armv8);
 	target_register_timer_callback(aarch64_handle_target_request, 1,
@@ -2438,9 +2462,51 @@ static int aarch64_mmu(struct target *target, int *enabled)
 static int aarch64_virt2phys(struct target *target, target_addr_t virt,
 			     target_addr_t *phys)
 {
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_mmu_walk *walk = &armv8->armv8_mmu.walk;
+
+	/* translation registers are read once per halt */
+	if (!walk->config_valid && target->state == TARGET_HALTED)
+		armv8_mmu_walk_setup(target);
+
+	if (arm_mmu_walk_translate(target, walk, virt, phys) == ERROR_OK)
+		return ERROR_OK;
+
 	return armv8_mmu_translate_va_pa(target, virt, phys, 1);
 }
 
+static int aarch64_pcsr_probe(struct target *target, struct arm_dpm_pcsr *pcsr)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	uint32_t eddevid;
+	int retval;
+
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_EDDEVID, &eddevid);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* EDDEVID.PCSample: 0b0010 and up implement EDPCSR */
+	if ((eddevid & 0xf) < 2) {
+		LOG_DEBUG("%s: no PC sample register", target_name(target));
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* EDPCSRlo only; samples are truncated to 32 bits like all others */
+	pcsr->ap = armv8->debug_ap;
+	pcsr->address = armv8->debug_base + CPUV8_DBG_EDPCSR;
+	pcsr->isa_encoded = false;
+	pcsr->offset = false;
+	return ERROR_OK;
+}
+
+static int aarch64_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	return arm_dpm_pcsr_profiling(target, aarch64_pcsr_probe, samples,
+			max_num_samples, num_samples, seconds);
+}
+
 /*
  * private target configuration items
  */
@@ -2811,4 +2877,5 @@ struct target_type aarch64_target = {
 	.write_phys_memory = aarch64_write_phys_memory,
 	.mmu = aarch64_mmu,
 	.virt2phys = aarch64_virt2phys,
+	.profiling = aarch64_profiling,
 };
@@ -443,6 +443,9 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 	return retval;
 }
 
+/* Upper bound on the DRW words queued by mem_ap_read() before running the queue */
+#define MEM_AP_READ_CHUNK_WORDS 4096
+
 /**
  * Synchronous read of a block of memory, using a specific access size.
  *
@@ -484,112 +487,104 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	if (ap->unaligned_access_bad && (adr % size != 0))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
-	 * over-allocation if packed transfers are going to be used, but determining the real need at
-	 * this point would be messy. */
-	uint32_t *read_buf = calloc(count, sizeof(uint32_t));
-	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
-	uint32_t *read_ptr = read_buf;
-	if (read_buf == NULL) {
+	if (count == 0)
+		return ERROR_OK;
+
+	/* The reads are queued and run in chunks of at most MEM_AP_READ_CHUNK_WORDS DRW words, so
+	 * the scratch memory stays bounded however much is read. The caller's buffer is filled
+	 * as each chunk completes. */
+	size_t pool_words = MIN(count, MEM_AP_READ_CHUNK_WORDS);
+	uint32_t *read_buf = malloc(pool_words * sizeof(uint32_t));
+	/* Number of useful bytes in each DRW word, 4 for packed transfers */
+	uint8_t *read_size = malloc(pool_words);
+	if (read_buf == NULL || read_size == NULL) {
 		LOG_ERROR("Failed to allocate read buffer");
+		free(read_buf);
+		free(read_size);
 		return ERROR_FAIL;
 	}
 
-	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
-	 * useful bytes it contains, and their location in the word, depends on the type of transfer
-	 * and alignment. */
-	while (nbytes > 0) {
-		uint32_t this_size = size;
-
-		/* Select packed transfer if possible */
-		if (addrinc && ap->packed_transfers && nbytes >= 4
-				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
-			this_size = 4;
-			retval = mem_ap_setup_csw(ap, csw_size | CSW_ADDRINC_PACKED);
-		} else {
-			retval = mem_ap_setup_csw(ap, csw_size | csw_addrincr);
-		}
-		if (retval != ERROR_OK)
-			break;
-
-		retval = mem_ap_setup_tar(ap, address);
-		if (retval != ERROR_OK)
-			break;
-
-		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, read_ptr++);
-		if (retval != ERROR_OK)
-			break;
-
-		nbytes -= this_size;
-		if (addrinc)
-			address += this_size;
+	uint32_t lane_address = adr;
+	while (nbytes > 0 && retval == ERROR_OK) {
+		uint32_t chunk_address = address;
+		size_t words = 0;
+
+		/* Queue up the reads of this chunk. Each read will store the entire DRW word in the
+		 * read buffer. How many useful bytes it contains, and their location in the word,
+		 * depends on the type of transfer and alignment. */
+		while (nbytes > 0 && words < pool_words) {
+			uint32_t this_size = size;
+
+			/* Select packed transfer if possible */
+			if (addrinc && ap->packed_transfers && nbytes >= 4
+					&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
+				this_size = 4;
+				retval = mem_ap_setup_csw(ap, csw_size | CSW_ADDRINC_PACKED);
+			} else {
+				retval = mem_ap_setup_csw(ap, csw_size | csw_addrincr);
+			}
+			if (retval != ERROR_OK)
+				break;
 
-		mem_ap_update_tar_cache(ap);
-	}
+			retval = mem_ap_setup_tar(ap, address);
+			if (retval != ERROR_OK)
+				break;
 
-	if (retval == ERROR_OK)
-		retval = dap_run(dap);
+			retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, &read_buf[words]);
+			if (retval != ERROR_OK)
+				break;
 
-	/* Restore state */
-	address = adr;
-	nbytes = size * count;
-	read_ptr = read_buf;
+			read_size[words++] = this_size;
+			nbytes -= this_size;
+			if (addrinc)
+				address += this_size;
 
-	/* If something failed, read TAR to find out how much data was successfully read, so we can
-	 * at least give the caller what we have. */
-	if (retval != ERROR_OK) {
-		uint32_t tar;
-		if (mem_ap_read_tar(ap, &tar) == ERROR_OK) {
-			/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
-			LOG_ERROR("Failed to read memory at 0x%08"PRIx32, tar);
-			if (nbytes > tar - address)
-				nbytes = tar - address;
-		} else {
-			LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
-			nbytes = 0;
+			mem_ap_update_tar_cache(ap);
 		}
-	}
 
-	/* Replay loop to populate caller's buffer from the correct word and byte lane */
-	while (nbytes > 0) {
-		uint32_t this_size = size;
-
-		if (addrinc && ap->packed_transfers && nbytes >= 4
-				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
-			this_size = 4;
+		if (retval == ERROR_OK)
+			retval = dap_run(dap);
+
+		/* If something failed, read TAR to find out how much data was successfully read, so we
+		 * can at least give the caller what we have. */
+		size_t chunk_bytes = address - chunk_address;
+		if (!addrinc) {
+			chunk_bytes = 0;
+			for (size_t i = 0; i < words; i++)
+				chunk_bytes += read_size[i];
 		}
-
-		if (dap->ti_be_32_quirks) {
-			switch (this_size) {
-			case 4:
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-				/* fallthrough */
-			case 2:
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-				/* fallthrough */
-			case 1:
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-			}
-		} else {
-			switch (this_size) {
-			case 4:
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
-				/* fallthrough */
-			case 2:
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
-				/* fallthrough */
-			case 1:
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
+		if (retval != ERROR_OK) {
+			uint32_t tar;
+			if (mem_ap_read_tar(ap, &tar) == ERROR_OK) {
+				/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
+				LOG_ERROR("Failed to read memory at 0x%08"PRIx32, tar);
+				if (chunk_bytes > tar - chunk_address)
+					chunk_bytes = tar - chunk_address;
+			} else {
+				LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
+				chunk_bytes = 0;
 			}
 		}
 
-		read_ptr++;
-		nbytes -= this_size;
+		/* Extract the bytes of this chunk from the correct word and byte lane */
+		for (size_t i = 0; i < words && chunk_bytes > 0; i++) {
+			uint32_t data = read_buf[i];
+			uint32_t this_size = MIN(read_size[i], chunk_bytes);
+
+			if (dap->ti_be_32_quirks) {
+				for (uint32_t j = 0; j < this_size; j++)
+					*buffer++ = data >> 8 * (3 - (lane_address++ & 3));
+			} else {
+				for (uint32_t j = 0; j < this_size; j++)
+					*buffer++ = data >> 8 * (lane_address++ & 3);
+			}
+
+			chunk_bytes -= this_size;
+		}
 	}
 
 	free(read_buf);
+	free(read_size);
 	return retval;
 }
 
@@ -27,6 +27,9 @@
 #include "breakpoints.h"
 #include "target_type.h"
 #include "arm_opcodes.h"
+#include "arm_adi_v5.h"
+#include "smp.h"
+#include <helper/time_support.h>
 
 
 /**
@@ -1135,3 +1138,141 @@ int arm_dpm_initialize(struct arm_dpm *dpm)
 
 	return ERROR_OK;
 }
+
+/* samples read from one PC sample register per MEM-AP transfer */
+#define PCSR_CHUNK_SAMPLES	1024
+
+static uint32_t arm_dpm_pcsr_to_pc(const struct arm_dpm_pcsr *pcsr, uint32_t value)
+{
+	if (!pcsr->isa_encoded)
+		return value & ~1;
+
+	switch (value & 3) {
+		case 0:		/* ARM */
+			return value - (pcsr->offset ? 8 : 0);
+		case 2:		/* Jazelle */
+			return value & ~3;
+		default:	/* Thumb, bit 1 is part of the address */
+			return (value & ~1) - (pcsr->offset ? 4 : 0);
+	}
+}
+
+/**
+ * Samples the PC sample registers of running cores in bulk, a chunk
+ * at a time from each core in turn, without halting any of them.
+ * Samples the hardware marks as unavailable (all ones, e.g. while a
+ * core is halted or in a prohibited state) are dropped.
+ */
+static int arm_dpm_pcsr_sample(struct target *target,
+		const struct arm_dpm_pcsr *pcsr, unsigned int num_pcsr,
+		uint32_t *samples, uint32_t max_num_samples,
+		uint32_t *num_samples, uint32_t seconds)
+{
+	struct timeval timeout, now;
+	uint32_t sample_count = 0;
+	unsigned int core = 0;
+	int retval = ERROR_OK;
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	LOG_INFO("Starting profiling. Sampling PCSR of %u core%s as fast as we can...",
+			num_pcsr, num_pcsr == 1 ? "" : "s");
+
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED) {
+		retval = target_resume(target, 1, 0, 0, 0);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while resuming target");
+			return retval;
+		}
+	}
+
+	while (sample_count < max_num_samples) {
+		const struct arm_dpm_pcsr *p = &pcsr[core];
+		uint32_t first = sample_count;
+		uint32_t read_count = max_num_samples - sample_count;
+		if (read_count > PCSR_CHUNK_SAMPLES)
+			read_count = PCSR_CHUNK_SAMPLES;
+
+		retval = mem_ap_read_buf_noincr(p->ap, (uint8_t *)&samples[first],
+				4, read_count, p->address);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while reading PCSR");
+			break;
+		}
+
+		/* compact in place; never writes ahead of what is read */
+		for (uint32_t i = 0; i < read_count; i++) {
+			uint32_t value = le_to_h_u32((uint8_t *)&samples[first + i]);
+			if (value == 0xffffffff)
+				continue;
+			samples[sample_count++] = arm_dpm_pcsr_to_pc(p, value);
+		}
+
+		core = (core + 1) % num_pcsr;
+		keep_alive();
+
+		gettimeofday(&now, NULL);
+		if (timeval_compare(&now, &timeout) >= 0)
+			break;
+	}
+
+	if (retval == ERROR_OK)
+		LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+
+	*num_samples = sample_count;
+	return retval;
+}
+
+/**
+ * Implements the profiling target method for cores with a PC sample
+ * register.  For an SMP group all examined cores which have one are
+ * sampled into the same set of samples.  Without any such register
+ * this falls back to halting and resuming the target.
+ */
+int arm_dpm_pcsr_profiling(struct target *target, arm_dpm_pcsr_probe_fn probe,
+		uint32_t *samples, uint32_t max_num_samples,
+		uint32_t *num_samples, uint32_t seconds)
+{
+	struct arm_dpm_pcsr *pcsr;
+	struct target_list *head;
+	unsigned int num_pcsr = 0;
+	unsigned int num_cores = 1;
+	int retval;
+
+	if (target->smp) {
+		num_cores = 0;
+		foreach_smp_target(head, target->head)
+			num_cores++;
+	}
+
+	pcsr = calloc(num_cores, sizeof(*pcsr));
+	if (!pcsr) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	if (target->smp) {
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
+			if (!target_was_examined(curr))
+				continue;
+			if (probe(curr, &pcsr[num_pcsr]) == ERROR_OK)
+				num_pcsr++;
+		}
+	} else if (probe(target, &pcsr[0]) == ERROR_OK) {
+		num_pcsr = 1;
+	}
+
+	if (num_pcsr == 0)
+		retval = target_profiling_default(target, samples, max_num_samples,
+				num_samples, seconds);
+	else
+		retval = arm_dpm_pcsr_sample(target, pcsr, num_pcsr, samples,
+				max_num_samples, num_samples, seconds);
+
+	free(pcsr);
+	return retval;
+}
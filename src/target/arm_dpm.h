@@ -241,4 +241,32 @@ void arm_dpm_report_dscr(struct arm_dpm *dpm, uint32_t dcsr);
 #define OSLSR_OSLM1                      (1 << 3)
 #define OSLSR_OSLM                       (OSLSR_OSLM0|OSLSR_OSLM1)
 
+struct adiv5_ap;
+
+/**
+ * Describes the PC sample register of a core (ARMv7 DBGPCSR or ARMv8
+ * EDPCSR) for arm_dpm_pcsr_profiling().
+ */
+struct arm_dpm_pcsr {
+	/** AP the debug registers are accessed through */
+	struct adiv5_ap *ap;
+	/** Address of the PC sample register on that AP */
+	uint32_t address;
+	/** Samples encode the instruction set in bits [1:0] (ARMv7) */
+	bool isa_encoded;
+	/** Samples carry the ARMv7 offset of +8 (ARM) or +4 (Thumb) */
+	bool offset;
+};
+
+/**
+ * Fills in the PC sample register description of a core.
+ * @returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if it has none.
+ */
+typedef int (*arm_dpm_pcsr_probe_fn)(struct target *target,
+		struct arm_dpm_pcsr *pcsr);
+
+int arm_dpm_pcsr_profiling(struct target *target, arm_dpm_pcsr_probe_fn probe,
+		uint32_t *samples, uint32_t max_num_samples,
+		uint32_t *num_samples, uint32_t seconds);
+
 #endif /* OPENOCD_TARGET_ARM_DPM_H */
@@ -0,0 +1,396 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/**
+ * @file
+ * Host side stage 1 translation table walker for ARMv7-A (short and long
+ * descriptors) and ARMv8-A (AArch64), with a small software TLB.
+ *
+ * Translating through the core's AT/ATS1 operations costs several DPM
+ * transactions per page; walking the tables costs one memory read per
+ * level and nothing at all once the result is in the TLB.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <helper/log.h>
+
+#include "arm_mmu_walk.h"
+#include "target.h"
+
+/* output address bits of long and AArch64 descriptors, PA[47:12] */
+#define ARM_MMU_OA_MASK		0x0000fffffffff000ULL
+
+void arm_mmu_walk_init(struct arm_mmu_walk *walk,
+		int (*read_phys)(struct target *target, target_addr_t address,
+			uint32_t size, uint32_t count, uint8_t *buffer),
+		int (*sync_tables)(struct target *target))
+{
+	memset(walk, 0, sizeof(*walk));
+	walk->read_phys = read_phys;
+	walk->sync_tables = sync_tables;
+}
+
+void arm_mmu_walk_flush_tlb(struct arm_mmu_walk *walk)
+{
+	for (unsigned int i = 0; i < ARM_MMU_TLB_ENTRIES; i++)
+		walk->tlb[i].valid = false;
+	walk->tlb_next = 0;
+}
+
+void arm_mmu_walk_invalidate(struct arm_mmu_walk *walk)
+{
+	arm_mmu_walk_flush_tlb(walk);
+	walk->config_valid = false;
+	walk->tables_synced = false;
+}
+
+void arm_mmu_walk_set_config(struct arm_mmu_walk *walk,
+		const struct arm_mmu_walk_config *config)
+{
+	if (walk->config_valid
+			&& walk->config.format == config->format
+			&& walk->config.tcr == config->tcr
+			&& walk->config.ttbr[0] == config->ttbr[0]
+			&& walk->config.ttbr[1] == config->ttbr[1]
+			&& walk->config.two_ranges == config->two_ranges)
+		return;
+
+	arm_mmu_walk_flush_tlb(walk);
+	walk->config = *config;
+	walk->config_valid = true;
+}
+
+static bool arm_mmu_tlb_lookup(struct arm_mmu_walk *walk, uint64_t va, uint64_t *pa)
+{
+	for (unsigned int i = 0; i < ARM_MMU_TLB_ENTRIES; i++) {
+		struct arm_mmu_tlb_entry *e = &walk->tlb[i];
+		uint64_t offset_mask;
+
+		if (!e->valid)
+			continue;
+		offset_mask = (1ULL << e->size_log2) - 1;
+		if ((va & ~offset_mask) == e->va) {
+			*pa = e->pa | (va & offset_mask);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void arm_mmu_tlb_insert(struct arm_mmu_walk *walk, uint64_t va,
+		uint64_t pa, unsigned int size_log2)
+{
+	struct arm_mmu_tlb_entry *e = &walk->tlb[walk->tlb_next];
+	uint64_t offset_mask = (1ULL << size_log2) - 1;
+
+	e->va = va & ~offset_mask;
+	e->pa = pa & ~offset_mask;
+	e->size_log2 = size_log2;
+	e->valid = true;
+	walk->tlb_next = (walk->tlb_next + 1) % ARM_MMU_TLB_ENTRIES;
+}
+
+static int arm_mmu_read_desc32(struct target *target, struct arm_mmu_walk *walk,
+		uint64_t address, uint32_t *desc)
+{
+	uint8_t buf[4];
+	int retval;
+
+	if ((target_addr_t)address != address)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = walk->read_phys(target, address, 4, 1, buf);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*desc = target_buffer_get_u32(target, buf);
+	return ERROR_OK;
+}
+
+static int arm_mmu_read_desc64(struct target *target, struct arm_mmu_walk *walk,
+		uint64_t address, uint64_t *desc)
+{
+	uint8_t buf[8];
+	int retval;
+
+	if ((target_addr_t)address != address)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = walk->read_phys(target, address, 4, 2, buf);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*desc = target_buffer_get_u64(target, buf);
+	return ERROR_OK;
+}
+
+/* ARMv7 short descriptor format, ARM DDI 0406C B3.5 */
+static int arm_mmu_walk_short(struct target *target, struct arm_mmu_walk *walk,
+		uint32_t va, uint64_t *pa, unsigned int *size_log2)
+{
+	uint32_t ttbcr = walk->config.tcr;
+	unsigned int n = ttbcr & 0x7;
+	uint32_t l1_addr, desc;
+	int retval;
+
+	if (n && (va >> (32 - n))) {
+		if (ttbcr & (1 << 5))	/* PD1 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		l1_addr = ((uint32_t)walk->config.ttbr[1] & 0xffffc000) | ((va >> 20) << 2);
+	} else {
+		if (ttbcr & (1 << 4))	/* PD0 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		l1_addr = ((uint32_t)walk->config.ttbr[0] & (0xffffffff << (14 - n)))
+			| (((va >> 20) & (0xfff >> n)) << 2);
+	}
+
+	retval = arm_mmu_read_desc32(target, walk, l1_addr, &desc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	switch (desc & 3) {
+	case 0:
+		return ERROR_TARGET_TRANSLATION_FAULT;
+	case 1:
+		/* page table */
+		break;
+	default:
+		if (desc & (1 << 18)) {
+			/* supersection, PA[39:32] in bits [8:5] and [23:20] */
+			*pa = (desc & 0xff000000)
+				| ((uint64_t)((desc >> 20) & 0xf) << 32)
+				| ((uint64_t)((desc >> 5) & 0xf) << 36)
+				| (va & 0x00ffffff);
+			*size_log2 = 24;
+		} else {
+			*pa = (desc & 0xfff00000) | (va & 0x000fffff);
+			*size_log2 = 20;
+		}
+		return ERROR_OK;
+	}
+
+	retval = arm_mmu_read_desc32(target, walk,
+			(desc & 0xfffffc00) | (((va >> 12) & 0xff) << 2), &desc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	switch (desc & 3) {
+	case 0:
+		return ERROR_TARGET_TRANSLATION_FAULT;
+	case 1:
+		*pa = (desc & 0xffff0000) | (va & 0xffff);
+		*size_log2 = 16;
+		break;
+	default:
+		*pa = (desc & 0xfffff000) | (va & 0xfff);
+		*size_log2 = 12;
+		break;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Long descriptor walk shared by LPAE and AArch64: @a ia_bits input
+ * address bits resolved in levels of granule_log2 - 3 bits each.
+ */
+static int arm_mmu_walk_lpae(struct target *target, struct arm_mmu_walk *walk,
+		uint64_t ttbr, unsigned int ia_bits, unsigned int granule_log2,
+		uint64_t va, uint64_t *pa, unsigned int *size_log2)
+{
+	unsigned int stride = granule_log2 - 3;
+	unsigned int start = 4 - DIV_ROUND_UP(ia_bits - granule_log2, stride);
+	unsigned int start_shift = granule_log2 + (3 - start) * stride;
+	uint64_t desc;
+	int retval;
+
+	/* the start level table is aligned to its size, which is below a
+	 * granule when it resolves only a few bits */
+	uint64_t table = ttbr & ~((1ULL << (ia_bits - start_shift + 3)) - 1);
+
+	for (unsigned int level = start; level <= 3; level++) {
+		unsigned int shift = granule_log2 + (3 - level) * stride;
+		unsigned int bits = (level == start) ? ia_bits - shift : stride;
+		uint64_t index = (va >> shift) & ((1ULL << bits) - 1);
+
+		retval = arm_mmu_read_desc64(target, walk, table + index * 8, &desc);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (!(desc & 1))
+			return ERROR_TARGET_TRANSLATION_FAULT;
+
+		if (level < 3 && (desc & 2)) {
+			/* next level table */
+			table = desc & ARM_MMU_OA_MASK & ~((1ULL << granule_log2) - 1);
+			continue;
+		}
+
+		/* block entries are not allowed at level 0, pages only at 3 */
+		if (level == 0 || (level == 3 && !(desc & 2)))
+			return ERROR_TARGET_TRANSLATION_FAULT;
+
+		*pa = (desc & ARM_MMU_OA_MASK & ~((1ULL << shift) - 1))
+			| (va & ((1ULL << shift) - 1));
+		*size_log2 = shift;
+		return ERROR_OK;
+	}
+
+	return ERROR_TARGET_TRANSLATION_FAULT;
+}
+
+/* ARMv7 long descriptor format, ARM DDI 0406C B3.6 */
+static int arm_mmu_walk_long(struct target *target, struct arm_mmu_walk *walk,
+		uint32_t va, uint64_t *pa, unsigned int *size_log2)
+{
+	uint32_t ttbcr = walk->config.tcr;
+	unsigned int t0sz = ttbcr & 0x7;
+	unsigned int t1sz = (ttbcr >> 16) & 0x7;
+	unsigned int tsz;
+	uint64_t ttbr;
+
+	if (t1sz && (va >> (32 - t1sz)) == (0xffffffffU >> (32 - t1sz))) {
+		if (ttbcr & (1 << 23))	/* EPD1 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		ttbr = walk->config.ttbr[1];
+		tsz = t1sz;
+	} else if (t0sz == 0 || (va >> (32 - t0sz)) == 0) {
+		if (ttbcr & (1 << 7))	/* EPD0 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		ttbr = walk->config.ttbr[0];
+		tsz = t0sz;
+	} else if (t1sz == 0) {
+		if (ttbcr & (1 << 23))	/* EPD1 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		ttbr = walk->config.ttbr[1];
+		tsz = 0;
+	} else
+		return ERROR_TARGET_TRANSLATION_FAULT;
+
+	return arm_mmu_walk_lpae(target, walk, ttbr & 0x000000ffffffffffULL,
+			32 - tsz, 12, va, pa, size_log2);
+}
+
+/* VMSAv8-64 stage 1, ARM DDI 0487 D5.2 */
+static int arm_mmu_walk_aarch64(struct target *target, struct arm_mmu_walk *walk,
+		uint64_t va, uint64_t *pa, unsigned int *size_log2)
+{
+	uint64_t tcr = walk->config.tcr;
+	unsigned int tsz, granule_log2;
+	uint64_t ttbr;
+	bool upper;
+
+	/* top byte ignore: bits [63:56] follow bit 55 for the range check */
+	if (walk->config.two_ranges) {
+		bool tbi = (va & (1ULL << 55)) ? (tcr >> 38) & 1 : (tcr >> 37) & 1;
+		if (tbi)
+			va = (va & (1ULL << 55)) ? va | (0xffULL << 56) : va & ~(0xffULL << 56);
+	} else if ((tcr >> 20) & 1) {
+		va &= ~(0xffULL << 56);
+	}
+
+	upper = walk->config.two_ranges && (va >> 63);
+	if (upper) {
+		static const unsigned int tg1_log2[] = { 0, 14, 12, 16 };
+
+		if (tcr & (1ULL << 23))	/* EPD1 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		tsz = (tcr >> 16) & 0x3f;
+		granule_log2 = tg1_log2[(tcr >> 30) & 3];
+		ttbr = walk->config.ttbr[1];
+	} else {
+		static const unsigned int tg0_log2[] = { 12, 16, 14, 0 };
+
+		if (walk->config.two_ranges && (tcr & (1 << 7)))	/* EPD0 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		tsz = tcr & 0x3f;
+		granule_log2 = tg0_log2[(tcr >> 14) & 3];
+		ttbr = walk->config.ttbr[0];
+	}
+
+	if (granule_log2 == 0)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* out of range values are treated as the nearest supported one */
+	tsz = MIN(MAX(tsz, 16U), 39U);
+
+	/* bits above the input range must all equal the range selector */
+	uint64_t top = va >> (64 - tsz);
+	if (top != (upper ? (1ULL << tsz) - 1 : 0))
+		return ERROR_TARGET_TRANSLATION_FAULT;
+
+	return arm_mmu_walk_lpae(target, walk, ttbr & 0x0000fffffffffffeULL,
+			64 - tsz, granule_log2, va, pa, size_log2);
+}
+
+int arm_mmu_walk_translate(struct target *target, struct arm_mmu_walk *walk,
+		uint64_t va, target_addr_t *pa)
+{
+	unsigned int size_log2 = 12;
+	uint64_t pa64;
+	int retval;
+
+	if (!walk->config_valid || walk->config.format == ARM_MMU_WALK_NONE || !walk->read_phys)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (arm_mmu_tlb_lookup(walk, va, &pa64)) {
+		*pa = pa64;
+		return ERROR_OK;
+	}
+
+	/* the walker of the core may see tables the debugger cannot yet */
+	if (!walk->tables_synced) {
+		if (walk->sync_tables) {
+			retval = walk->sync_tables(target);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		walk->tables_synced = true;
+	}
+
+	switch (walk->config.format) {
+	case ARM_MMU_WALK_SHORT:
+		retval = arm_mmu_walk_short(target, walk, va, &pa64, &size_log2);
+		break;
+	case ARM_MMU_WALK_LONG:
+		retval = arm_mmu_walk_long(target, walk, va, &pa64, &size_log2);
+		break;
+	case ARM_MMU_WALK_AARCH64:
+		retval = arm_mmu_walk_aarch64(target, walk, va, &pa64, &size_log2);
+		break;
+	default:
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		break;
+	}
+	if (retval != ERROR_OK)
+		return retval;
+
+	if ((target_addr_t)pa64 != pa64) {
+		LOG_DEBUG("PA 0x%" PRIx64 " beyond target address range", pa64);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	LOG_DEBUG("VA 0x%" PRIx64 " -> PA 0x%" PRIx64 " (%u bit mapping)", va, pa64, size_log2);
+
+	arm_mmu_tlb_insert(walk, va, pa64, size_log2);
+	*pa = pa64;
+
+	return ERROR_OK;
+}
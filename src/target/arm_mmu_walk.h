@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_ARM_MMU_WALK_H
+#define OPENOCD_TARGET_ARM_MMU_WALK_H
+
+#include <helper/types.h>
+
+struct target;
+
+/** Number of translations kept in the soft TLB. */
+#define ARM_MMU_TLB_ENTRIES	64
+
+enum arm_mmu_walk_format {
+	ARM_MMU_WALK_NONE,	/* no host side walk, use the core */
+	ARM_MMU_WALK_SHORT,	/* ARMv7 short descriptors */
+	ARM_MMU_WALK_LONG,	/* ARMv7 LPAE long descriptors */
+	ARM_MMU_WALK_AARCH64,	/* VMSAv8-64 stage 1 */
+};
+
+/** Translation registers, as read from the halted core. */
+struct arm_mmu_walk_config {
+	enum arm_mmu_walk_format format;
+	uint64_t tcr;		/* TTBCR or TCR_ELx */
+	uint64_t ttbr[2];	/* including ASID for the long formats */
+	bool two_ranges;	/* AArch64 only: TTBR1 covers the upper range (EL1) */
+};
+
+struct arm_mmu_tlb_entry {
+	uint64_t va;		/* aligned to the mapping size */
+	uint64_t pa;
+	uint8_t size_log2;
+	bool valid;
+};
+
+struct arm_mmu_walk {
+	struct arm_mmu_walk_config config;
+	bool config_valid;
+	/* the data cache has been cleaned since the config was loaded */
+	bool tables_synced;
+
+	struct arm_mmu_tlb_entry tlb[ARM_MMU_TLB_ENTRIES];
+	unsigned int tlb_next;
+
+	int (*read_phys)(struct target *target, target_addr_t address,
+			uint32_t size, uint32_t count, uint8_t *buffer);
+	/* optional, makes page tables in the data cache visible to read_phys */
+	int (*sync_tables)(struct target *target);
+};
+
+void arm_mmu_walk_init(struct arm_mmu_walk *walk,
+		int (*read_phys)(struct target *target, target_addr_t address,
+			uint32_t size, uint32_t count, uint8_t *buffer),
+		int (*sync_tables)(struct target *target));
+
+/** Forget cached translations, e.g. after memory has been written. */
+void arm_mmu_walk_flush_tlb(struct arm_mmu_walk *walk);
+
+/** Forget translations and registers, e.g. when the core resumes. */
+void arm_mmu_walk_invalidate(struct arm_mmu_walk *walk);
+
+/**
+ * Load the translation registers.  Cached translations are kept only
+ * if the registers (and thus tables and ASID) did not change.
+ */
+void arm_mmu_walk_set_config(struct arm_mmu_walk *walk,
+		const struct arm_mmu_walk_config *config);
+
+/**
+ * Translate @a va by walking the tables on the host.
+ *
+ * @returns ERROR_OK, ERROR_TARGET_TRANSLATION_FAULT if the tables do not
+ *	map @a va, or ERROR_TARGET_RESOURCE_NOT_AVAILABLE if no config has
+ *	been loaded; callers then fall back to the core's own translation.
+ */
+int arm_mmu_walk_translate(struct target *target, struct arm_mmu_walk *walk,
+		uint64_t va, target_addr_t *pa);
+
+#endif /* OPENOCD_TARGET_ARM_MMU_WALK_H */
@@ -210,6 +210,17 @@
 	(0xee000010 | (CRm) | ((op2) << 5) | ((CP) << 8) \
 	| ((Rd) << 12) | ((CRn) << 16) | ((op1) << 21))
 
+/* Move to two ARM registers from coprocessor (ARMv5TE)
+ * CP: Coprocessor number
+ * op1: Coprocessor opcode
+ * Rt: destination register, low word
+ * Rt2: destination register, high word
+ * CRm: coprocessor operand
+ */
+#define ARMV5_MRRC(CP, op1, Rt, Rt2, CRm) \
+	(0xec500000 | (CRm) | ((op1) << 4) | ((CP) << 8) \
+	| ((Rt) << 12) | ((Rt2) << 16))
+
 /* Breakpoint instruction (ARMv5)
  * Im: 16-bit immediate
  */
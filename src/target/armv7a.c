@@ -129,6 +129,7 @@ int armv7a_read_ttbcr(struct target *target)
 {
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct arm_dpm *dpm = armv7a->arm.dpm;
+	struct arm_mmu_walk_config walk_config = { 0 };
 	uint32_t ttbcr, ttbcr_n;
 	int ttbidx;
 	int retval;
@@ -157,8 +158,33 @@ int armv7a_read_ttbcr(struct target *target)
 				&armv7a->armv7a_mmu.ttbr[ttbidx]);
 		if (retval != ERROR_OK)
 			goto done;
+		walk_config.ttbr[ttbidx] = armv7a->armv7a_mmu.ttbr[ttbidx];
 	}
 
+	walk_config.format = ARM_MMU_WALK_SHORT;
+	walk_config.tcr = ttbcr;
+	if (ttbcr & (1U << 31)) {
+		/* TTBCR.EAE: long descriptors with 64 bit TTBRs */
+		walk_config.format = ARM_MMU_WALK_LONG;
+		for (ttbidx = 0; ttbidx < 2; ttbidx++) {
+			uint32_t lo, hi;
+
+			/* MRRC p15,ttbidx,r0,r1,c2 */
+			retval = dpm->instr_read_data_r0(dpm,
+					ARMV5_MRRC(15, ttbidx, 0, 1, 2),
+					&lo);
+			if (retval == ERROR_OK)
+				retval = dpm->instr_read_data_dcc(dpm,
+						ARMV4_5_MCR(14, 0, 1, 0, 5, 0),
+						&hi);
+			arm_reg_current(&armv7a->arm, 1)->dirty = true;
+			if (retval != ERROR_OK)
+				goto done;
+			walk_config.ttbr[ttbidx] = ((uint64_t)hi << 32) | lo;
+		}
+	}
+	arm_mmu_walk_set_config(&armv7a->armv7a_mmu.walk, &walk_config);
+
 	/*
 	 * ARM Architecture Reference Manual (ARMv7-A and ARMv7-Redition),
 	 * document # ARM DDI 0406C
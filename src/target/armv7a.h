@@ -24,6 +24,7 @@
 #include "armv4_5_mmu.h"
 #include "armv4_5_cache.h"
 #include "arm_dpm.h"
+#include "arm_mmu_walk.h"
 
 enum {
 	ARM_PC  = 15,
@@ -95,6 +96,8 @@ struct armv7a_mmu_common {
 			uint32_t count, uint8_t *buffer);
 	struct armv7a_cache_common armv7a_cache;
 	uint32_t mmu_enabled;
+	/* host side table walk and TLB for virt2phys */
+	struct arm_mmu_walk walk;
 };
 
 struct armv7a_common {
@@ -148,6 +151,8 @@ static inline bool is_armv7a(struct armv7a_common *armv7a)
 /* See ARMv7a arch spec section C10.3 */
 #define CPUDBG_WFAR		0x018
 /* PCSR at 0x084 -or- 0x0a0 -or- both ... based on flags in DIDR */
+#define CPUDBG_PCSR_V70		0x084
+#define CPUDBG_PCSR		0x0A0
 #define CPUDBG_DSCR		0x088
 #define CPUDBG_DRCR		0x090
 #define CPUDBG_PRCR		0x310
@@ -177,6 +182,8 @@ static inline bool is_armv7a(struct armv7a_common *armv7a)
 
 /* See ARMv7a arch spec section C10.8 */
 #define CPUDBG_AUTHSTATUS	0xFB8
+#define CPUDBG_DEVID1		0xFC4
+#define CPUDBG_DEVID		0xFC8
 
 /* Masks for Vector Catch register */
 #define DBG_VCR_FIQ_MASK	((1 << 31) | (1 << 7))
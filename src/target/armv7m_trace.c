@@ -24,34 +24,354 @@
 #include <target/cortex_m.h>
 #include <target/armv7m_trace.h>
 #include <jtag/interface.h>
+#include <helper/time_support.h>
+#include <server/server.h>
 
 #define TRACE_BUF_SIZE	4096
+/* Most chunks fetched from the adapter in one poll, so that high SWO
+ * rates are drained without waiting for the next timer tick */
+#define TRACE_MAX_CHUNKS	16
+
+#define TPIU_FRAME_SIZE		16
+#define TPIU_FULL_SYNC		0x7fffffff
+
+/* DWT hardware source packet carrying a periodic PC sample */
+#define DWT_DISCRIMINATOR_PC_SAMPLE	2
+
+/* DWT_CTRL fields used for PC sampling over the trace port */
+#define DWT_CTRL_CYCCNTENA		(1 << 0)
+#define DWT_CTRL_POSTPRESET_SHIFT	1
+#define DWT_CTRL_POSTPRESET_MASK	(0xf << DWT_CTRL_POSTPRESET_SHIFT)
+#define DWT_CTRL_CYCTAP			(1 << 9)
+#define DWT_CTRL_PCSAMPLENA		(1 << 12)
+/* One sample every 16 * 1024 cycles keeps a 2 MBaud SWO link below
+ * saturation at 100 MHz */
+#define DWT_PC_SAMPLE_POSTPRESET	15
+
+static void itm_flush_run(struct target *target, struct armv7m_trace_decoder *dec)
+{
+	if (!dec->run_size)
+		return;
+
+	for (struct armv7m_itm_sink *sink = dec->sinks[dec->run_port]; sink; sink = sink->next)
+		sink->fn(target, dec->run_port, dec->run, dec->run_size, sink->priv);
+
+	dec->run_size = 0;
+}
+
+static void itm_software_packet(struct target *target, struct armv7m_trace_decoder *dec,
+		unsigned int port)
+{
+	if (!dec->sinks[port])
+		return;
+
+	if (port != dec->run_port || dec->run_size + dec->payload_size > sizeof(dec->run)) {
+		itm_flush_run(target, dec);
+		dec->run_port = port;
+	}
+
+	memcpy(dec->run + dec->run_size, dec->payload, dec->payload_size);
+	dec->run_size += dec->payload_size;
+}
+
+static void itm_hardware_packet(struct target *target, struct armv7m_trace_decoder *dec,
+		unsigned int discriminator)
+{
+	/* 1 byte PC samples flag a sleeping core and carry no address */
+	if (discriminator != DWT_DISCRIMINATOR_PC_SAMPLE || dec->payload_size != 4)
+		return;
+
+	if (dec->pc_samples && dec->num_pc_samples < dec->max_pc_samples)
+		dec->pc_samples[dec->num_pc_samples++] = le_to_h_u32(dec->payload);
+}
+
+/* Feed one byte of the ITM/DWT packet stream to the parser */
+static void itm_parse_byte(struct target *target, struct armv7m_trace_decoder *dec,
+		uint8_t byte)
+{
+	if (dec->continuation) {
+		/* timestamp or extension payload, bit 7 flags more bytes */
+		dec->continuation = byte & 0x80;
+		return;
+	}
+
+	if (dec->header) {
+		dec->payload[dec->payload_pos++] = byte;
+		if (dec->payload_pos < dec->payload_size)
+			return;
+
+		unsigned int id = dec->header >> 3;
+		if (dec->header & 0x04)
+			itm_hardware_packet(target, dec, id);
+		else
+			itm_software_packet(target, dec, dec->page * 32 + id);
+
+		dec->header = 0;
+		return;
+	}
+
+	if (byte & 0x03) {
+		/* source packet, the low two bits encode 1, 2 or 4 bytes */
+		static const unsigned int sizes[] = { 0, 1, 2, 4 };
+
+		dec->header = byte;
+		dec->payload_size = sizes[byte & 0x03];
+		dec->payload_pos = 0;
+	} else if (byte == 0x00 || byte == 0x80 || byte == 0x70) {
+		/* synchronisation or overflow */
+	} else if ((byte & 0x0f) == 0x00) {
+		/* local timestamp */
+		dec->continuation = byte & 0x80;
+	} else if ((byte & 0xdf) == 0x94) {
+		/* global timestamp, always followed by more bytes */
+		dec->continuation = true;
+	} else if ((byte & 0x0b) == 0x08) {
+		/* extension, a single byte one with SH clear selects the
+		 * stimulus port page */
+		dec->continuation = byte & 0x80;
+		if (!dec->continuation && !(byte & 0x04))
+			dec->page = (byte >> 4) & 0x7;
+	}
+}
+
+static void tpiu_emit_byte(struct target *target, struct armv7m_trace_decoder *dec,
+		unsigned int id, uint8_t byte)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (id == armv7m->trace_config.trace_bus_id)
+		itm_parse_byte(target, dec, byte);
+}
+
+/* Split a formatter frame into the bytes of the trace sources */
+static void tpiu_deframe(struct target *target, struct armv7m_trace_decoder *dec)
+{
+	const uint8_t *frame = dec->frame;
+	uint8_t aux = frame[TPIU_FRAME_SIZE - 1];
+
+	for (unsigned int i = 0; i < TPIU_FRAME_SIZE - 1; i += 2) {
+		bool aux_bit = aux & (1 << (i / 2));
+		bool last = i == TPIU_FRAME_SIZE - 2;
+
+		if (frame[i] & 1) {
+			/* ID change; if the auxiliary bit is set the following
+			 * byte still belongs to the previous source */
+			unsigned int id = frame[i] >> 1;
+
+			if (!last && aux_bit)
+				tpiu_emit_byte(target, dec, dec->source_id, frame[i + 1]);
+			dec->source_id = id;
+			if (!last && !aux_bit)
+				tpiu_emit_byte(target, dec, dec->source_id, frame[i + 1]);
+		} else {
+			tpiu_emit_byte(target, dec, dec->source_id, frame[i] | aux_bit);
+			if (!last)
+				tpiu_emit_byte(target, dec, dec->source_id, frame[i + 1]);
+		}
+	}
+}
+
+static void armv7m_trace_decode(struct target *target, const uint8_t *buf, size_t size)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_trace_config *trace_config = &armv7m->trace_config;
+	struct armv7m_trace_decoder *dec = &trace_config->decoder;
+	bool formatter = trace_config->pin_protocol == TPIU_PIN_PROTOCOL_SYNC ||
+		trace_config->formatter;
+
+	for (size_t i = 0; i < size; i++) {
+		if (!formatter) {
+			itm_parse_byte(target, dec, buf[i]);
+			continue;
+		}
+
+		dec->frame[dec->frame_pos++ % TPIU_FRAME_SIZE] = buf[i];
+
+		/* A full synchronisation packet between frames realigns them */
+		if (dec->frame_pos >= 4 && (!dec->synced || dec->frame_pos == 4) &&
+				le_to_h_u32(&dec->frame[(dec->frame_pos - 4) % TPIU_FRAME_SIZE]) == TPIU_FULL_SYNC) {
+			dec->synced = true;
+			dec->frame_pos = 0;
+			continue;
+		}
+
+		if (!dec->synced) {
+			/* keep the last bytes only, to find the next sync */
+			if (dec->frame_pos == TPIU_FRAME_SIZE) {
+				memmove(dec->frame, dec->frame + TPIU_FRAME_SIZE - 3, 3);
+				dec->frame_pos = 3;
+			}
+			continue;
+		}
+
+		if (dec->frame_pos == TPIU_FRAME_SIZE) {
+			tpiu_deframe(target, dec);
+			dec->frame_pos = 0;
+		}
+	}
+
+	itm_flush_run(target, dec);
+}
+
+static bool armv7m_trace_decoding(struct armv7m_trace_decoder *dec)
+{
+	if (dec->pc_samples)
+		return true;
+
+	for (unsigned int i = 0; i < ITM_MAX_STIMULUS_PORTS; i++) {
+		if (dec->sinks[i])
+			return true;
+	}
+
+	return false;
+}
 
 static int armv7m_poll_trace(void *target)
 {
 	struct armv7m_common *armv7m = target_to_armv7m(target);
+	bool decode = armv7m_trace_decoding(&armv7m->trace_config.decoder);
 	uint8_t buf[TRACE_BUF_SIZE];
-	size_t size = sizeof(buf);
 	int retval;
 
-	retval = adapter_poll_trace(buf, &size);
-	if (retval != ERROR_OK || !size)
-		return retval;
+	for (unsigned int chunk = 0; chunk < TRACE_MAX_CHUNKS; chunk++) {
+		size_t size = sizeof(buf);
 
-	target_call_trace_callbacks(target, size, buf);
+		retval = adapter_poll_trace(buf, &size);
+		if (retval != ERROR_OK || !size)
+			return retval;
+
+		target_call_trace_callbacks(target, size, buf);
+
+		if (decode)
+			armv7m_trace_decode(target, buf, size);
 
-	if (armv7m->trace_config.trace_file != NULL) {
-		if (fwrite(buf, 1, size, armv7m->trace_config.trace_file) == size)
-			fflush(armv7m->trace_config.trace_file);
-		else {
-			LOG_ERROR("Error writing to the trace destination file");
-			return ERROR_FAIL;
+		if (armv7m->trace_config.trace_file != NULL) {
+			if (fwrite(buf, 1, size, armv7m->trace_config.trace_file) == size)
+				fflush(armv7m->trace_config.trace_file);
+			else {
+				LOG_ERROR("Error writing to the trace destination file");
+				return ERROR_FAIL;
+			}
 		}
+
+		/* the adapter had no more data buffered */
+		if (size < sizeof(buf))
+			break;
 	}
 
 	return ERROR_OK;
 }
 
+int armv7m_trace_register_itm_sink(struct target *target, unsigned int port,
+		armv7m_itm_sink_fn fn, void *priv)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_trace_decoder *dec = &armv7m->trace_config.decoder;
+
+	if (port >= ITM_MAX_STIMULUS_PORTS)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	struct armv7m_itm_sink *sink = malloc(sizeof(*sink));
+	if (!sink) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	sink->fn = fn;
+	sink->priv = priv;
+	sink->next = dec->sinks[port];
+	dec->sinks[port] = sink;
+
+	return ERROR_OK;
+}
+
+int armv7m_trace_unregister_itm_sink(struct target *target, unsigned int port,
+		armv7m_itm_sink_fn fn, void *priv)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_trace_decoder *dec = &armv7m->trace_config.decoder;
+
+	if (port >= ITM_MAX_STIMULUS_PORTS)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	for (struct armv7m_itm_sink **p = &dec->sinks[port]; *p; p = &(*p)->next) {
+		struct armv7m_itm_sink *sink = *p;
+
+		if (sink->fn == fn && sink->priv == priv) {
+			*p = sink->next;
+			free(sink);
+			return ERROR_OK;
+		}
+	}
+
+	return ERROR_FAIL;
+}
+
+int armv7m_trace_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_trace_decoder *dec = &armv7m->trace_config.decoder;
+	struct timeval timeout, now;
+	uint32_t dwt_ctrl;
+	int retval;
+
+	if (armv7m->trace_config.config_type != TRACE_CONFIG_TYPE_INTERNAL)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_read_u32(target, DWT_CTRL, &dwt_ctrl);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* ITM must forward DWT packets */
+	retval = armv7m_trace_itm_config(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_write_u32(target, DWT_CTRL,
+			(dwt_ctrl & ~(DWT_CTRL_POSTPRESET_MASK | DWT_CTRL_CYCTAP)) |
+			DWT_CTRL_CYCCNTENA | DWT_CTRL_CYCTAP | DWT_CTRL_PCSAMPLENA |
+			(DWT_PC_SAMPLE_POSTPRESET << DWT_CTRL_POSTPRESET_SHIFT));
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_INFO("Starting profiling. Collecting DWT PC samples from the trace port...");
+
+	dec->pc_samples = samples;
+	dec->max_pc_samples = max_num_samples;
+	dec->num_pc_samples = 0;
+
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED)
+		retval = target_resume(target, 1, 0, 0, 0);
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	while (retval == ERROR_OK) {
+		retval = armv7m_poll_trace(target);
+
+		gettimeofday(&now, NULL);
+		if (dec->num_pc_samples >= max_num_samples || timeval_compare(&now, &timeout) > 0)
+			break;
+
+		alive_sleep(1);
+	}
+
+	dec->pc_samples = NULL;
+	*num_samples = dec->num_pc_samples;
+
+	int retval2 = target_write_u32(target, DWT_CTRL, dwt_ctrl);
+	if (retval == ERROR_OK)
+		retval = retval2;
+
+	if (retval == ERROR_OK)
+		LOG_INFO("Profiling completed. %" PRIu32 " samples.", *num_samples);
+
+	return retval;
+}
+
 int armv7m_trace_tpiu_config(struct target *target)
 {
 	struct armv7m_common *armv7m = target_to_armv7m(target);
@@ -61,6 +381,14 @@ int armv7m_trace_tpiu_config(struct target *target)
 
 	target_unregister_timer_callback(armv7m_poll_trace, target);
 
+	/* The stream starts over, find the frame alignment again */
+	struct armv7m_trace_decoder *dec = &trace_config->decoder;
+	dec->synced = false;
+	dec->frame_pos = 0;
+	dec->header = 0;
+	dec->continuation = false;
+	dec->page = 0;
+	dec->run_size = 0;
 
 	retval = adapter_config_trace(trace_config->config_type == TRACE_CONFIG_TYPE_INTERNAL,
 				      trace_config->pin_protocol,
@@ -301,6 +629,111 @@ COMMAND_HANDLER(handle_itm_ports_command)
 		return ERROR_OK;
 }
 
+struct itm_service {
+	struct target *target;
+	unsigned int port;
+};
+
+static int itm_connection_write(struct target *target, unsigned int port,
+		const uint8_t *data, size_t size, void *priv)
+{
+	struct connection *connection = priv;
+
+	if (connection_write(connection, data, size) < 0)
+		LOG_DEBUG("itm: failed to send data of stimulus port %u", port);
+
+	return ERROR_OK;
+}
+
+static int itm_new_connection(struct connection *connection)
+{
+	struct itm_service *service = connection->service->priv;
+
+	connection->edge_triggered = true;
+	return armv7m_trace_register_itm_sink(service->target, service->port,
+			itm_connection_write, connection);
+}
+
+static int itm_input(struct connection *connection)
+{
+	uint8_t buffer[64];
+	int bytes_read;
+
+	/* stimulus ports are output only, just notice the client leaving */
+	bytes_read = connection_read(connection, buffer, sizeof(buffer));
+	if (bytes_read == 0)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	else if (bytes_read < 0) {
+		LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	return ERROR_OK;
+}
+
+static int itm_connection_closed(struct connection *connection)
+{
+	struct itm_service *service = connection->service->priv;
+
+	return armv7m_trace_unregister_itm_sink(service->target, service->port,
+			itm_connection_write, connection);
+}
+
+COMMAND_HANDLER(handle_itm_server_start_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct itm_service *service;
+	unsigned int port;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], port);
+	if (port >= ITM_MAX_STIMULUS_PORTS)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	service = malloc(sizeof(*service));
+	if (!service) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	service->target = target;
+	service->port = port;
+
+	int retval = add_service("itm", CMD_ARGV[0], CONNECTION_LIMIT_UNLIMITED,
+			itm_new_connection, itm_input, itm_connection_closed, service);
+	if (retval != ERROR_OK)
+		free(service);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_itm_server_stop_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return remove_service("itm", CMD_ARGV[0]);
+}
+
+static const struct command_registration itm_server_command_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_itm_server_start_command,
+		.mode = COMMAND_ANY,
+		.help = "Serve the decoded data of an ITM stimulus port on a TCP port",
+		.usage = "<tcp port> <stimulus port>",
+	},
+	{
+		.name = "stop",
+		.handler = handle_itm_server_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "Stop serving ITM data on a TCP port",
+		.usage = "<tcp port>",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 static const struct command_registration tpiu_command_handlers[] = {
 	{
 		.name = "config",
@@ -330,6 +763,13 @@ static const struct command_registration itm_command_handlers[] = {
 		.help = "Enable or disable all ITM stimulus ports",
 		.usage = "(0|1|on|off)",
 	},
+	{
+		.name = "server",
+		.mode = COMMAND_ANY,
+		.help = "itm server command group",
+		.usage = "",
+		.chain = itm_server_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
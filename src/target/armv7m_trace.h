@@ -45,6 +45,56 @@ enum itm_ts_prescaler {
 	ITM_TS_PRESCALE64,	/**< refclock divided by 64 for the timestamp counter */
 };
 
+#define ITM_MAX_STIMULUS_PORTS	256
+
+/**
+ * Receives the payload of ITM software packets of one stimulus port, as
+ * decoded from the trace stream.
+ */
+typedef int (*armv7m_itm_sink_fn)(struct target *target, unsigned int port,
+		const uint8_t *data, size_t size, void *priv);
+
+struct armv7m_itm_sink {
+	armv7m_itm_sink_fn fn;
+	void *priv;
+	struct armv7m_itm_sink *next;
+};
+
+/**
+ * State of the streaming TPIU deframer and ITM/DWT packet parser, which
+ * runs on every chunk of trace data that is polled from the adapter.
+ */
+struct armv7m_trace_decoder {
+	/** Frame alignment found by a full synchronisation packet */
+	bool synced;
+	uint8_t frame[16];
+	unsigned int frame_pos;
+	/** Trace source ID of the data currently being deframed */
+	unsigned int source_id;
+
+	/** Header of the ITM packet being parsed, 0 if none */
+	uint8_t header;
+	/** Packet has continuation bytes until one has bit 7 clear */
+	bool continuation;
+	unsigned int payload_size;
+	unsigned int payload_pos;
+	uint8_t payload[4];
+	/** Stimulus port page set by the last extension packet */
+	unsigned int page;
+
+	/** Software packet payload collected for one port, sent in one go */
+	unsigned int run_port;
+	size_t run_size;
+	uint8_t run[256];
+
+	/** Destination of DWT PC samples while profiling */
+	uint32_t *pc_samples;
+	uint32_t max_pc_samples;
+	uint32_t num_pc_samples;
+
+	struct armv7m_itm_sink *sinks[ITM_MAX_STIMULUS_PORTS];
+};
+
 struct armv7m_trace_config {
 	/** Currently active trace capture mode */
 	enum trace_config_type config_type;
@@ -75,6 +125,9 @@ struct armv7m_trace_config {
 	unsigned int trace_freq;
 	/** Handle to output trace data in INTERNAL capture mode */
 	FILE *trace_file;
+
+	/** Decoder for trace data captured in INTERNAL mode */
+	struct armv7m_trace_decoder decoder;
 };
 
 extern const struct command_registration armv7m_trace_command_handlers[];
@@ -88,4 +141,16 @@ int armv7m_trace_tpiu_config(struct target *target);
  */
 int armv7m_trace_itm_config(struct target *target);
 
+int armv7m_trace_register_itm_sink(struct target *target, unsigned int port,
+		armv7m_itm_sink_fn fn, void *priv);
+int armv7m_trace_unregister_itm_sink(struct target *target, unsigned int port,
+		armv7m_itm_sink_fn fn, void *priv);
+/**
+ * Collect PC samples sent by the DWT over the trace port, for use by the
+ * profile command.  Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if trace
+ * data is not captured by OpenOCD.
+ */
+int armv7m_trace_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
+
 #endif /* OPENOCD_TARGET_ARMV7M_TRACE_H */
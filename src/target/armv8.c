@@ -914,6 +914,91 @@ done:
 	return retval;
 }
 
+/*
+ * Read the stage 1 translation registers of the current exception level
+ * for the host side table walk.  AArch32 state, and EL1/EL0 with stage 2
+ * translation enabled, are left to the AT instructions of the core.
+ */
+int armv8_mmu_walk_setup(struct target *target)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_dpm *dpm = armv8->arm.dpm;
+	struct arm *arm = &armv8->arm;
+	struct arm_mmu_walk_config config = { .format = ARM_MMU_WALK_NONE };
+	uint64_t hcr = 0;
+	int retval;
+
+	if (target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	if (!armv8->armv8_mmu.mmu_enabled || arm->core_state != ARM_STATE_AARCH64) {
+		arm_mmu_walk_set_config(&armv8->armv8_mmu.walk, &config);
+		return ERROR_OK;
+	}
+
+	retval = dpm->prepare(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	switch (armv8_curel_from_core_mode(arm->core_mode)) {
+	case SYSTEM_CUREL_EL3:
+		retval = dpm->instr_read_data_r0_64(dpm,
+				ARMV8_MRS(SYSTEM_TCR_EL3, 0), &config.tcr);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TTBR0_EL3, 0), &config.ttbr[0]);
+		break;
+	case SYSTEM_CUREL_EL2:
+		retval = dpm->instr_read_data_r0_64(dpm,
+				ARMV8_MRS(SYSTEM_TCR_EL2, 0), &config.tcr);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TTBR0_EL2, 0), &config.ttbr[0]);
+		break;
+	case SYSTEM_CUREL_EL0:
+	case SYSTEM_CUREL_EL1:
+		/* stage 2 is only visible from EL2 */
+		retval = armv8_dpm_modeswitch(dpm, ARMV8_64_EL2H);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_HCR_EL2, 0), &hcr);
+		if (retval == ERROR_OK)
+			retval = armv8_dpm_modeswitch(dpm, ARMV8_64_EL1H);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TCR_EL1, 0), &config.tcr);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TTBR0_EL1, 0), &config.ttbr[0]);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TTBR1_EL1, 0), &config.ttbr[1]);
+		config.two_ranges = true;
+		break;
+	default:
+		retval = ERROR_FAIL;
+		break;
+	}
+
+	armv8_dpm_modeswitch(dpm, ARM_MODE_ANY);
+	dpm->finish(dpm);
+
+	/* HCR_EL2.VM: tables hold intermediate physical addresses */
+	if (retval == ERROR_OK && !(hcr & 1))
+		config.format = ARM_MMU_WALK_AARCH64;
+	else
+		config.format = ARM_MMU_WALK_NONE;
+
+	LOG_DEBUG("%s: tcr %" PRIx64 " ttbr0 %" PRIx64 " ttbr1 %" PRIx64 "%s",
+			target_name(target), config.tcr, config.ttbr[0], config.ttbr[1],
+			config.format == ARM_MMU_WALK_NONE ? ", not walked" : "");
+
+	/* don't retry on failure until the next halt */
+	arm_mmu_walk_set_config(&armv8->armv8_mmu.walk, &config);
+
+	return retval;
+}
+
 /*  method adapted to cortex A : reused arm v4 v5 method*/
 int armv8_mmu_translate_va(struct target *target,  target_addr_t va, target_addr_t *val)
 {
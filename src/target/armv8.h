@@ -25,6 +25,7 @@
 #include "armv4_5_cache.h"
 #include "armv8_dpm.h"
 #include "arm_cti.h"
+#include "arm_mmu_walk.h"
 
 enum {
 	ARMV8_R0 = 0,
@@ -187,6 +188,8 @@ struct armv8_mmu_common {
 			uint32_t size, uint32_t count, uint8_t *buffer);
 	struct armv8_cache_common armv8_cache;
 	uint32_t mmu_enabled;
+	/* host side table walk and TLB for virt2phys */
+	struct arm_mmu_walk walk;
 };
 
 struct armv8_common {
@@ -259,6 +262,7 @@ static inline bool is_armv8(struct armv8_common *armv8)
 #define CPUV8_DBG_EDECR		0x24
 #define CPUV8_DBG_WFAR0		0x30
 #define CPUV8_DBG_WFAR1		0x34
+#define CPUV8_DBG_EDPCSR	0x0A0
 #define CPUV8_DBG_DSCR		0x088
 #define CPUV8_DBG_DRCR		0x090
 #define CPUV8_DBG_ECCR		0x098
@@ -279,6 +283,7 @@ static inline bool is_armv8(struct armv8_common *armv8)
 #define CPUV8_DBG_OSLAR		0x300
 
 #define CPUV8_DBG_AUTHSTATUS	0xFB8
+#define CPUV8_DBG_EDDEVID	0xFC8
 
 #define PAGE_SIZE_4KB				0x1000
 #define PAGE_SIZE_4KB_LEVEL0_BITS	39
@@ -300,6 +305,7 @@ int armv8_init_arch_info(struct target *target, struct armv8_common *armv8);
 int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 		target_addr_t *val, int meminfo);
 int armv8_mmu_translate_va(struct target *target,  target_addr_t va, target_addr_t *val);
+int armv8_mmu_walk_setup(struct target *target);
 
 int armv8_handle_cache_info_command(struct command_invocation *cmd,
 		struct armv8_cache_common *armv8_cache);
@@ -94,6 +94,8 @@
 #define SYSTEM_TTBR0_EL3		0b1111000100000000
 #define SYSTEM_TTBR1_EL1		0b1100000100000001
 
+#define SYSTEM_HCR_EL2			0b1110000010001000
+
 /* ARMv8 address translation */
 #define SYSTEM_PAR_EL1			0b1100001110100000
 #define SYSTEM_ATS12E0R			0b0110001111000110
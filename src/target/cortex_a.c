@@ -795,6 +795,9 @@ static int cortex_a_internal_restore(struct target *target, int current,
 	if (!debug_execution)
 		target_free_all_working_areas(target);
 
+	/* page tables may change while running */
+	arm_mmu_walk_invalidate(&armv7a->armv7a_mmu.walk);
+
 #if 0
 	if (debug_execution) {
 		/* Disable interrupts */
@@ -2535,6 +2538,9 @@ static int cortex_a_write_phys_memory(struct target *target,
 	LOG_DEBUG("Writing memory to real address " TARGET_ADDR_FMT "; size %" PRId32 "; count %" PRId32,
 		address, size, count);
 
+	/* the write may hit a page table */
+	arm_mmu_walk_flush_tlb(&target_to_armv7a(target)->armv7a_mmu.walk);
+
 	/* write memory through the CPU */
 	cortex_a_prep_memaccess(target, 1);
 	retval = cortex_a_write_cpu_memory(target, address, size, count, buffer);
@@ -2555,6 +2561,9 @@ static int cortex_a_write_memory(struct target *target, target_addr_t address,
 	/* memory writes bypass the caches, must flush before writing */
 	armv7a_cache_auto_flush_on_write(target, address, size * count);
 
+	/* the write may hit a page table */
+	arm_mmu_walk_flush_tlb(&target_to_armv7a(target)->armv7a_mmu.walk);
+
 	cortex_a_prep_memaccess(target, 0);
 	retval = cortex_a_write_cpu_memory(target, address, size, count, buffer);
 	cortex_a_post_memaccess(target, 0);
@@ -2845,6 +2854,18 @@ static int cortex_a_init_target(struct command_context *cmd_ctx,
 	return ERROR_OK;
 }
 
+static int cortex_a_mmu_walk_sync(struct target *target)
+{
+	struct armv7a_cache_common *cache =
+		&target_to_armv7a(target)->armv7a_mmu.armv7a_cache;
+
+	/* physical reads bypass the data cache the table walker may use */
+	if (cache->d_u_cache_enabled && cache->flush_all_data_cache)
+		return cache->flush_all_data_cache(target);
+
+	return ERROR_OK;
+}
+
 static int cortex_a_init_arch_info(struct target *target,
 	struct cortex_a_common *cortex_a, struct adiv5_dap *dap)
 {
@@ -2862,6 +2883,8 @@ static int cortex_a_init_arch_info(struct target *target,
 	armv7a->pre_restore_context = NULL;
 
 	armv7a->armv7a_mmu.read_physical_memory = cortex_a_read_phys_memory;
+	arm_mmu_walk_init(&armv7a->armv7a_mmu.walk, cortex_a_read_phys_memory,
+			cortex_a_mmu_walk_sync);
 
 
 /*	arm7_9->handle_target_request = cortex_a_handle_target_request; */
@@ -2976,6 +2999,12 @@ static int cortex_a_virt2phys(struct target *target,
 		return ERROR_OK;
 	}
 
+	/* walk the tables read at debug entry, unless they need the core */
+	retval = arm_mmu_walk_translate(target,
+			&target_to_armv7a(target)->armv7a_mmu.walk, virt, phys);
+	if (retval == ERROR_OK)
+		return ERROR_OK;
+
 	/* mmu must be enable in order to get a correct translation */
 	retval = cortex_a_mmu_modify(target, 1);
 	if (retval != ERROR_OK)
@@ -2984,6 +3013,56 @@ static int cortex_a_virt2phys(struct target *target,
 						    phys, 1);
 }
 
+static int cortex_a_pcsr_probe(struct target *target, struct arm_dpm_pcsr *pcsr)
+{
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+	uint32_t didr, devid, devid1;
+	int retval;
+
+	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_DIDR, &didr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	pcsr->ap = armv7a->debug_ap;
+	pcsr->isa_encoded = true;
+
+	/* v7.1 Debug describes the sample register in DBGDEVID/DBGDEVID1 */
+	if (((didr >> 16) & 0xf) >= 5) {
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DEVID, &devid);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DEVID1, &devid1);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (devid & 0xf) {
+			pcsr->address = armv7a->debug_base + CPUDBG_PCSR;
+			pcsr->offset = (devid1 & 0xf) == 0;
+			return ERROR_OK;
+		}
+	}
+
+	/* v7 Debug: DBGPCSR shares its offset with DBGITR, samples are offset */
+	if (didr & (1 << 13)) {
+		pcsr->address = armv7a->debug_base + CPUDBG_PCSR_V70;
+		pcsr->offset = true;
+		return ERROR_OK;
+	}
+
+	LOG_DEBUG("%s: no PC sample register", target_name(target));
+	return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+}
+
+static int cortex_a_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	return arm_dpm_pcsr_profiling(target, cortex_a_pcsr_probe, samples,
+			max_num_samples, num_samples, seconds);
+}
+
 COMMAND_HANDLER(cortex_a_handle_cache_info_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -3162,6 +3241,7 @@ struct target_type cortexa_target = {
 	.write_phys_memory = cortex_a_write_phys_memory,
 	.mmu = cortex_a_mmu,
 	.virt2phys = cortex_a_virt2phys,
+	.profiling = cortex_a_profiling,
 };
 
 static const struct command_registration cortex_r4_exec_command_handlers[] = {
@@ -3234,4 +3314,5 @@ struct target_type cortexr4_target = {
 	.init_target = cortex_a_init_target,
 	.examine = cortex_a_examine,
 	.deinit_target = cortex_a_deinit_target,
+	.profiling = cortex_a_profiling,
 };
@@ -469,6 +469,168 @@ static int cortex_m_examine_exception_reason(struct target *target)
 	return retval;
 }
 
+/**
+ * Get the DCRSR register selectors backing a register of the cache.
+ * @returns the number of selectors (two for a double precision register),
+ * or zero if the register can't be read through DCRSR.
+ */
+static unsigned int cortex_m_reg_selectors(unsigned int num, uint32_t *regsel)
+{
+	switch (num) {
+		case 0 ... 18:
+			regsel[0] = num;
+			return 1;
+
+		case ARMV7M_PRIMASK:
+		case ARMV7M_BASEPRI:
+		case ARMV7M_FAULTMASK:
+		case ARMV7M_CONTROL:
+			/* packed as bitfields in one Debug Core register */
+			regsel[0] = 20;
+			return 1;
+
+		case ARMV7M_S0 ... ARMV7M_S31:
+			regsel[0] = num - ARMV7M_S0 + 0x40;
+			return 1;
+
+		case ARMV7M_D0 ... ARMV7M_D15:
+			regsel[0] = 2 * (num - ARMV7M_D0) + 0x40;
+			regsel[1] = regsel[0] + 1;
+			return 2;
+
+		case ARMV7M_FPSCR:
+			regsel[0] = 0x21;
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Read all invalid registers of the cache in a single DAP transaction.
+ *
+ * For each register a DCRSR write, a DHCSR read and a DCRDR read are
+ * queued.  The DHCSR read gives the core time to complete the transfer
+ * and tells whether it had; if S_REGRDY was ever clear, nothing is
+ * stored in the cache and ERROR_TIMEOUT_REACHED is returned so the
+ * caller can fall back to reading registers one by one.
+ */
+static int cortex_m_fast_read_all_regs(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+	struct reg_cache *cache = armv7m->arm.core_cache;
+	uint32_t r_vals[2 * ARMV7M_LAST_REG];
+	uint32_t dhcsr[2 * ARMV7M_LAST_REG];
+	unsigned int first[ARMV7M_LAST_REG];
+	unsigned int n_sel = 0;
+	unsigned int packed = 0;
+	bool packed_queued = false;
+	uint32_t dcrdr;
+	uint32_t regsel[2];
+	int retval;
+
+	/* because the DCB_DCRDR is used for the emulated dcc channel
+	 * we have to save/restore the DCB_DCRDR when used */
+	if (target->dbg_msg_enabled) {
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	assert(cache->num_regs <= ARMV7M_LAST_REG);
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		struct reg *r = &cache->reg_list[i];
+		struct arm_reg *arm_reg = r->arch_info;
+
+		if (r->valid)
+			continue;
+
+		unsigned int count = cortex_m_reg_selectors(arm_reg->num, regsel);
+		if (count == 1 && regsel[0] == 20) {
+			/* queue the packed special register only once */
+			if (packed_queued) {
+				first[i] = packed;
+				continue;
+			}
+			packed = n_sel;
+			packed_queued = true;
+		}
+
+		first[i] = n_sel;
+		for (unsigned int j = 0; j < count; j++, n_sel++) {
+			retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRSR, regsel[j]);
+			if (retval != ERROR_OK)
+				return retval;
+			retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &dhcsr[n_sel]);
+			if (retval != ERROR_OK)
+				return retval;
+			retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &r_vals[n_sel]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (target->dbg_msg_enabled) {
+		/* restore DCB_DCRDR - this needs to be in a separate
+		 * transaction otherwise the emulated DCC channel breaks */
+		retval = mem_ap_write_atomic_u32(armv7m->debug_ap, DCB_DCRDR, dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (unsigned int i = 0; i < n_sel; i++) {
+		if (!(dhcsr[i] & S_REGRDY)) {
+			LOG_DEBUG("register transfer %u not ready, DHCSR 0x%08" PRIx32,
+					i, dhcsr[i]);
+			return ERROR_TIMEOUT_REACHED;
+		}
+	}
+
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		struct reg *r = &cache->reg_list[i];
+		struct arm_reg *arm_reg = r->arch_info;
+		uint32_t value;
+
+		if (r->valid)
+			continue;
+
+		unsigned int count = cortex_m_reg_selectors(arm_reg->num, regsel);
+		if (count == 0)
+			continue;
+
+		value = r_vals[first[i]];
+		switch (arm_reg->num) {
+			case ARMV7M_PRIMASK:
+				value &= 0x1;
+				break;
+			case ARMV7M_BASEPRI:
+				value = (value >> 8) & 0xff;
+				break;
+			case ARMV7M_FAULTMASK:
+				value = (value >> 16) & 0x1;
+				break;
+			case ARMV7M_CONTROL:
+				value = (value >> 24) & 0x3;
+				break;
+		}
+
+		buf_set_u32(r->value, 0, 32, value);
+		if (count == 2)
+			buf_set_u32(r->value + 4, 0, 32, r_vals[first[i] + 1]);
+
+		r->valid = true;
+		r->dirty = false;
+	}
+
+	return ERROR_OK;
+}
+
 static int cortex_m_debug_entry(struct target *target)
 {
 	int i;
@@ -498,6 +660,17 @@ static int cortex_m_debug_entry(struct target *target)
 	 * First load register accessible through core debug port */
 	int num_regs = arm->core_cache->num_regs;
 
+	if (!cortex_m->slow_register_read) {
+		retval = cortex_m_fast_read_all_regs(target);
+		if (retval == ERROR_TIMEOUT_REACHED) {
+			cortex_m->slow_register_read = true;
+			LOG_DEBUG("Switched to slow register read");
+		} else if (retval != ERROR_OK) {
+			return retval;
+		}
+	}
+
+	/* picks up anything the queued read skipped */
 	for (i = 0; i < num_regs; i++) {
 		r = &armv7m->arm.core_cache->reg_list[i];
 		if (!r->valid)
@@ -1788,6 +1961,75 @@ static int cortex_m_write_memory(struct target *target, target_addr_t address,
 	return mem_ap_write_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
+/* Largest number of words queued before flushing the DAP in a vector read */
+#define CORTEX_M_VECTOR_READ_WORDS 256
+
+static int cortex_m_read_memory_vector(struct target *target,
+	const struct target_memory_read *reads, unsigned int count)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	uint32_t words[CORTEX_M_VECTOR_READ_WORDS];
+	uint8_t bytes[4 * CORTEX_M_VECTOR_READ_WORDS];
+	unsigned int first = 0;
+	int retval;
+
+	while (first < count) {
+		unsigned int last;
+		unsigned int num_words = 0;
+
+		/* Queue every word touched by as many whole reads as fit */
+		for (last = first; last < count; last++) {
+			target_addr_t start = reads[last].address & ~(target_addr_t)3;
+			unsigned int len = (reads[last].address - start + reads[last].size + 3) / 4;
+
+			if (reads[last].size == 0)
+				continue;
+			if (num_words + len > CORTEX_M_VECTOR_READ_WORDS)
+				break;
+
+			for (unsigned int i = 0; i < len; i++) {
+				retval = mem_ap_read_u32(armv7m->debug_ap, start + 4 * i,
+						&words[num_words++]);
+				if (retval != ERROR_OK) {
+					/* don't leave reads into words[] queued */
+					dap_run(armv7m->debug_ap->dap);
+					return retval;
+				}
+			}
+		}
+
+		if (last == first) {
+			/* A single read larger than the queue, do it the usual way */
+			retval = target_read_buffer(target, reads[first].address,
+					reads[first].size, reads[first].buffer);
+			if (retval != ERROR_OK)
+				return retval;
+			first++;
+			continue;
+		}
+
+		retval = dap_run(armv7m->debug_ap->dap);
+		if (retval != ERROR_OK)
+			return retval;
+
+		target_buffer_set_u32_array(target, bytes, num_words, words);
+
+		uint8_t *p = bytes;
+		for (unsigned int i = first; i < last; i++) {
+			unsigned int offset = reads[i].address & 3;
+
+			if (reads[i].size == 0)
+				continue;
+			memcpy(reads[i].buffer, p + offset, reads[i].size);
+			p += 4 * ((offset + reads[i].size + 3) / 4);
+		}
+
+		first = last;
+	}
+
+	return ERROR_OK;
+}
+
 static int cortex_m_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -1819,6 +2061,13 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 	int retval = ERROR_OK;
 	struct reg *reg;
 
+	/* PC samples sent over SWO or the trace port need no polling of
+	 * the core at all */
+	retval = armv7m_trace_profiling(target, samples, max_num_samples,
+			num_samples, seconds);
+	if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		return retval;
+
 	gettimeofday(&timeout, NULL);
 	timeval_add_time(&timeout, seconds, 0);
 
@@ -2666,6 +2915,7 @@ struct target_type cortexm_target = {
 
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
+	.read_memory_vector = cortex_m_read_memory_vector,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
 
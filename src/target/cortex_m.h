@@ -206,6 +206,10 @@ struct cortex_m_common {
 	/* Whether this target has the erratum that makes C_MASKINTS not apply to
 	 * already pending interrupts */
 	bool maskints_erratum;
+
+	/* Set once the queued register read has seen a DCRSR transfer that
+	 * did not complete in time; registers are then read one by one */
+	bool slow_register_read;
 };
 
 static inline struct cortex_m_common *
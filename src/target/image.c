@@ -31,6 +31,7 @@
 
 #include "image.h"
 #include "target.h"
+#include <helper/crc32.h>
 #include <helper/log.h>
 
 /* convert ELF header field to host endianness */
@@ -42,6 +43,10 @@
 	((elf->endianness == ELFDATA2LSB) ? \
 	le_to_h_u32((uint8_t *)&field) : be_to_h_u32((uint8_t *)&field))
 
+#define field64(elf, field) \
+	((elf->endianness == ELFDATA2LSB) ? \
+	le_to_h_u64((uint8_t *)&field) : be_to_h_u64((uint8_t *)&field))
+
 static int autodetect_image_type(struct image *image, const char *url)
 {
 	int retval;
@@ -351,7 +356,29 @@ static int image_ihex_buffer_complete(struct image *image)
 	return retval;
 }
 
-static int image_elf_read_headers(struct image *image)
+/* Read from the ELF file, from its mapping if there is one */
+static int image_elf_read(struct image_elf *elf, uint64_t offset, size_t size,
+		void *buffer, size_t *read_bytes)
+{
+	if (elf->data) {
+		size_t file_size;
+		fileio_size(elf->fileio, &file_size);
+		if (offset > file_size)
+			return ERROR_FILEIO_OPERATION_FAILED;
+		*read_bytes = MIN(size, file_size - offset);
+		memcpy(buffer, elf->data + offset, *read_bytes);
+		return ERROR_OK;
+	}
+
+	if (offset > SIZE_MAX)
+		return ERROR_FILEIO_OPERATION_FAILED;
+	int retval = fileio_seek(elf->fileio, offset);
+	if (retval != ERROR_OK)
+		return retval;
+	return fileio_read(elf->fileio, size, buffer, read_bytes);
+}
+
+static int image_elf32_read_headers(struct image *image)
 {
 	struct image_elf *elf = image->type_private;
 	size_t read_bytes;
@@ -359,14 +386,14 @@ static int image_elf_read_headers(struct image *image)
 	int retval;
 	uint32_t nload, load_to_vaddr = 0;
 
-	elf->header = malloc(sizeof(Elf32_Ehdr));
+	elf->header32 = malloc(sizeof(Elf32_Ehdr));
 
-	if (elf->header == NULL) {
+	if (elf->header32 == NULL) {
 		LOG_ERROR("insufficient memory to perform operation ");
 		return ERROR_FILEIO_OPERATION_FAILED;
 	}
 
-	retval = fileio_read(elf->fileio, sizeof(Elf32_Ehdr), (uint8_t *)elf->header, &read_bytes);
+	retval = image_elf_read(elf, 0, sizeof(Elf32_Ehdr), elf->header32, &read_bytes);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("cannot read ELF file header, read failed");
 		return ERROR_FILEIO_OPERATION_FAILED;
@@ -376,42 +403,20 @@ static int image_elf_read_headers(struct image *image)
 		return ERROR_FILEIO_OPERATION_FAILED;
 	}
 
-	if (strncmp((char *)elf->header->e_ident, ELFMAG, SELFMAG) != 0) {
-		LOG_ERROR("invalid ELF file, bad magic number");
-		return ERROR_IMAGE_FORMAT_ERROR;
-	}
-	if (elf->header->e_ident[EI_CLASS] != ELFCLASS32) {
-		LOG_ERROR("invalid ELF file, only 32bits files are supported");
-		return ERROR_IMAGE_FORMAT_ERROR;
-	}
-
-	elf->endianness = elf->header->e_ident[EI_DATA];
-	if ((elf->endianness != ELFDATA2LSB)
-		&& (elf->endianness != ELFDATA2MSB)) {
-		LOG_ERROR("invalid ELF file, unknown endianness setting");
-		return ERROR_IMAGE_FORMAT_ERROR;
-	}
-
-	elf->segment_count = field16(elf, elf->header->e_phnum);
+	elf->segment_count = field16(elf, elf->header32->e_phnum);
 	if (elf->segment_count == 0) {
 		LOG_ERROR("invalid ELF file, no program headers");
 		return ERROR_IMAGE_FORMAT_ERROR;
 	}
 
-	retval = fileio_seek(elf->fileio, field32(elf, elf->header->e_phoff));
-	if (retval != ERROR_OK) {
-		LOG_ERROR("cannot seek to ELF program header table, read failed");
-		return retval;
-	}
-
-	elf->segments = malloc(elf->segment_count*sizeof(Elf32_Phdr));
-	if (elf->segments == NULL) {
+	elf->segments32 = malloc(elf->segment_count*sizeof(Elf32_Phdr));
+	if (elf->segments32 == NULL) {
 		LOG_ERROR("insufficient memory to perform operation ");
 		return ERROR_FILEIO_OPERATION_FAILED;
 	}
 
-	retval = fileio_read(elf->fileio, elf->segment_count*sizeof(Elf32_Phdr),
-			(uint8_t *)elf->segments, &read_bytes);
+	retval = image_elf_read(elf, field32(elf, elf->header32->e_phoff),
+			elf->segment_count*sizeof(Elf32_Phdr), elf->segments32, &read_bytes);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("cannot read ELF segment headers, read failed");
 		return retval;
@@ -425,8 +430,8 @@ static int image_elf_read_headers(struct image *image)
 	image->num_sections = 0;
 	for (i = 0; i < elf->segment_count; i++)
 		if ((field32(elf,
-			elf->segments[i].p_type) == PT_LOAD) &&
-			(field32(elf, elf->segments[i].p_filesz) != 0))
+			elf->segments32[i].p_type) == PT_LOAD) &&
+			(field32(elf, elf->segments32[i].p_filesz) != 0))
 			image->num_sections++;
 
 	assert(image->num_sections > 0);
@@ -442,11 +447,11 @@ static int image_elf_read_headers(struct image *image)
 	 * when obtaining lma - look at elf.c of BDF)
 	 */
 	for (nload = 0, i = 0; i < elf->segment_count; i++)
-		if (elf->segments[i].p_paddr != 0)
+		if (elf->segments32[i].p_paddr != 0)
 			break;
 		else if ((field32(elf,
-			elf->segments[i].p_type) == PT_LOAD) &&
-			(field32(elf, elf->segments[i].p_memsz) != 0))
+			elf->segments32[i].p_type) == PT_LOAD) &&
+			(field32(elf, elf->segments32[i].p_memsz) != 0))
 			++nload;
 
 	if (i >= elf->segment_count && nload > 1)
@@ -456,27 +461,197 @@ static int image_elf_read_headers(struct image *image)
 	image->sections = malloc(image->num_sections * sizeof(struct imagesection));
 	for (i = 0, j = 0; i < elf->segment_count; i++) {
 		if ((field32(elf,
-			elf->segments[i].p_type) == PT_LOAD) &&
-			(field32(elf, elf->segments[i].p_filesz) != 0)) {
-			image->sections[j].size = field32(elf, elf->segments[i].p_filesz);
+			elf->segments32[i].p_type) == PT_LOAD) &&
+			(field32(elf, elf->segments32[i].p_filesz) != 0)) {
+			image->sections[j].size = field32(elf, elf->segments32[i].p_filesz);
 			if (load_to_vaddr)
 				image->sections[j].base_address = field32(elf,
-						elf->segments[i].p_vaddr);
+						elf->segments32[i].p_vaddr);
 			else
 				image->sections[j].base_address = field32(elf,
-						elf->segments[i].p_paddr);
-			image->sections[j].private = &elf->segments[i];
-			image->sections[j].flags = field32(elf, elf->segments[i].p_flags);
+						elf->segments32[i].p_paddr);
+			image->sections[j].private = &elf->segments32[i];
+			image->sections[j].flags = field32(elf, elf->segments32[i].p_flags);
 			j++;
 		}
 	}
 
 	image->start_address_set = 1;
-	image->start_address = field32(elf, elf->header->e_entry);
+	image->start_address = field32(elf, elf->header32->e_entry);
 
 	return ERROR_OK;
 }
 
+static int image_elf64_read_headers(struct image *image)
+{
+	struct image_elf *elf = image->type_private;
+	size_t read_bytes;
+	uint32_t i, j;
+	int retval;
+	uint32_t nload, load_to_vaddr = 0;
+
+	elf->header64 = malloc(sizeof(Elf64_Ehdr));
+
+	if (elf->header64 == NULL) {
+		LOG_ERROR("insufficient memory to perform operation ");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	retval = image_elf_read(elf, 0, sizeof(Elf64_Ehdr), elf->header64, &read_bytes);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("cannot read ELF file header, read failed");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+	if (read_bytes != sizeof(Elf64_Ehdr)) {
+		LOG_ERROR("cannot read ELF file header, only partially read");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	elf->segment_count = field16(elf, elf->header64->e_phnum);
+	if (elf->segment_count == 0) {
+		LOG_ERROR("invalid ELF file, no program headers");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+
+	elf->segments64 = malloc(elf->segment_count*sizeof(Elf64_Phdr));
+	if (elf->segments64 == NULL) {
+		LOG_ERROR("insufficient memory to perform operation ");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	retval = image_elf_read(elf, field64(elf, elf->header64->e_phoff),
+			elf->segment_count*sizeof(Elf64_Phdr), elf->segments64, &read_bytes);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("cannot read ELF segment headers, read failed");
+		return retval;
+	}
+	if (read_bytes != elf->segment_count*sizeof(Elf64_Phdr)) {
+		LOG_ERROR("cannot read ELF segment headers, only partially read");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	/* count useful segments (loadable), ignore BSS section */
+	image->num_sections = 0;
+	for (i = 0; i < elf->segment_count; i++)
+		if ((field32(elf,
+			elf->segments64[i].p_type) == PT_LOAD) &&
+			(field64(elf, elf->segments64[i].p_filesz) != 0)) {
+			if (field64(elf, elf->segments64[i].p_filesz) > UINT32_MAX) {
+				LOG_ERROR("ELF segment %" PRIu32 " is too large", i);
+				return ERROR_IMAGE_FORMAT_ERROR;
+			}
+			image->num_sections++;
+		}
+
+	assert(image->num_sections > 0);
+
+	/* see image_elf32_read_headers() */
+	for (nload = 0, i = 0; i < elf->segment_count; i++)
+		if (elf->segments64[i].p_paddr != 0)
+			break;
+		else if ((field32(elf,
+			elf->segments64[i].p_type) == PT_LOAD) &&
+			(field64(elf, elf->segments64[i].p_memsz) != 0))
+			++nload;
+
+	if (i >= elf->segment_count && nload > 1)
+		load_to_vaddr = 1;
+
+	/* alloc and fill sections array with loadable segments */
+	image->sections = malloc(image->num_sections * sizeof(struct imagesection));
+	for (i = 0, j = 0; i < elf->segment_count; i++) {
+		if ((field32(elf,
+			elf->segments64[i].p_type) == PT_LOAD) &&
+			(field64(elf, elf->segments64[i].p_filesz) != 0)) {
+			image->sections[j].size = field64(elf, elf->segments64[i].p_filesz);
+			if (load_to_vaddr)
+				image->sections[j].base_address = field64(elf,
+						elf->segments64[i].p_vaddr);
+			else
+				image->sections[j].base_address = field64(elf,
+						elf->segments64[i].p_paddr);
+			image->sections[j].private = &elf->segments64[i];
+			image->sections[j].flags = field32(elf, elf->segments64[i].p_flags);
+			j++;
+		}
+	}
+
+	image->start_address_set = 1;
+	image->start_address = field64(elf, elf->header64->e_entry);
+
+	return ERROR_OK;
+}
+
+static int image_elf_read_headers(struct image *image)
+{
+	struct image_elf *elf = image->type_private;
+	size_t read_bytes;
+	unsigned char e_ident[EI_NIDENT];
+	int retval;
+
+	elf->header32 = NULL;
+	elf->segments32 = NULL;
+
+	/* map the file if possible, segments are then read straight from it */
+	if (fileio_map(elf->fileio, &elf->data) != ERROR_OK)
+		elf->data = NULL;
+
+	retval = image_elf_read(elf, 0, EI_NIDENT, e_ident, &read_bytes);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("cannot read ELF file header, read failed");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+	if (read_bytes != EI_NIDENT) {
+		LOG_ERROR("cannot read ELF file header, only partially read");
+		return ERROR_FILEIO_OPERATION_FAILED;
+	}
+
+	if (strncmp((char *)e_ident, ELFMAG, SELFMAG) != 0) {
+		LOG_ERROR("invalid ELF file, bad magic number");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+
+	elf->endianness = e_ident[EI_DATA];
+	if ((elf->endianness != ELFDATA2LSB)
+		&& (elf->endianness != ELFDATA2MSB)) {
+		LOG_ERROR("invalid ELF file, unknown endianness setting");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+
+	switch (e_ident[EI_CLASS]) {
+		case ELFCLASS32:
+			LOG_DEBUG("ELF32 image detected.");
+			elf->is_64_bit = false;
+			return image_elf32_read_headers(image);
+
+		case ELFCLASS64:
+			LOG_DEBUG("ELF64 image detected.");
+			elf->is_64_bit = true;
+			return image_elf64_read_headers(image);
+
+		default:
+			LOG_ERROR("invalid ELF file, only 32/64 bit ELF files are supported");
+			return ERROR_IMAGE_FORMAT_ERROR;
+	}
+}
+
+/* File offset and size in the file of the segment of a section */
+static void image_elf_segment(struct image *image, int section,
+		uint64_t *offset, uint64_t *filesz)
+{
+	struct image_elf *elf = image->type_private;
+
+	if (elf->is_64_bit) {
+		Elf64_Phdr *segment = (Elf64_Phdr *)image->sections[section].private;
+		*offset = field64(elf, segment->p_offset);
+		*filesz = field64(elf, segment->p_filesz);
+	} else {
+		Elf32_Phdr *segment = (Elf32_Phdr *)image->sections[section].private;
+		*offset = field32(elf, segment->p_offset);
+		*filesz = field32(elf, segment->p_filesz);
+	}
+}
+
 static int image_elf_read_section(struct image *image,
 	int section,
 	uint32_t offset,
@@ -485,7 +660,7 @@ static int image_elf_read_section(struct image *image,
 	size_t *size_read)
 {
 	struct image_elf *elf = image->type_private;
-	Elf32_Phdr *segment = (Elf32_Phdr *)image->sections[section].private;
+	uint64_t p_offset, p_filesz;
 	size_t read_size, really_read;
 	int retval;
 
@@ -493,19 +668,16 @@ static int image_elf_read_section(struct image *image,
 
 	LOG_DEBUG("load segment %d at 0x%" PRIx32 " (sz = 0x%" PRIx32 ")", section, offset, size);
 
+	image_elf_segment(image, section, &p_offset, &p_filesz);
+
 	/* read initialized data in current segment if any */
-	if (offset < field32(elf, segment->p_filesz)) {
+	if (offset < p_filesz) {
 		/* maximal size present in file for the current segment */
-		read_size = MIN(size, field32(elf, segment->p_filesz) - offset);
-		LOG_DEBUG("read elf: size = 0x%zu at 0x%" PRIx32 "", read_size,
-			field32(elf, segment->p_offset) + offset);
+		read_size = MIN(size, p_filesz - offset);
+		LOG_DEBUG("read elf: size = 0x%zx at 0x%" PRIx64 "", read_size,
+			p_offset + offset);
 		/* read initialized area of the segment */
-		retval = fileio_seek(elf->fileio, field32(elf, segment->p_offset) + offset);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("cannot find ELF segment content, seek failed");
-			return retval;
-		}
-		retval = fileio_read(elf->fileio, read_size, buffer, &really_read);
+		retval = image_elf_read(elf, p_offset + offset, read_size, buffer, &really_read);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("cannot read ELF segment content, read failed");
 			return retval;
@@ -520,6 +692,23 @@ static int image_elf_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+static uint8_t *image_elf_section_data(struct image *image, int section)
+{
+	struct image_elf *elf = image->type_private;
+	uint64_t p_offset, p_filesz;
+	size_t file_size;
+
+	if (!elf->data)
+		return NULL;
+
+	image_elf_segment(image, section, &p_offset, &p_filesz);
+	fileio_size(elf->fileio, &file_size);
+	if (p_offset > file_size || p_filesz > file_size - p_offset)
+		return NULL;
+
+	return elf->data + p_offset;
+}
+
 static int image_mot_buffer_complete_inner(struct image *image,
 	char *lpszLine,
 	struct imagesection *section)
@@ -771,7 +960,7 @@ int image_open(struct image *image, const char *url, const char *type_string)
 	} else if (image->type == IMAGE_ELF) {
 		struct image_elf *image_elf;
 
-		image_elf = image->type_private = malloc(sizeof(struct image_elf));
+		image_elf = image->type_private = calloc(1, sizeof(struct image_elf));
 
 		retval = fileio_open(&image_elf->fileio, url, FILEIO_READ, FILEIO_BINARY);
 		if (retval != ERROR_OK)
@@ -936,6 +1125,60 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+/**
+ * Returns the contents of a whole section if the image holds them in memory,
+ * so they can be used without copying, or NULL if they must be read with
+ * image_read_section().  The data stays valid until the image is closed.
+ */
+uint8_t *image_section_data(struct image *image, int section)
+{
+	switch (image->type) {
+		case IMAGE_IHEX:
+		case IMAGE_SRECORD:
+		case IMAGE_BUILDER:
+			return image->sections[section].private;
+		case IMAGE_ELF:
+			return image_elf_section_data(image, section);
+		default:
+			return NULL;
+	}
+}
+
+/**
+ * Get the contents of a whole section.  They are used in place if the image
+ * holds them in memory; otherwise they are read into a new buffer, which is
+ * also returned in *allocated and must be freed by the caller.
+ */
+int image_section_get(struct image *image, int section, uint8_t **data,
+		size_t *size, uint8_t **allocated)
+{
+	*allocated = NULL;
+
+	*data = image_section_data(image, section);
+	if (*data) {
+		*size = image->sections[section].size;
+		return ERROR_OK;
+	}
+
+	*allocated = malloc(image->sections[section].size);
+	if (*allocated == NULL) {
+		LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)",
+				image->sections[section].size);
+		return ERROR_FAIL;
+	}
+
+	int retval = image_read_section(image, section, 0, image->sections[section].size,
+			*allocated, size);
+	if (retval != ERROR_OK) {
+		free(*allocated);
+		*allocated = NULL;
+		return retval;
+	}
+
+	*data = *allocated;
+	return ERROR_OK;
+}
+
 int image_add_section(struct image *image, uint32_t base, uint32_t size, int flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -992,15 +1235,16 @@ void image_close(struct image *image)
 		struct image_elf *image_elf = image->type_private;
 
 		fileio_close(image_elf->fileio);
+		image_elf->data = NULL;
 
-		if (image_elf->header) {
-			free(image_elf->header);
-			image_elf->header = NULL;
+		if (image_elf->header32) {
+			free(image_elf->header32);
+			image_elf->header32 = NULL;
 		}
 
-		if (image_elf->segments) {
-			free(image_elf->segments);
-			image_elf->segments = NULL;
+		if (image_elf->segments32) {
+			free(image_elf->segments32);
+			image_elf->segments32 = NULL;
 		}
 	} else if (image->type == IMAGE_MEMORY) {
 		struct image_memory *image_memory = image->type_private;
@@ -1043,31 +1287,13 @@ int image_calculate_checksum(uint8_t *buffer, uint32_t nbytes, uint32_t *checksu
 	uint32_t crc = 0xffffffff;
 	LOG_DEBUG("Calculating checksum");
 
-	static uint32_t crc32_table[256];
-
-	static bool first_init;
-	if (!first_init) {
-		/* Initialize the CRC table and the decoding table.  */
-		unsigned int i, j, c;
-		for (i = 0; i < 256; i++) {
-			/* as per gdb */
-			for (c = i << 24, j = 8; j > 0; --j)
-				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
-		}
-
-		first_init = true;
-	}
-
 	while (nbytes > 0) {
-		int run = nbytes;
+		uint32_t run = nbytes;
 		if (run > 32768)
 			run = 32768;
+		crc = crc32_be_update(crc, buffer, run);
+		buffer += run;
 		nbytes -= run;
-		while (run--) {
-			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
-		}
 		keep_alive();
 	}
 
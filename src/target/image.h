@@ -80,10 +80,18 @@ struct image_memory {
 
 struct image_elf {
 	struct fileio *fileio;
-	Elf32_Ehdr *header;
-	Elf32_Phdr *segments;
+	bool is_64_bit;
+	union {
+		Elf32_Ehdr *header32;
+		Elf64_Ehdr *header64;
+	};
+	union {
+		Elf32_Phdr *segments32;
+		Elf64_Phdr *segments64;
+	};
 	uint32_t segment_count;
 	uint8_t endianness;
+	uint8_t *data;		/* contents of the file if it could be mapped, or NULL */
 };
 
 struct image_mot {
@@ -94,6 +102,9 @@ struct image_mot {
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, uint32_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+uint8_t *image_section_data(struct image *image, int section);
+int image_section_get(struct image *image, int section, uint8_t **data,
+		size_t *size, uint8_t **allocated);
 void image_close(struct image *image);
 
 int image_add_section(struct image *image, uint32_t base, uint32_t size,
@@ -31,6 +31,7 @@ void riscv_batch_free(struct riscv_batch *batch)
 	free(batch->data_in);
 	free(batch->data_out);
 	free(batch->fields);
+	free(batch->read_keys);
 	free(batch);
 }
 
@@ -129,6 +130,20 @@ void riscv_batch_add_nop(struct riscv_batch *batch)
 	batch->used_scans++;
 }
 
+size_t riscv_batch_finished_scans(struct riscv_batch *batch, unsigned *op)
+{
+	/* The status of each operation is captured by the scan after it; the
+	 * last scan is the NOP added by riscv_batch_run(). */
+	for (size_t i = 1; i < batch->used_scans; ++i) {
+		uint64_t in = buf_get_u64(batch->fields[i].in_value, 0, batch->fields[i].num_bits);
+		*op = get_field(in, DTM_DMI_OP);
+		if (*op != 0)
+			return i - 1;
+	}
+	*op = 0;
+	return batch->used_scans ? batch->used_scans - 1 : 0;
+}
+
 void dump_field(int idle, const struct scan_field *field)
 {
 	static const char * const op_string[] = {"-", "r", "w", "?"};
@@ -61,4 +61,10 @@ uint64_t riscv_batch_get_dmi_read(struct riscv_batch *batch, size_t key);
 /* Scans in a NOP. */
 void riscv_batch_add_nop(struct riscv_batch *batch);
 
+/* After running the batch, returns the number of leading scans whose DMI
+ * operation succeeded.  If that's not all of them, op is set to the status
+ * the DMI reported for the first one that didn't (busy and failed are
+ * sticky, so none of the following operations went through either). */
+size_t riscv_batch_finished_scans(struct riscv_batch *batch, unsigned *op);
+
 #endif
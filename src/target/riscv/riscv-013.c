@@ -1835,35 +1835,22 @@ static void log_memory_access(target_addr_t address, uint64_t value,
 	LOG_DEBUG(fmt, value);
 }
 
-/* Read the relevant sbdata regs depending on size, and put the results into
- * buffer. */
-static int read_memory_bus_word(struct target *target, target_addr_t address,
-		uint32_t size, uint8_t *buffer)
+/* Number of words transferred per batch by system bus block accesses */
+#define SB_BATCH_WORDS 256
+
+static int batch_run(const struct target *target, struct riscv_batch *batch)
 {
-	uint32_t value;
-	if (size > 12) {
-		if (dmi_read(target, &value, DMI_SBDATA3) != ERROR_OK)
-			return ERROR_FAIL;
-		write_to_buf(buffer + 12, value, 4);
-		log_memory_access(address + 12, value, 4, true);
-	}
-	if (size > 8) {
-		if (dmi_read(target, &value, DMI_SBDATA2) != ERROR_OK)
-			return ERROR_FAIL;
-		write_to_buf(buffer + 8, value, 4);
-		log_memory_access(address + 8, value, 4, true);
-	}
-	if (size > 4) {
-		if (dmi_read(target, &value, DMI_SBDATA1) != ERROR_OK)
-			return ERROR_FAIL;
-		write_to_buf(buffer + 4, value, 4);
-		log_memory_access(address + 4, value, 4, true);
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+	if (r->reset_delays_wait >= 0) {
+		r->reset_delays_wait -= batch->used_scans;
+		if (r->reset_delays_wait <= 0) {
+			batch->idle_count = 0;
+			info->dmi_busy_delay = 0;
+			info->ac_busy_delay = 0;
+		}
 	}
-	if (dmi_read(target, &value, DMI_SBDATA0) != ERROR_OK)
-		return ERROR_FAIL;
-	write_to_buf(buffer, value, MIN(size, 4));
-	log_memory_access(address, value, MIN(size, 4), true);
-	return ERROR_OK;
+	return riscv_batch_run(batch);
 }
 
 static uint32_t sb_sbaccess(unsigned size_bytes)
@@ -1940,6 +1927,7 @@ static int read_sbcs_nonbusy(struct target *target, uint32_t *sbcs)
 static int read_memory_bus_v0(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer)
 {
+	RISCV013_INFO(info);
 	LOG_DEBUG("System Bus Access: size: %d\tcount:%d\tstart address: 0x%08"
 			TARGET_PRIxADDR, size, count, address);
 	uint8_t *t_buffer = buffer;
@@ -1991,23 +1979,64 @@ static int read_memory_bus_v0(struct target *target, target_addr_t address,
 	LOG_DEBUG("\r\naccess:  0x%08x", access);
 	dmi_write(target, DMI_SBCS, access);
 
-	while (cur_addr < fin_addr) {
+	/* Read the words in batches.  If the DMI was busy, the reads from the
+	 * first one that got dropped on were ignored; sbdata0 still holds that
+	 * word, so slow down and carry on from there. */
+	time_t start = time(NULL);
+	bool tail_done = count == 0;
+	for (uint32_t done = 0; done < count || !tail_done; ) {
+		uint32_t words = MIN(count - done, SB_BATCH_WORDS);
 		LOG_DEBUG("\r\nsab:autoincrement: \r\n size: %d\tcount:%d\taddress: 0x%08"
-				PRIx64, size, count, cur_addr);
-		/* read */
-		uint32_t value;
-		if (dmi_read(target, &value, DMI_SBDATA0) != ERROR_OK)
-			return ERROR_FAIL;
-		write_to_buf(t_buffer, value, size);
-		cur_addr += size;
-		t_buffer += size;
+				PRIx64, size, words, cur_addr);
+		struct riscv_batch *batch = riscv_batch_alloc(target, words * 2 + 3,
+				info->dmi_busy_delay);
+		for (uint32_t i = 0; i < words; i++)
+			riscv_batch_add_dmi_read(batch, DMI_SBDATA0);
 
 		/* if we are reaching last address, we must clear autoread */
-		if (cur_addr == fin_addr && count != 1) {
-			dmi_write(target, DMI_SBCS, 0);
-			if (dmi_read(target, &value, DMI_SBDATA0) != ERROR_OK)
-				return ERROR_FAIL;
-			write_to_buf(t_buffer, value, size);
+		if (done + words == count) {
+			riscv_batch_add_dmi_write(batch, DMI_SBCS, 0);
+			riscv_batch_add_dmi_read(batch, DMI_SBDATA0);
+		}
+
+		if (batch_run(target, batch) != ERROR_OK) {
+			riscv_batch_free(batch);
+			return ERROR_FAIL;
+		}
+
+		unsigned op;
+		size_t finished = riscv_batch_finished_scans(batch, &op);
+		if (op != DMI_STATUS_SUCCESS && op != DMI_STATUS_BUSY) {
+			LOG_ERROR("System bus read at 0x%" PRIx64 " failed (DMI status %d)",
+					cur_addr + finished / 2 * size, op);
+			riscv_batch_free(batch);
+			return ERROR_FAIL;
+		}
+
+		/* each read is followed by the NOP that returns its value; a read
+		 * that went through counts even if that NOP was dropped */
+		uint32_t read = MIN(words, (finished + 1) / 2);
+		for (uint32_t i = 0; i < read; i++) {
+			uint64_t dmi_out = riscv_batch_get_dmi_read(batch, i);
+			write_to_buf(t_buffer, get_field(dmi_out, DTM_DMI_DATA), size);
+			cur_addr += size;
+			t_buffer += size;
+		}
+		done += read;
+		if (done == count && finished >= 2 * words + 2)
+			tail_done = true;
+
+		riscv_batch_free(batch);
+
+		if (op == DMI_STATUS_BUSY) {
+			increase_dmi_busy_delay(target);
+			if (read)
+				start = time(NULL);
+			else if (time(NULL) - start > riscv_command_timeout_sec) {
+				LOG_ERROR("DMI stayed busy for %ds during system bus read",
+						riscv_command_timeout_sec);
+				return ERROR_TIMEOUT_REACHED;
+			}
 		}
 	}
 
@@ -2016,6 +2045,12 @@ static int read_memory_bus_v0(struct target *target, target_addr_t address,
 
 /**
  * Read the requested memory using the system bus interface.
+ *
+ * The sbdata reads are queued in batches, with bus_master_read_delay idle
+ * cycles after every scan so each bus read can complete before its result is
+ * scanned out. After each batch sbcs is checked. On sbbusyerror the delay is
+ * increased and the read resumes at the first word that was not read
+ * successfully, keeping what was read before.
  */
 static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer)
@@ -2023,76 +2058,114 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	RISCV013_INFO(info);
 	target_addr_t next_address = address;
 	target_addr_t end_address = address + count * size;
+	unsigned sbdata_regs = DIV_ROUND_UP(size, 4);
 
 	while (next_address < end_address) {
 		uint32_t sbcs = set_field(0, DMI_SBCS_SBREADONADDR, 1);
 		sbcs |= sb_sbaccess(size);
 		sbcs = set_field(sbcs, DMI_SBCS_SBAUTOINCREMENT, 1);
-		sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, count > 1);
+		sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, end_address - next_address > size);
 		dmi_write(target, DMI_SBCS, sbcs);
 
 		/* This address write will trigger the first read. */
 		sb_write_address(target, next_address);
 
-		if (info->bus_master_read_delay) {
-			jtag_add_runtest(info->bus_master_read_delay, TAP_IDLE);
-			if (jtag_execute_queue() != ERROR_OK) {
-				LOG_ERROR("Failed to scan idle sequence");
+		bool restart = false;
+		while (next_address < end_address && !restart) {
+			uint32_t first = (next_address - address) / size;
+			uint32_t words = MIN(count - first, SB_BATCH_WORDS);
+			struct riscv_batch *batch = riscv_batch_alloc(target,
+					words * sbdata_regs * 2 + 1,
+					info->dmi_busy_delay + info->bus_master_read_delay);
+
+			for (uint32_t i = first; i < first + words; i++) {
+				/* Don't start another read after the last word. */
+				if (i == count - 1 && count > 1)
+					riscv_batch_add_dmi_write(batch, DMI_SBCS,
+							set_field(sbcs, DMI_SBCS_SBREADONDATA, 0));
+				/* Reading sbdata0 triggers the next read, so it goes last. */
+				for (int reg = sbdata_regs - 1; reg >= 0; reg--)
+					riscv_batch_add_dmi_read(batch, DMI_SBDATA0 + reg);
+			}
+
+			if (batch_run(target, batch) != ERROR_OK) {
+				riscv_batch_free(batch);
 				return ERROR_FAIL;
 			}
-		}
 
-		for (uint32_t i = (next_address - address) / size; i < count - 1; i++) {
-			read_memory_bus_word(target, address + i * size, size,
-					buffer + i * size);
-		}
+			uint32_t sbcs_read;
+			if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK) {
+				riscv_batch_free(batch);
+				return ERROR_FAIL;
+			}
 
-		sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, 0);
-		dmi_write(target, DMI_SBCS, sbcs);
+			/* Number of words whose reads completed successfully */
+			uint32_t done = words;
+			size_t key = 0;
+			for (uint32_t i = 0; i < words && done == words; i++) {
+				for (unsigned reg = 0; reg < sbdata_regs; reg++) {
+					uint64_t dmi_out = riscv_batch_get_dmi_read(batch, key++);
+					if (get_field(dmi_out, DTM_DMI_OP) != DMI_STATUS_SUCCESS) {
+						done = i;
+						break;
+					}
+				}
+			}
+			if (done < words) {
+				/* The DMI was busy, so some of the scans were ignored. The busy
+				 * state is sticky, so reading sbcs above already cleared it and
+				 * increased dmi_busy_delay. */
+				LOG_DEBUG("DMI busy during system bus read at 0x%" TARGET_PRIxADDR,
+						address + (first + done) * size);
+				restart = true;
+			}
 
-		read_memory_bus_word(target, address + (count - 1) * size, size,
-				buffer + (count - 1) * size);
+			if (get_field(sbcs_read, DMI_SBCS_SBBUSYERROR)) {
+				/* We read while the target was busy, so the result of the read
+				 * still in progress was lost. sbaddress points just past that
+				 * word. Slow down and continue from there. */
+				dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
+				target_addr_t resume = sb_read_address(target) - size;
+				if (resume < next_address)
+					resume = next_address;
+				if (done > (resume - next_address) / size)
+					done = (resume - next_address) / size;
+				info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+				LOG_DEBUG("sbbusyerror, bus_master_read_delay=%d",
+						info->bus_master_read_delay);
+				restart = true;
+			}
 
-		if (read_sbcs_nonbusy(target, &sbcs) != ERROR_OK)
-			return ERROR_FAIL;
+			unsigned error = get_field(sbcs_read, DMI_SBCS_SBERROR);
+			if (error) {
+				/* Some error indicating the bus access failed, but not because of
+				 * something we did wrong. */
+				dmi_write(target, DMI_SBCS, DMI_SBCS_SBERROR);
+				riscv_batch_free(batch);
+				return ERROR_FAIL;
+			}
 
-		if (get_field(sbcs, DMI_SBCS_SBBUSYERROR)) {
-			/* We read while the target was busy. Slow down and try again. */
-			dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
-			next_address = sb_read_address(target);
-			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
-			continue;
-		}
+			key = 0;
+			for (uint32_t i = 0; i < done; i++) {
+				target_addr_t word_address = address + (first + i) * size;
+				uint8_t *p = buffer + (first + i) * size;
+				for (int reg = sbdata_regs - 1; reg >= 0; reg--) {
+					uint32_t value = get_field(riscv_batch_get_dmi_read(batch, key++),
+							DTM_DMI_DATA);
+					write_to_buf(p + 4 * reg, value, MIN(size - 4 * reg, 4));
+					log_memory_access(word_address + 4 * reg, value,
+							MIN(size - 4 * reg, 4), true);
+				}
+			}
+			next_address += done * size;
 
-		unsigned error = get_field(sbcs, DMI_SBCS_SBERROR);
-		if (error == 0) {
-			next_address = end_address;
-		} else {
-			/* Some error indicating the bus access failed, but not because of
-			 * something we did wrong. */
-			dmi_write(target, DMI_SBCS, DMI_SBCS_SBERROR);
-			return ERROR_FAIL;
+			riscv_batch_free(batch);
 		}
 	}
 
 	return ERROR_OK;
 }
 
-static int batch_run(const struct target *target, struct riscv_batch *batch)
-{
-	RISCV013_INFO(info);
-	RISCV_INFO(r);
-	if (r->reset_delays_wait >= 0) {
-		r->reset_delays_wait -= batch->used_scans;
-		if (r->reset_delays_wait <= 0) {
-			batch->idle_count = 0;
-			info->dmi_busy_delay = 0;
-			info->ac_busy_delay = 0;
-		}
-	}
-	return riscv_batch_run(batch);
-}
-
 /**
  * Read the requested memory, taking care to execute every read exactly once,
  * even if cmderr=busy is encountered.
@@ -2409,6 +2482,7 @@ static int read_memory(struct target *target, target_addr_t address,
 static int write_memory_bus_v0(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
+	RISCV013_INFO(info);
 	/*1) write sbaddress: for singlewrite and autoincrement, we need to write the address once*/
 	LOG_DEBUG("System Bus Access: size: %d\tcount:%d\tstart address: 0x%08"
 			TARGET_PRIxADDR, size, count, address);
@@ -2458,34 +2532,59 @@ static int write_memory_bus_v0(struct target *target, target_addr_t address,
 	LOG_DEBUG("\r\naccess:  0x%08" PRIx64, access);
 	dmi_write(target, DMI_SBCS, access);
 
-	/*2)set the value according to the size required and write*/
-	for (riscv_addr_t i = 0; i < count; ++i) {
-		offset = size*i;
-		/* for monitoring only */
-		t_addr = address + offset;
-		t_buffer = buffer + offset;
-
-		switch (size) {
-			case 1:
-				value = t_buffer[0];
-				break;
-			case 2:
-				value = t_buffer[0]
-					| ((uint32_t) t_buffer[1] << 8);
-				break;
-			case 4:
-				value = t_buffer[0]
-					| ((uint32_t) t_buffer[1] << 8)
-					| ((uint32_t) t_buffer[2] << 16)
+	/*2)set the value according to the size required and write, in batches*/
+	if (size != 1 && size != 2 && size != 4) {
+		LOG_ERROR("unsupported access size: %d", size);
+		return ERROR_FAIL;
+	}
+	time_t start = time(NULL);
+	for (riscv_addr_t done = 0; done < count; ) {
+		riscv_addr_t words = MIN(count - done, SB_BATCH_WORDS);
+		struct riscv_batch *batch = riscv_batch_alloc(target, words,
+				info->dmi_busy_delay);
+
+		for (riscv_addr_t i = done; i < done + words; ++i) {
+			offset = size*i;
+			/* for monitoring only */
+			t_addr = address + offset;
+			t_buffer = buffer + offset;
+
+			value = t_buffer[0];
+			if (size > 1)
+				value |= (uint32_t) t_buffer[1] << 8;
+			if (size > 2)
+				value |= ((uint32_t) t_buffer[2] << 16)
 					| ((uint32_t) t_buffer[3] << 24);
-				break;
-			default:
-				LOG_ERROR("unsupported access size: %d", size);
-				return ERROR_FAIL;
+			LOG_DEBUG("SAB:autoincrement: expected address: 0x%08x value: 0x%08x"
+					PRIx64, (uint32_t)t_addr, (uint32_t)value);
+			riscv_batch_add_dmi_write(batch, DMI_SBDATA0, value);
+		}
+
+		int result = batch_run(target, batch);
+		unsigned op;
+		riscv_addr_t written = MIN(words, riscv_batch_finished_scans(batch, &op));
+		riscv_batch_free(batch);
+		if (result != ERROR_OK)
+			return ERROR_FAIL;
+		if (op != DMI_STATUS_SUCCESS && op != DMI_STATUS_BUSY) {
+			LOG_ERROR("System bus write at 0x%" PRIx64 " failed (DMI status %d)",
+					address + (done + written) * size, op);
+			return ERROR_FAIL;
+		}
+
+		/* Writes dropped by a busy DMI didn't advance sbaddress, so slow
+		 * down and resume with the first of them. */
+		done += written;
+		if (op == DMI_STATUS_BUSY) {
+			increase_dmi_busy_delay(target);
+			if (written)
+				start = time(NULL);
+			else if (time(NULL) - start > riscv_command_timeout_sec) {
+				LOG_ERROR("DMI stayed busy for %ds during system bus write",
+						riscv_command_timeout_sec);
+				return ERROR_TIMEOUT_REACHED;
+			}
 		}
-		LOG_DEBUG("SAB:autoincrement: expected address: 0x%08x value: 0x%08x"
-				PRIx64, (uint32_t)t_addr, (uint32_t)value);
-		dmi_write(target, DMI_SBDATA0, value);
 	}
 	/*reset the autoincrement when finished (something weird is happening if this is not done at the end*/
 	access = set_field(access, DMI_SBCS_SBAUTOINCREMENT, 0);
@@ -2494,6 +2593,14 @@ static int write_memory_bus_v0(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
+/**
+ * Write the requested memory using the system bus interface.
+ *
+ * The sbdata writes are queued in batches, with bus_master_write_delay idle
+ * cycles after every scan. After each batch sbaddress tells how far the
+ * writes got; if some were dropped (sbbusyerror, or a busy DMI) the delay is
+ * increased and the write resumes from there.
+ */
 static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer)
 {
@@ -2504,69 +2611,75 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 
 	target_addr_t next_address = address;
 	target_addr_t end_address = address + count * size;
+	unsigned sbdata_regs = DIV_ROUND_UP(size, 4);
 
 	sb_write_address(target, next_address);
 	while (next_address < end_address) {
-		for (uint32_t i = (next_address - address) / size; i < count; i++) {
-			const uint8_t *p = buffer + i * size;
-			if (size > 12)
-				dmi_write(target, DMI_SBDATA3,
-						((uint32_t) p[12]) |
-						(((uint32_t) p[13]) << 8) |
-						(((uint32_t) p[14]) << 16) |
-						(((uint32_t) p[15]) << 24));
-			if (size > 8)
-				dmi_write(target, DMI_SBDATA2,
-						((uint32_t) p[8]) |
-						(((uint32_t) p[9]) << 8) |
-						(((uint32_t) p[10]) << 16) |
-						(((uint32_t) p[11]) << 24));
-			if (size > 4)
-				dmi_write(target, DMI_SBDATA1,
-						((uint32_t) p[4]) |
-						(((uint32_t) p[5]) << 8) |
-						(((uint32_t) p[6]) << 16) |
-						(((uint32_t) p[7]) << 24));
-			uint32_t value = p[0];
-			if (size > 2) {
-				value |= ((uint32_t) p[2]) << 16;
-				value |= ((uint32_t) p[3]) << 24;
-			}
-			if (size > 1)
-				value |= ((uint32_t) p[1]) << 8;
-			dmi_write(target, DMI_SBDATA0, value);
-
-			log_memory_access(address + i * size, value, size, false);
+		uint32_t first = (next_address - address) / size;
+		uint32_t words = MIN(count - first, SB_BATCH_WORDS);
+		struct riscv_batch *batch = riscv_batch_alloc(target,
+				words * sbdata_regs,
+				info->dmi_busy_delay + info->bus_master_write_delay);
 
-			if (info->bus_master_write_delay) {
-				jtag_add_runtest(info->bus_master_write_delay, TAP_IDLE);
-				if (jtag_execute_queue() != ERROR_OK) {
-					LOG_ERROR("Failed to scan idle sequence");
-					return ERROR_FAIL;
+		for (uint32_t i = first; i < first + words; i++) {
+			const uint8_t *p = buffer + i * size;
+			/* Writing sbdata0 starts the bus write, so it goes last. */
+			for (int reg = sbdata_regs - 1; reg >= 0; reg--) {
+				const uint8_t *q = p + 4 * reg;
+				uint32_t value = q[0];
+				if (size - 4 * reg > 2) {
+					value |= ((uint32_t) q[2]) << 16;
+					value |= ((uint32_t) q[3]) << 24;
 				}
+				if (size - 4 * reg > 1)
+					value |= ((uint32_t) q[1]) << 8;
+				riscv_batch_add_dmi_write(batch, DMI_SBDATA0 + reg, value);
+				log_memory_access(address + i * size + 4 * reg, value,
+						MIN(size - 4 * reg, 4), false);
 			}
 		}
 
-		if (read_sbcs_nonbusy(target, &sbcs) != ERROR_OK)
+		int result = batch_run(target, batch);
+		riscv_batch_free(batch);
+		if (result != ERROR_OK)
+			return ERROR_FAIL;
+
+		uint32_t sbcs_read;
+		if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
 			return ERROR_FAIL;
 
-		if (get_field(sbcs, DMI_SBCS_SBBUSYERROR)) {
+		if (get_field(sbcs_read, DMI_SBCS_SBBUSYERROR)) {
 			/* We wrote while the target was busy. Slow down and try again. */
 			dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
-			next_address = sb_read_address(target);
 			info->bus_master_write_delay += info->bus_master_write_delay / 10 + 1;
-			continue;
+			LOG_DEBUG("sbbusyerror, bus_master_write_delay=%d",
+					info->bus_master_write_delay);
 		}
 
-		unsigned error = get_field(sbcs, DMI_SBCS_SBERROR);
-		if (error == 0) {
-			next_address = end_address;
-		} else {
+		unsigned error = get_field(sbcs_read, DMI_SBCS_SBERROR);
+		if (error) {
 			/* Some error indicating the bus access failed, but not because of
 			 * something we did wrong. */
 			dmi_write(target, DMI_SBCS, DMI_SBCS_SBERROR);
 			return ERROR_FAIL;
 		}
+
+		/* sbaddress is the address of the next write the bus will do. */
+		target_addr_t batch_end = next_address + words * size;
+		target_addr_t sbaddress = sb_read_address(target);
+		if (sbaddress == batch_end) {
+			next_address = batch_end;
+			continue;
+		}
+		if (sbaddress < next_address || sbaddress > batch_end) {
+			LOG_ERROR("System bus write stopped at unexpected address 0x%"
+					TARGET_PRIxADDR, sbaddress);
+			return ERROR_FAIL;
+		}
+		/* Without sbbusyerror some of the scans hit a busy DMI, which reading
+		 * sbcs above has already dealt with. */
+		next_address = sbaddress;
+		sb_write_address(target, next_address);
 	}
 
 	return ERROR_OK;
@@ -0,0 +1,595 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/**
+ * @file
+ * Real Time Transfer (RTT) channels compatible with SEGGER RTT.
+ *
+ * The firmware keeps a control block in RAM which starts with an ID
+ * string and describes a number of ring buffers.  Up buffers are
+ * written by the target and drained by the host, down buffers the other
+ * way round.  All accesses are done with background memory accesses
+ * while the core runs.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/command.h>
+#include <helper/binarybuffer.h>
+#include "target.h"
+#include "rtt.h"
+
+#define RTT_CB_MAX_ID_LENGTH		16
+/* ID, number of up and number of down buffers */
+#define RTT_CB_HEADER_SIZE			(RTT_CB_MAX_ID_LENGTH + 8)
+#define RTT_CB_ID_DEFAULT			"SEGGER RTT"
+
+/* Layout of a channel (ring buffer) descriptor */
+#define RTT_CHANNEL_SIZE			24
+#define RTT_CHANNEL_NAME			0
+#define RTT_CHANNEL_BUFFER			4
+#define RTT_CHANNEL_BUFFER_SIZE		8
+#define RTT_CHANNEL_WRITE_POS		12
+#define RTT_CHANNEL_READ_POS		16
+#define RTT_CHANNEL_FLAGS			20
+
+#define RTT_CHANNEL_NAME_LENGTH		32
+
+/* Polling interval while data is flowing, in ms */
+#define RTT_POLLING_INTERVAL_MIN	1
+#define RTT_POLLING_INTERVAL_DEFAULT	100
+
+/* Largest chunk of a channel buffer or search range read at once */
+#define RTT_TRANSFER_SIZE			16384
+
+struct rtt_channel {
+	/* Address of the descriptor */
+	target_addr_t address;
+	uint32_t name_addr;
+	uint32_t buffer_addr;
+	uint32_t size;
+	uint32_t write_pos;
+	uint32_t read_pos;
+	uint32_t flags;
+};
+
+struct rtt_sink {
+	rtt_sink_read read;
+	void *user_data;
+	struct rtt_sink *next;
+};
+
+static struct {
+	/* Search range and ID set by 'rtt setup' */
+	bool configured;
+	target_addr_t address;
+	uint32_t size;
+	char id[RTT_CB_MAX_ID_LENGTH + 1];
+	size_t id_length;
+
+	struct target *target;
+	bool running;
+	target_addr_t cb_address;
+	unsigned int num_up;
+	unsigned int num_down;
+	/* Up channels followed by down channels, as in the control block */
+	struct rtt_channel channels[2 * RTT_MAX_CHANNELS];
+
+	/* Longest time between two polls, and the current one */
+	unsigned int polling_interval;
+	unsigned int interval;
+
+	struct rtt_sink *sinks[RTT_MAX_CHANNELS];
+} rtt = {
+	.polling_interval = RTT_POLLING_INTERVAL_DEFAULT,
+};
+
+static uint8_t rtt_buffer[RTT_TRANSFER_SIZE];
+
+static void rtt_parse_channel(struct target *target, struct rtt_channel *channel,
+		target_addr_t address, const uint8_t *buffer)
+{
+	channel->address = address;
+	channel->name_addr = target_buffer_get_u32(target, buffer + RTT_CHANNEL_NAME);
+	channel->buffer_addr = target_buffer_get_u32(target, buffer + RTT_CHANNEL_BUFFER);
+	channel->size = target_buffer_get_u32(target, buffer + RTT_CHANNEL_BUFFER_SIZE);
+	channel->write_pos = target_buffer_get_u32(target, buffer + RTT_CHANNEL_WRITE_POS);
+	channel->read_pos = target_buffer_get_u32(target, buffer + RTT_CHANNEL_READ_POS);
+	channel->flags = target_buffer_get_u32(target, buffer + RTT_CHANNEL_FLAGS);
+}
+
+static bool rtt_channel_valid(const struct rtt_channel *channel)
+{
+	return channel->buffer_addr && channel->size
+		&& channel->write_pos < channel->size
+		&& channel->read_pos < channel->size;
+}
+
+/* Read the descriptors of all channels in one go */
+static int rtt_read_channels(void)
+{
+	unsigned int count = rtt.num_up + rtt.num_down;
+	uint8_t buffer[2 * RTT_MAX_CHANNELS * RTT_CHANNEL_SIZE];
+	target_addr_t address = rtt.cb_address + RTT_CB_HEADER_SIZE;
+
+	int retval = target_read_buffer(rtt.target, address,
+			count * RTT_CHANNEL_SIZE, buffer);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = 0; i < count; i++)
+		rtt_parse_channel(rtt.target, &rtt.channels[i],
+				address + i * RTT_CHANNEL_SIZE, buffer + i * RTT_CHANNEL_SIZE);
+
+	return ERROR_OK;
+}
+
+static int rtt_read_up_channel(unsigned int index, bool *transferred)
+{
+	struct rtt_channel *channel = &rtt.channels[index];
+	uint32_t read_pos = channel->read_pos;
+
+	if (!rtt_channel_valid(channel))
+		return ERROR_OK;
+
+	while (read_pos != channel->write_pos) {
+		uint32_t end = channel->write_pos > read_pos ? channel->write_pos : channel->size;
+		uint32_t length = MIN(end - read_pos, sizeof(rtt_buffer));
+
+		int retval = target_read_buffer(rtt.target, channel->buffer_addr + read_pos,
+				length, rtt_buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (struct rtt_sink *sink = rtt.sinks[index]; sink; sink = sink->next)
+			sink->read(index, rtt_buffer, length, sink->user_data);
+
+		read_pos += length;
+		if (read_pos == channel->size)
+			read_pos = 0;
+	}
+
+	if (read_pos == channel->read_pos)
+		return ERROR_OK;
+
+	*transferred = true;
+	channel->read_pos = read_pos;
+
+	return target_write_u32(rtt.target, channel->address + RTT_CHANNEL_READ_POS,
+			read_pos);
+}
+
+static bool rtt_have_sinks(void)
+{
+	for (unsigned int i = 0; i < rtt.num_up; i++) {
+		if (rtt.sinks[i])
+			return true;
+	}
+
+	return false;
+}
+
+static int rtt_poll(void *priv)
+{
+	bool transferred = false;
+
+	if (!rtt.running)
+		return ERROR_OK;
+
+	/* Nothing is read while nobody listens, so firmware using blocking
+	 * mode does not run on before a client connected. */
+	if (rtt_have_sinks()) {
+		int retval = rtt_read_channels();
+
+		for (unsigned int i = 0; retval == ERROR_OK && i < rtt.num_up; i++) {
+			if (rtt.sinks[i])
+				retval = rtt_read_up_channel(i, &transferred);
+		}
+
+		if (retval != ERROR_OK)
+			LOG_DEBUG("rtt: failed to poll channels");
+	}
+
+	/* Poll again right away while data is flowing, back off when idle */
+	if (transferred)
+		rtt.interval = RTT_POLLING_INTERVAL_MIN;
+	else
+		rtt.interval = MIN(2 * rtt.interval, rtt.polling_interval);
+
+	return target_register_timer_callback(rtt_poll, rtt.interval,
+			TARGET_TIMER_TYPE_ONESHOT, NULL);
+}
+
+int rtt_register_sink(unsigned int channel, rtt_sink_read read,
+		void *user_data)
+{
+	if (channel >= RTT_MAX_CHANNELS)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	struct rtt_sink *sink = malloc(sizeof(*sink));
+	if (!sink) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	sink->read = read;
+	sink->user_data = user_data;
+	sink->next = rtt.sinks[channel];
+	rtt.sinks[channel] = sink;
+
+	return ERROR_OK;
+}
+
+int rtt_unregister_sink(unsigned int channel, rtt_sink_read read,
+		void *user_data)
+{
+	if (channel >= RTT_MAX_CHANNELS)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	for (struct rtt_sink **p = &rtt.sinks[channel]; *p; p = &(*p)->next) {
+		struct rtt_sink *sink = *p;
+
+		if (sink->read == read && sink->user_data == user_data) {
+			*p = sink->next;
+			free(sink);
+			return ERROR_OK;
+		}
+	}
+
+	return ERROR_FAIL;
+}
+
+int rtt_write_channel(unsigned int channel, const uint8_t *buffer,
+		size_t *length)
+{
+	struct rtt_channel down;
+	uint8_t descriptor[RTT_CHANNEL_SIZE];
+
+	if (!rtt.running) {
+		*length = 0;
+		return ERROR_FAIL;
+	}
+
+	if (channel >= rtt.num_down) {
+		LOG_WARNING("rtt: down channel %u is not available", channel);
+		*length = 0;
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	/* The read position may have moved since the last poll */
+	target_addr_t address = rtt.cb_address + RTT_CB_HEADER_SIZE
+		+ (rtt.num_up + channel) * RTT_CHANNEL_SIZE;
+	int retval = target_read_buffer(rtt.target, address, sizeof(descriptor),
+			descriptor);
+	if (retval != ERROR_OK) {
+		*length = 0;
+		return retval;
+	}
+	rtt_parse_channel(rtt.target, &down, address, descriptor);
+
+	if (!rtt_channel_valid(&down)) {
+		LOG_WARNING("rtt: down channel %u is not valid", channel);
+		*length = 0;
+		return ERROR_FAIL;
+	}
+
+	/* One byte is always left free to tell a full buffer from an empty one */
+	uint32_t available;
+	if (down.read_pos > down.write_pos)
+		available = down.read_pos - down.write_pos - 1;
+	else
+		available = down.size - (down.write_pos - down.read_pos) - 1;
+
+	size_t remaining = MIN(*length, available);
+	uint32_t write_pos = down.write_pos;
+
+	*length = remaining;
+
+	while (remaining) {
+		uint32_t chunk = MIN(remaining, down.size - write_pos);
+
+		retval = target_write_buffer(rtt.target, down.buffer_addr + write_pos,
+				chunk, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		buffer += chunk;
+		remaining -= chunk;
+		write_pos += chunk;
+		if (write_pos == down.size)
+			write_pos = 0;
+	}
+
+	if (write_pos == down.write_pos)
+		return ERROR_OK;
+
+	return target_write_u32(rtt.target, address + RTT_CHANNEL_WRITE_POS,
+			write_pos);
+}
+
+static int rtt_find_control_block(struct target *target, target_addr_t *address)
+{
+	uint32_t offset = 0;
+
+	while (offset < rtt.size) {
+		uint32_t length = MIN(sizeof(rtt_buffer), rtt.size - offset);
+
+		int retval = target_read_buffer(target, rtt.address + offset, length,
+				rtt_buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (uint32_t i = 0; i + rtt.id_length <= length; i++) {
+			if (!memcmp(rtt_buffer + i, rtt.id, rtt.id_length)) {
+				*address = rtt.address + offset + i;
+				return ERROR_OK;
+			}
+		}
+
+		if (offset + length >= rtt.size)
+			break;
+
+		/* Overlap the chunks so an ID across their boundary is found */
+		offset += length - (rtt.id_length - 1);
+	}
+
+	return ERROR_FAIL;
+}
+
+static int rtt_start(struct target *target)
+{
+	uint8_t header[RTT_CB_HEADER_SIZE];
+	target_addr_t address;
+	int retval;
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	retval = rtt_find_control_block(target, &address);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("rtt: no control block found in range [0x%8.8" TARGET_PRIxADDR
+				", 0x%8.8" TARGET_PRIxADDR ")", rtt.address,
+				rtt.address + rtt.size);
+		return retval;
+	}
+
+	retval = target_read_buffer(target, address, sizeof(header), header);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t num_up = target_buffer_get_u32(target, header + RTT_CB_MAX_ID_LENGTH);
+	uint32_t num_down = target_buffer_get_u32(target, header + RTT_CB_MAX_ID_LENGTH + 4);
+
+	if (num_up > RTT_MAX_CHANNELS || num_down > RTT_MAX_CHANNELS) {
+		LOG_ERROR("rtt: control block at 0x%8.8" TARGET_PRIxADDR
+				" has an invalid number of channels", address);
+		return ERROR_FAIL;
+	}
+
+	LOG_INFO("rtt: control block found at 0x%8.8" TARGET_PRIxADDR
+			", %" PRIu32 " up and %" PRIu32 " down channels",
+			address, num_up, num_down);
+
+	rtt.target = target;
+	rtt.cb_address = address;
+	rtt.num_up = num_up;
+	rtt.num_down = num_down;
+
+	retval = rtt_read_channels();
+	if (retval != ERROR_OK)
+		return retval;
+
+	rtt.running = true;
+	rtt.interval = RTT_POLLING_INTERVAL_MIN;
+
+	return target_register_timer_callback(rtt_poll, rtt.interval,
+			TARGET_TIMER_TYPE_ONESHOT, NULL);
+}
+
+static void rtt_stop(void)
+{
+	if (!rtt.running)
+		return;
+
+	target_unregister_timer_callback(rtt_poll, NULL);
+	rtt.running = false;
+}
+
+COMMAND_HANDLER(handle_rtt_setup_command)
+{
+	target_addr_t address;
+	uint32_t size;
+
+	if (CMD_ARGC != 2 && CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	const char *id = CMD_ARGC == 3 ? CMD_ARGV[2] : RTT_CB_ID_DEFAULT;
+	size_t id_length = strlen(id);
+
+	if (!id_length || id_length > RTT_CB_MAX_ID_LENGTH) {
+		command_print(CMD, "control block ID must have 1 to %u characters",
+				RTT_CB_MAX_ID_LENGTH);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (size < id_length) {
+		command_print(CMD, "search range is smaller than the control block ID");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	rtt_stop();
+
+	rtt.address = address;
+	rtt.size = size;
+	strcpy(rtt.id, id);
+	rtt.id_length = id_length;
+	rtt.configured = true;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_start_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!rtt.configured) {
+		command_print(CMD, "RTT is not configured, use 'rtt setup' first");
+		return ERROR_FAIL;
+	}
+
+	if (rtt.running) {
+		command_print(CMD, "RTT is already running");
+		return ERROR_OK;
+	}
+
+	return rtt_start(get_current_target(CMD_CTX));
+}
+
+COMMAND_HANDLER(handle_rtt_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	rtt_stop();
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_polling_interval_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int interval;
+
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], interval);
+		if (interval < RTT_POLLING_INTERVAL_MIN)
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+
+		rtt.polling_interval = interval;
+		rtt.interval = MIN(rtt.interval, interval);
+	}
+
+	command_print(CMD, "%u ms", rtt.polling_interval);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_channels_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!rtt.running) {
+		command_print(CMD, "RTT is not running");
+		return ERROR_FAIL;
+	}
+
+	int retval = rtt_read_channels();
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = 0; i < rtt.num_up + rtt.num_down; i++) {
+		const struct rtt_channel *channel = &rtt.channels[i];
+		bool up = i < rtt.num_up;
+		char name[RTT_CHANNEL_NAME_LENGTH + 1] = "";
+
+		if (i == 0 || i == rtt.num_up)
+			command_print(CMD, "%s channels:", up ? "Up" : "Down");
+
+		if (!rtt_channel_valid(channel))
+			continue;
+
+		if (channel->name_addr) {
+			retval = target_read_buffer(rtt.target, channel->name_addr,
+					RTT_CHANNEL_NAME_LENGTH, (uint8_t *)name);
+			if (retval != ERROR_OK)
+				return retval;
+			name[RTT_CHANNEL_NAME_LENGTH] = '\0';
+		}
+
+		command_print(CMD, "%u: %s (size: %" PRIu32 ", flags: %" PRIu32 ")",
+				up ? i : i - rtt.num_up, name, channel->size, channel->flags);
+	}
+
+	return ERROR_OK;
+}
+
+static const struct command_registration rtt_subcommand_handlers[] = {
+	{
+		.name = "setup",
+		.handler = handle_rtt_setup_command,
+		.mode = COMMAND_ANY,
+		.help = "set the address range to search for the control block "
+			"and its ID",
+		.usage = "address size [ID]",
+	},
+	{
+		.name = "start",
+		.handler = handle_rtt_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "search the control block and start polling the channels",
+		.usage = "",
+	},
+	{
+		.name = "stop",
+		.handler = handle_rtt_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop polling the channels",
+		.usage = "",
+	},
+	{
+		.name = "polling_interval",
+		.handler = handle_rtt_polling_interval_command,
+		.mode = COMMAND_ANY,
+		.help = "show or set the longest time between two polls while "
+			"no data is flowing",
+		.usage = "[milliseconds]",
+	},
+	{
+		.name = "channels",
+		.handler = handle_rtt_channels_command,
+		.mode = COMMAND_EXEC,
+		.help = "list the channels of the control block",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration rtt_command_handlers[] = {
+	{
+		.name = "rtt",
+		.mode = COMMAND_ANY,
+		.help = "Real Time Transfer commands",
+		.usage = "",
+		.chain = rtt_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int rtt_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, rtt_command_handlers);
+}
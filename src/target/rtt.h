@@ -0,0 +1,50 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_RTT_H
+#define OPENOCD_TARGET_RTT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct command_context;
+
+/** Maximum number of up or down channels of a control block. */
+#define RTT_MAX_CHANNELS	32
+
+/**
+ * Receives data read from an up (target to host) channel.  Called from
+ * the RTT poller, which runs off a timer callback.
+ */
+typedef int (*rtt_sink_read)(unsigned int channel, const uint8_t *buffer,
+		size_t length, void *user_data);
+
+int rtt_register_sink(unsigned int channel, rtt_sink_read read,
+		void *user_data);
+int rtt_unregister_sink(unsigned int channel, rtt_sink_read read,
+		void *user_data);
+
+/**
+ * Write data to a down (host to target) channel.
+ *
+ * @param length On entry the number of bytes in @a buffer, on return
+ *	the number of bytes that fit into the channel buffer.
+ */
+int rtt_write_channel(unsigned int channel, const uint8_t *buffer,
+		size_t *length);
+
+int rtt_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_TARGET_RTT_H */
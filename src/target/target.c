@@ -72,8 +72,9 @@ static int target_get_gdb_fileio_info_default(struct target *target,
 		struct gdb_fileio_info *fileio_info);
 static int target_gdb_fileio_end_default(struct target *target, int retcode,
 		int fileio_errno, bool ctrl_c);
-static int target_profiling_default(struct target *target, uint32_t *samples,
-		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
+static bool target_evict_algorithms(struct target *target);
+static void target_algorithms_overwritten(struct target *target,
+		target_addr_t address, uint32_t size);
 
 /* targets */
 extern struct target_type arm7tdmi_target;
@@ -156,6 +157,7 @@ static struct target_type *target_types[] = {
 struct target *all_targets;
 static struct target_event_callback *target_event_callbacks;
 static struct target_timer_callback *target_timer_callbacks;
+static int64_t target_timer_next_event_value;
 LIST_HEAD(target_reset_callback_list);
 LIST_HEAD(target_trace_callback_list);
 static const int polling_interval = 100;
@@ -941,7 +943,6 @@ int target_run_flash_async_algorithm(struct target *target,
 		uint32_t entry_point, uint32_t exit_point, void *arch_info)
 {
 	int retval;
-	int timeout = 0;
 
 	const uint8_t *buffer_orig = buffer;
 
@@ -977,6 +978,24 @@ int target_run_flash_async_algorithm(struct target *target,
 		return retval;
 	}
 
+	uint32_t fifo_size = fifo_end_addr - fifo_start_addr;
+	uint32_t total_bytes = count * block_size;
+
+	/* Refill the fifo once at least chunk_bytes are free, so the algorithm
+	 * keeps draining one part while we write the next.  The threshold
+	 * adapts: it shrinks if the fifo ran empty (the host is the bottleneck)
+	 * and grows back if we had to wait for the algorithm. */
+	uint32_t max_chunk_bytes = (fifo_size / 2) & ~(block_size - 1);
+	if (max_chunk_bytes < (uint32_t)block_size)
+		max_chunk_bytes = block_size;
+	uint32_t chunk_bytes = max_chunk_bytes;
+
+	int64_t start_ms = timeval_ms();
+	int64_t progress_ms = start_ms;
+	uint32_t last_rp = rp;
+	uint64_t drained = 0;
+	unsigned int chunks = 0, polls = 0, waits = 0;
+
 	while (count > 0) {
 
 		retval = target_read_u32(target, rp_addr, &rp);
@@ -984,6 +1003,7 @@ int target_run_flash_async_algorithm(struct target *target,
 			LOG_ERROR("failed to get read pointer");
 			break;
 		}
+		polls++;
 
 		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
 			(size_t) (buffer - buffer_orig), count, wp, rp);
@@ -999,56 +1019,85 @@ int target_run_flash_async_algorithm(struct target *target,
 			break;
 		}
 
-		/* Count the number of bytes available in the fifo without
-		 * crossing the wrap around. Make sure to not fill it completely,
-		 * because that would make wp == rp and that's the empty condition. */
-		uint32_t thisrun_bytes;
-		if (rp > wp)
-			thisrun_bytes = rp - wp - block_size;
-		else if (rp > fifo_start_addr)
-			thisrun_bytes = fifo_end_addr - wp;
-		else
-			thisrun_bytes = fifo_end_addr - wp - block_size;
+		int64_t now = timeval_ms();
+		if (rp != last_rp) {
+			drained += rp > last_rp ? rp - last_rp : rp + fifo_size - last_rp;
+			last_rp = rp;
+			progress_ms = now;
+		}
+
+		/* Count the bytes free in the fifo. Make sure to not fill it
+		 * completely, because that would make wp == rp and that's the
+		 * empty condition. */
+		uint32_t used = wp >= rp ? wp - rp : wp + fifo_size - rp;
+		uint32_t free_bytes = fifo_size - used - block_size;
 
-		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * programming. The exact delay shouldn't matter as long as it's
-			 * less than buffer size / flash speed. This is very unlikely to
-			 * run when using high latency connections such as USB. */
-			alive_sleep(10);
+		if (used == 0 && chunks > 0 && chunk_bytes > (uint32_t)block_size)
+			chunk_bytes = (chunk_bytes / 2) & ~(block_size - 1);
 
-			/* to stop an infinite loop on some targets check and increment a timeout
+		uint32_t wanted = chunk_bytes;
+		if (wanted > count * block_size)
+			wanted = count * block_size;
+
+		if (free_bytes < wanted) {
+			waits++;
+
+			/* to stop an infinite loop on some targets check for a timeout
 			 * this issue was observed on a stellaris using the new ICDI interface */
-			if (timeout++ >= 500) {
+			if (now - progress_ms >= 5000) {
 				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
 				return ERROR_FLASH_OPERATION_FAILED;
 			}
+
+			if (chunk_bytes < max_chunk_bytes)
+				chunk_bytes = MIN(chunk_bytes * 2, max_chunk_bytes);
+
+			/* Throttle polling if transfer is (much) faster than flash
+			 * programming: sleep about as long as the algorithm needs for
+			 * the missing bytes at the rate observed so far. This is very
+			 * unlikely to run when using high latency connections such as
+			 * USB. */
+			int64_t delay = 10;
+			if (drained && now > start_ms) {
+				delay = (int64_t)(wanted - free_bytes) * (now - start_ms) / drained;
+				delay = MAX(1, MIN(delay, 10));
+			}
+			alive_sleep(delay);
 			continue;
 		}
 
-		/* reset our timeout */
-		timeout = 0;
-
-		/* Limit to the amount of data we actually want to write */
+		/* Fill all free space, wrapping around the end of the fifo */
+		uint32_t thisrun_bytes = free_bytes;
 		if (thisrun_bytes > count * block_size)
 			thisrun_bytes = count * block_size;
 
+		uint32_t first_bytes = fifo_end_addr - wp;
+		if (first_bytes > thisrun_bytes)
+			first_bytes = thisrun_bytes;
+
 		/* Write data to fifo */
-		retval = target_write_buffer(target, wp, thisrun_bytes, buffer);
+		retval = target_write_buffer(target, wp, first_bytes, buffer);
 		if (retval != ERROR_OK)
 			break;
+		if (thisrun_bytes > first_bytes) {
+			retval = target_write_buffer(target, fifo_start_addr,
+					thisrun_bytes - first_bytes, buffer + first_bytes);
+			if (retval != ERROR_OK)
+				break;
+		}
 
 		/* Update counters and wrap write pointer */
 		buffer += thisrun_bytes;
 		count -= thisrun_bytes / block_size;
 		wp += thisrun_bytes;
 		if (wp >= fifo_end_addr)
-			wp = fifo_start_addr;
+			wp -= fifo_size;
 
 		/* Store updated write pointer to target */
 		retval = target_write_u32(target, wp_addr, wp);
 		if (retval != ERROR_OK)
 			break;
+		chunks++;
 
 		/* Avoid GDB timeouts */
 		keep_alive();
@@ -1079,6 +1128,13 @@ int target_run_flash_async_algorithm(struct target *target,
 		}
 	}
 
+	int64_t elapsed_ms = timeval_ms() - start_ms;
+	LOG_DEBUG("async algorithm: %" PRIu32 " bytes in %" PRId64 " ms (%.3f KiB/s), "
+			"%u chunks, %u read pointer polls, %u waits",
+			total_bytes - count * block_size, elapsed_ms,
+			elapsed_ms ? (total_bytes - count * block_size) / 1.024 / elapsed_ms : 0.0,
+			chunks, polls, waits);
+
 	return retval;
 }
 
@@ -1121,6 +1177,8 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	if (target->algorithms)
+		target_algorithms_overwritten(target, address, size * count);
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1135,6 +1193,8 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	if (target->algorithms)
+		target_algorithms_overwritten(target, address, size * count);
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1516,6 +1576,10 @@ int target_register_timer_callback(int (*callback)(void *priv),
 	(*callbacks_p)->priv = priv;
 	(*callbacks_p)->next = NULL;
 
+	int64_t when_ms = timeval_to_ms(&(*callbacks_p)->when);
+	if (when_ms < target_timer_next_event_value)
+		target_timer_next_event_value = when_ms;
+
 	return ERROR_OK;
 }
 
@@ -1587,7 +1651,8 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 
 	for (struct target_timer_callback *c = target_timer_callbacks;
 	     c; c = c->next) {
-		if ((c->callback == callback) && (c->priv == priv)) {
+		/* a oneshot callback may have registered itself again */
+		if ((c->callback == callback) && (c->priv == priv) && !c->removed) {
 			c->removed = true;
 			return ERROR_OK;
 		}
@@ -1678,6 +1743,9 @@ static int target_call_timer_callbacks_check_time(int checktime)
 	struct timeval now;
 	gettimeofday(&now, NULL);
 
+	/* look at the timers again at least once a second */
+	target_timer_next_event_value = timeval_to_ms(&now) + 1000;
+
 	/* Store an address of the place containing a pointer to the
 	 * next item; initially, that's a standalone "root of the
 	 * list" variable. */
@@ -1697,6 +1765,12 @@ static int target_call_timer_callbacks_check_time(int checktime)
 		if (call_it)
 			target_call_timer_callback(*callback, &now);
 
+		if (!(*callback)->removed) {
+			int64_t when_ms = timeval_to_ms(&(*callback)->when);
+			if (when_ms < target_timer_next_event_value)
+				target_timer_next_event_value = when_ms;
+		}
+
 		callback = &(*callback)->next;
 	}
 
@@ -1715,6 +1789,11 @@ int target_call_timer_callbacks_now(void)
 	return target_call_timer_callbacks_check_time(0);
 }
 
+int64_t target_timer_next_event(void)
+{
+	return target_timer_next_event_value;
+}
+
 /* Prints the working area layout for debug purposes */
 static void print_wa_layout(struct target *target)
 {
@@ -1792,7 +1871,7 @@ static void target_merge_working_areas(struct target *target)
 	}
 }
 
-int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
+static int target_alloc_working_area_once(struct target *target, uint32_t size, struct working_area **area)
 {
 	/* Reevaluate working area address based on MMU state*/
 	if (target->working_areas == NULL) {
@@ -1887,6 +1966,19 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	return ERROR_OK;
 }
 
+int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
+{
+	int retval;
+
+	retval = target_alloc_working_area_once(target, size, area);
+
+	/* make room by dropping algorithms kept resident for reuse */
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE && target_evict_algorithms(target))
+		retval = target_alloc_working_area_once(target, size, area);
+
+	return retval;
+}
+
 int target_alloc_working_area(struct target *target, uint32_t size, struct working_area **area)
 {
 	int retval;
@@ -2010,6 +2102,188 @@ uint32_t target_get_working_area_avail(struct target *target)
 	return max_size;
 }
 
+/**
+ * An algorithm kept resident in the working area between uses,
+ * see target_alloc_algorithm().
+ */
+struct target_algorithm {
+	uint32_t hash;
+	uint32_t size;
+	uint8_t *code;
+	/* allocated working area; set to NULL when all working areas get
+	 * freed, as it is registered as the area's user pointer */
+	struct working_area *area;
+	/* area handed out to the current user, if in use */
+	struct working_area *lent;
+	bool in_use;
+	struct target_algorithm *next;
+};
+
+/* FNV-1a, only used to speed up lookups before comparing the code */
+static uint32_t target_algorithm_hash(const uint8_t *code, uint32_t size)
+{
+	uint32_t hash = 2166136261u;
+
+	for (uint32_t i = 0; i < size; i++) {
+		hash ^= code[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/* Unlink and free all idle algorithms selected by "drop" */
+static bool target_drop_algorithms(struct target *target,
+		bool (*drop)(struct target_algorithm *, void *), void *priv, int restore)
+{
+	struct target_algorithm **p = &target->algorithms;
+	bool dropped = false;
+
+	while (*p) {
+		struct target_algorithm *a = *p;
+
+		if (a->in_use || !drop(a, priv)) {
+			p = &a->next;
+			continue;
+		}
+
+		/* unlink first, restoring the area writes memory */
+		*p = a->next;
+		if (a->area)
+			target_free_working_area_restore(target, a->area, restore);
+		free(a->code);
+		free(a);
+
+		target->algorithm_invalidations++;
+		dropped = true;
+	}
+
+	return dropped;
+}
+
+static bool target_algorithm_is_stale(struct target_algorithm *a, void *priv)
+{
+	return a->area == NULL;
+}
+
+static bool target_algorithm_is_any(struct target_algorithm *a, void *priv)
+{
+	return true;
+}
+
+struct target_algorithm_range {
+	target_addr_t address;
+	uint32_t size;
+};
+
+static bool target_algorithm_overlaps(struct target_algorithm *a, void *priv)
+{
+	struct target_algorithm_range *range = priv;
+
+	return a->area &&
+		range->address < a->area->address + a->area->size &&
+		a->area->address < range->address + range->size;
+}
+
+/* Free the working areas of all idle resident algorithms */
+static bool target_evict_algorithms(struct target *target)
+{
+	return target_drop_algorithms(target, target_algorithm_is_any, NULL, 1);
+}
+
+/* Drop idle resident algorithms overwritten by a memory write */
+static void target_algorithms_overwritten(struct target *target,
+		target_addr_t address, uint32_t size)
+{
+	struct target_algorithm_range range = {
+		.address = address,
+		.size = size,
+	};
+
+	/* the write replaced the contents, don't restore a backup over it */
+	target_drop_algorithms(target, target_algorithm_overlaps, &range, 0);
+}
+
+int target_alloc_algorithm(struct target *target, const uint8_t *code,
+		uint32_t size, struct working_area **area)
+{
+	uint32_t hash = target_algorithm_hash(code, size);
+	struct target_algorithm *a;
+	int retval;
+
+	/* forget algorithms whose working area was freed */
+	target_drop_algorithms(target, target_algorithm_is_stale, NULL, 0);
+
+	for (a = target->algorithms; a; a = a->next) {
+		if (!a->in_use && a->hash == hash && a->size == size &&
+				memcmp(a->code, code, size) == 0) {
+			LOG_DEBUG("reusing resident algorithm at " TARGET_ADDR_FMT,
+					a->area->address);
+			target->algorithm_hits++;
+			a->in_use = true;
+			a->lent = a->area;
+			*area = a->area;
+			return ERROR_OK;
+		}
+	}
+
+	target->algorithm_misses++;
+
+	a = calloc(1, sizeof(*a));
+	if (a == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	a->code = malloc(size);
+	if (a->code == NULL) {
+		LOG_ERROR("Out of memory");
+		free(a);
+		return ERROR_FAIL;
+	}
+	memcpy(a->code, code, size);
+	a->hash = hash;
+	a->size = size;
+
+	/* in use from here on, so neither evicted nor invalidated
+	 * by uploading the code */
+	a->in_use = true;
+	a->next = target->algorithms;
+	target->algorithms = a;
+
+	retval = target_alloc_working_area(target, size, &a->area);
+	if (retval == ERROR_OK) {
+		retval = target_write_buffer(target, a->area->address, size, code);
+		if (retval != ERROR_OK)
+			target_free_working_area(target, a->area);
+	}
+
+	if (retval != ERROR_OK) {
+		target->algorithms = a->next;
+		free(a->code);
+		free(a);
+		return retval;
+	}
+
+	a->lent = a->area;
+	*area = a->area;
+	return ERROR_OK;
+}
+
+int target_free_algorithm(struct target *target, struct working_area *area)
+{
+	for (struct target_algorithm *a = target->algorithms; a; a = a->next) {
+		if (a->in_use && a->lent == area) {
+			/* keep it resident; if its area was freed meanwhile
+			 * it gets dropped on the next lookup */
+			a->in_use = false;
+			a->lent = NULL;
+			return ERROR_OK;
+		}
+	}
+
+	return target_free_working_area(target, area);
+}
+
 static void target_destroy(struct target *target)
 {
 	if (target->type->deinit_target)
@@ -2030,6 +2304,13 @@ static void target_destroy(struct target *target)
 
 	target_free_all_working_areas(target);
 
+	while (target->algorithms) {
+		struct target_algorithm *a = target->algorithms;
+		target->algorithms = a->next;
+		free(a->code);
+		free(a);
+	}
+
 	/* release the targets SMP list */
 	if (target->smp) {
 		struct target_list *head = target->head;
@@ -2110,7 +2391,7 @@ static int target_gdb_fileio_end_default(struct target *target,
 	return ERROR_OK;
 }
 
-static int target_profiling_default(struct target *target, uint32_t *samples,
+int target_profiling_default(struct target *target, uint32_t *samples,
 		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
 {
 	struct timeval timeout, now;
@@ -2183,6 +2464,8 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	if (target->algorithms)
+		target_algorithms_overwritten(target, address, size);
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2220,6 +2503,27 @@ static int target_write_buffer_default(struct target *target,
 	return ERROR_OK;
 }
 
+int target_read_memory_vector(struct target *target,
+		const struct target_memory_read *reads, unsigned int count)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->read_memory_vector)
+		return target->type->read_memory_vector(target, reads, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		int retval = target_read_buffer(target, reads[i].address,
+				reads[i].size, reads[i].buffer);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 /* Single aligned words are guaranteed to use 16 or 32 bit access
  * mode respectively, otherwise data is handled as quickly as
  * possible
@@ -3402,6 +3706,7 @@ static COMMAND_HELPER(parse_load_image_command_CMD_ARGV, struct image *image,
 COMMAND_HANDLER(handle_load_image_command)
 {
 	uint8_t *buffer;
+	uint8_t *allocated;
 	size_t buf_cnt;
 	uint32_t image_size;
 	target_addr_t min_address = 0;
@@ -3425,20 +3730,9 @@ COMMAND_HANDLER(handle_load_image_command)
 	image_size = 0x0;
 	retval = ERROR_OK;
 	for (i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
-
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		retval = image_section_get(&image, i, &buffer, &buf_cnt, &allocated);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		uint32_t offset = 0;
 		uint32_t length = buf_cnt;
@@ -3460,7 +3754,7 @@ COMMAND_HANDLER(handle_load_image_command)
 			retval = target_write_buffer(target,
 					image.sections[i].base_address + offset, length, buffer + offset);
 			if (retval != ERROR_OK) {
-				free(buffer);
+				free(allocated);
 				break;
 			}
 			image_size += length;
@@ -3469,7 +3763,7 @@ COMMAND_HANDLER(handle_load_image_command)
 					image.sections[i].base_address + offset);
 		}
 
-		free(buffer);
+		free(allocated);
 	}
 
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
@@ -3555,6 +3849,7 @@ enum verify_mode {
 static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode verify)
 {
 	uint8_t *buffer;
+	uint8_t *allocated;
 	size_t buf_cnt;
 	uint32_t image_size;
 	int i;
@@ -3597,35 +3892,26 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	int diffs = 0;
 	retval = ERROR_OK;
 	for (i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD,
-					"error allocating buffer for section (%d bytes)",
-					(int)(image.sections[i].size));
-			break;
-		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		retval = image_section_get(&image, i, &buffer, &buf_cnt, &allocated);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		if (verify >= IMAGE_VERIFY) {
 			/* calculate checksum of image */
 			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
 			if (retval != ERROR_OK) {
-				free(buffer);
+				free(allocated);
 				break;
 			}
 
 			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
 			if (retval != ERROR_OK) {
-				free(buffer);
+				free(allocated);
 				break;
 			}
 			if ((checksum != mem_checksum) && (verify == IMAGE_CHECKSUM_ONLY)) {
 				LOG_ERROR("checksum mismatch");
-				free(buffer);
+				free(allocated);
 				retval = ERROR_FAIL;
 				goto done;
 			}
@@ -3652,7 +3938,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 							if (diffs++ >= 127) {
 								command_print(CMD, "More than 128 errors, the rest are not printed.");
 								free(data);
-								free(buffer);
+								free(allocated);
 								goto done;
 							}
 						}
@@ -3667,7 +3953,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 						  buf_cnt);
 		}
 
-		free(buffer);
+		free(allocated);
 		image_size += buf_cnt;
 	}
 	if (diffs > 0)
@@ -4063,7 +4349,7 @@ COMMAND_HANDLER(handle_profile_command)
 	if ((CMD_ARGC != 2) && (CMD_ARGC != 4))
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	const uint32_t MAX_PROFILE_SAMPLE_NUM = 10000;
+	const uint32_t MAX_PROFILE_SAMPLE_NUM = 1000000;
 	uint32_t offset;
 	uint32_t num_of_samples;
 	int retval = ERROR_OK;
@@ -5162,6 +5448,36 @@ static int jim_target_wait_state(Jim_Interp *interp, int argc, Jim_Obj *const *a
 	}
 	return JIM_OK;
 }
+
+COMMAND_HANDLER(handle_target_algorithm_cache)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "flush") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		target_evict_algorithms(target);
+	}
+
+	target_drop_algorithms(target, target_algorithm_is_stale, NULL, 0);
+
+	unsigned int resident = 0;
+	uint32_t bytes = 0;
+	for (struct target_algorithm *a = target->algorithms; a; a = a->next) {
+		resident++;
+		bytes += a->size;
+	}
+
+	command_print(CMD, "%u resident algorithms (%" PRIu32 " bytes)", resident, bytes);
+	command_print(CMD, "%" PRIu32 " hits, %" PRIu32 " misses, %" PRIu32 " invalidations",
+			target->algorithm_hits, target->algorithm_misses,
+			target->algorithm_invalidations);
+	return ERROR_OK;
+}
+
 /* List for human, Events defined for this target.
  * scripts/programs should use 'name cget -event NAME'
  */
@@ -5302,6 +5618,14 @@ static const struct command_registration target_instance_command_handlers[] = {
 			"from target memory",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "algorithm_cache",
+		.handler = handle_target_algorithm_cache,
+		.mode = COMMAND_EXEC,
+		.help = "displays statistics of the algorithms kept resident "
+			"in the working area, optionally dropping them first",
+		.usage = "['flush']",
+	},
 	{
 		.name = "eventlist",
 		.handler = handle_target_event_list,
@@ -5769,6 +6093,7 @@ static void free_fastload(void)
 COMMAND_HANDLER(handle_fast_load_image_command)
 {
 	uint8_t *buffer;
+	uint8_t *allocated;
 	size_t buf_cnt;
 	uint32_t image_size;
 	target_addr_t min_address = 0;
@@ -5800,19 +6125,9 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 	}
 	memset(fastload, 0, sizeof(struct FastLoad)*image.num_sections);
 	for (i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD, "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
-
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		retval = image_section_get(&image, i, &buffer, &buf_cnt, &allocated);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		uint32_t offset = 0;
 		uint32_t length = buf_cnt;
@@ -5833,7 +6148,7 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 			fastload[i].address = image.sections[i].base_address + offset;
 			fastload[i].data = malloc(length);
 			if (fastload[i].data == NULL) {
-				free(buffer);
+				free(allocated);
 				command_print(CMD, "error allocating buffer for section (%" PRIu32 " bytes)",
 							  length);
 				retval = ERROR_FAIL;
@@ -5848,7 +6163,7 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 						  ((unsigned int)(image.sections[i].base_address + offset)));
 		}
 
-		free(buffer);
+		free(allocated);
 	}
 
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
@@ -94,6 +94,8 @@ enum target_endianness {
 	TARGET_BIG_ENDIAN = 1, TARGET_LITTLE_ENDIAN = 2
 };
 
+struct target_algorithm;
+
 struct working_area {
 	target_addr_t address;
 	uint32_t size;
@@ -164,6 +166,10 @@ struct target {
 	uint32_t working_area_size;			/* size in bytes */
 	uint32_t backup_working_area;		/* whether the content of the working area has to be preserved */
 	struct working_area *working_areas;/* list of allocated working areas */
+	struct target_algorithm *algorithms;	/* algorithms resident in the working area */
+	uint32_t algorithm_hits;		/* resident algorithm statistics */
+	uint32_t algorithm_misses;
+	uint32_t algorithm_invalidations;
 	enum target_debug_reason debug_reason;/* reason why the target entered debug state */
 	enum target_endianness endianness;	/* target endianness */
 	/* also see: target_state_name() */
@@ -394,6 +400,11 @@ int target_register_timer_callback(int (*callback)(void *priv),
 		unsigned int time_ms, enum target_timer_type type, void *priv);
 int target_unregister_timer_callback(int (*callback)(void *priv), void *priv);
 int target_call_timer_callbacks(void);
+/**
+ * Returns when the next timer callback is due, in the time base of
+ * timeval_ms().  server_loop() sleeps until then.
+ */
+int64_t target_timer_next_event(void);
 /**
  * Invoke this to ensure that e.g. polling timer callbacks happen before
  * a synchronous command completes.
@@ -562,6 +573,10 @@ int target_wait_algorithm(struct target *target,
 /**
  * This routine is a wrapper for asynchronous algorithms.
  *
+ * The algorithm consumes @a count blocks of @a block_size bytes from a
+ * fifo in the working area at @a buffer_start.  The fifo is refilled,
+ * across its wrap around if needed, whenever a sufficient part of it is
+ * free; that part adapts to how fast the algorithm drains it.
  */
 int target_run_flash_async_algorithm(struct target *target,
 		const uint8_t *buffer, uint32_t count, int block_size,
@@ -631,6 +646,24 @@ int target_write_buffer(struct target *target,
 		target_addr_t address, uint32_t size, const uint8_t *buffer);
 int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
+
+/** One read of a target_read_memory_vector() request. */
+struct target_memory_read {
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *buffer;
+};
+
+/**
+ * Read several independent, typically small, blocks of memory.
+ *
+ * Target types which can queue accesses do all reads in few transport
+ * flushes, possibly reading the whole aligned words that contain each
+ * block; so use it for RAM only.  Otherwise every read is done with
+ * target_read_buffer().
+ */
+int target_read_memory_vector(struct target *target,
+		const struct target_memory_read *reads, unsigned int count);
 int target_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t *crc);
 int target_blank_check_memory(struct target *target,
@@ -652,6 +685,15 @@ int target_get_gdb_fileio_info(struct target *target, struct gdb_fileio_info *fi
  */
 int target_gdb_fileio_end(struct target *target, int retcode, int fileio_errno, bool ctrl_c);
 
+/**
+ * Profile a target by halting and resuming it as often as possible.
+ *
+ * This is the profiling method of targets which don't provide one, and
+ * the fallback of those whose hardware PC sampling is unavailable.
+ */
+int target_profiling_default(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
+
 /**
  * Return the highest accessible address for this target.
  */
@@ -698,6 +740,21 @@ int target_free_working_area(struct target *target, struct working_area *area);
 void target_free_all_working_areas(struct target *target);
 uint32_t target_get_working_area_avail(struct target *target);
 
+/**
+ * Allocate a working area holding the algorithm @a code.
+ *
+ * Algorithms freed with target_free_algorithm() stay resident in the
+ * working area, and a later request for identical code gets the same
+ * area back without uploading it again.  They are dropped when all
+ * working areas are freed (on resume or reset), when memory overlapping
+ * them is written, and when other working area allocations need space.
+ * The code must therefore not be modified while running.
+ */
+int target_alloc_algorithm(struct target *target, const uint8_t *code,
+		uint32_t size, struct working_area **area);
+/** Release an area from target_alloc_algorithm(), keeping it resident. */
+int target_free_algorithm(struct target *target, struct working_area *area);
+
 /**
  * Free all the resources allocated by targets and the target layer
  */
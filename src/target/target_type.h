@@ -144,6 +144,15 @@ struct target_type {
 	int (*write_buffer)(struct target *target, target_addr_t address,
 			uint32_t size, const uint8_t *buffer);
 
+	/**
+	 * Optional: perform many small reads with as few round trips as
+	 * possible, e.g. by queuing them all before flushing the transport.
+	 * Do @b not call this function directly, use
+	 * target_read_memory_vector() instead.
+	 */
+	int (*read_memory_vector)(struct target *target,
+			const struct target_memory_read *reads, unsigned int count);
+
 	int (*checksum_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *checksum);
 	int (*blank_check_memory)(struct target *target,
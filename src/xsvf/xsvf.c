@@ -119,7 +119,30 @@ TDO  (1);
 
 #define XSTATE_MAX_PATH 12
 
+/* size of the file read buffer */
+#define XSVF_READ_BUFFER_SIZE	(64 * 1024)
+
+/* captured DR bytes after which queued scans are executed and checked */
+#define XSVF_MAX_PENDING_BYTES	(256 * 1024)
+
 static int xsvf_fd;
+static uint8_t *xsvf_read_buf;
+static size_t xsvf_read_pos, xsvf_read_len;
+static off_t xsvf_read_offset;		/* file offset of xsvf_read_buf[0] */
+
+/* a DR scan whose TDO check is deferred until the queue is executed */
+struct xsvf_pending_check {
+	uint8_t *captured;		/* also holds expected value and mask */
+	uint8_t *expected;
+	uint8_t *mask;
+	int num_bits;
+	const char *op_name;
+	long file_offset;
+};
+
+static struct xsvf_pending_check *xsvf_pending;
+static unsigned int xsvf_pending_count, xsvf_pending_size;
+static size_t xsvf_pending_bytes;
 
 /* map xsvf tap state to an openocd "tap_state_t" */
 static tap_state_t xsvf_to_tap(int xsvf_state)
@@ -183,19 +206,153 @@ static tap_state_t xsvf_to_tap(int xsvf_state)
 	return ret;
 }
 
-static int xsvf_read_buffer(int num_bits, int fd, uint8_t *buf)
+static int xsvf_read(void *buf, size_t len)
+{
+	uint8_t *dst = buf;
+
+	while (len > 0) {
+		if (xsvf_read_pos == xsvf_read_len) {
+			ssize_t n = read(xsvf_fd, xsvf_read_buf, XSVF_READ_BUFFER_SIZE);
+			if (n <= 0)
+				return ERROR_XSVF_EOF;
+			xsvf_read_offset += xsvf_read_len;
+			xsvf_read_pos = 0;
+			xsvf_read_len = n;
+		}
+
+		size_t chunk = MIN(len, xsvf_read_len - xsvf_read_pos);
+		memcpy(dst, xsvf_read_buf + xsvf_read_pos, chunk);
+		xsvf_read_pos += chunk;
+		dst += chunk;
+		len -= chunk;
+	}
+
+	return ERROR_OK;
+}
+
+/* file offset of the next byte xsvf_read() returns */
+static off_t xsvf_tell(void)
+{
+	return xsvf_read_offset + xsvf_read_pos;
+}
+
+static int xsvf_read_buffer(int num_bits, uint8_t *buf)
+{
+	int num_bytes = (num_bits + 7) / 8;
+
+	if (xsvf_read(buf, num_bytes) != ERROR_OK)
+		return ERROR_XSVF_EOF;
+
+	/* reverse the order of bytes as they are read sequentially from file */
+	for (int i = 0, j = num_bytes - 1; i < j; i++, j--) {
+		uint8_t tmp = buf[i];
+		buf[i] = buf[j];
+		buf[j] = tmp;
+	}
+
+	return ERROR_OK;
+}
+
+static void xsvf_free_pending(void)
+{
+	for (unsigned int i = 0; i < xsvf_pending_count; i++)
+		free(xsvf_pending[i].captured);
+	xsvf_pending_count = 0;
+	xsvf_pending_bytes = 0;
+}
+
+/* queue a DR scan and remember what its captured TDO has to match */
+static int xsvf_queue_dr_check(struct jtag_tap *tap, int num_bits,
+		uint8_t *out, const uint8_t *expected, const uint8_t *mask,
+		const char *op_name, long file_offset)
 {
-	int num_bytes;
+	size_t num_bytes = DIV_ROUND_UP(num_bits, 8);
+	struct xsvf_pending_check *check;
+	struct scan_field field;
+
+	if (xsvf_pending_count == xsvf_pending_size) {
+		unsigned int new_size = xsvf_pending_size ? 2 * xsvf_pending_size : 64;
+		check = realloc(xsvf_pending, new_size * sizeof(*check));
+		if (!check) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		xsvf_pending = check;
+		xsvf_pending_size = new_size;
+	}
 
-	for (num_bytes = (num_bits + 7) / 8; num_bytes > 0; num_bytes--) {
-		/* reverse the order of bytes as they are read sequentially from file */
-		if (read(fd, buf + num_bytes - 1, 1) < 0)
-			return ERROR_XSVF_EOF;
+	check = &xsvf_pending[xsvf_pending_count];
+	check->captured = calloc(3, num_bytes);
+	if (!check->captured) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
 	}
+	check->expected = check->captured + num_bytes;
+	check->mask = check->expected + num_bytes;
+	memcpy(check->expected, expected, num_bytes);
+	memcpy(check->mask, mask, num_bytes);
+	check->num_bits = num_bits;
+	check->op_name = op_name;
+	check->file_offset = file_offset;
+	xsvf_pending_count++;
+	xsvf_pending_bytes += num_bytes;
+
+	field.num_bits = num_bits;
+	field.out_value = out;
+	field.in_value = check->captured;
+
+	if (tap == NULL)
+		jtag_add_plain_dr_scan(field.num_bits,
+				field.out_value,
+				field.in_value,
+				TAP_DRPAUSE);
+	else
+		jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
 
 	return ERROR_OK;
 }
 
+/*
+ * Execute the JTAG queue and check all deferred scans against their
+ * expected TDO.  On failure *file_offset and *op_name (if given) are set
+ * to the first failing scan.
+ */
+static int xsvf_flush(long *file_offset, const char **op_name)
+{
+	int result = jtag_execute_queue();
+
+	for (unsigned int i = 0; i < xsvf_pending_count; i++) {
+		struct xsvf_pending_check *check = &xsvf_pending[i];
+
+		if (result == ERROR_OK && !buf_cmp_mask(check->captured,
+				check->expected, check->mask, check->num_bits))
+			continue;
+
+		if (result == ERROR_OK) {
+			int bits = MIN(check->num_bits, DEBUG_JTAG_IOZ);
+			char *captured_str = buf_to_str(check->captured, bits, 16);
+			char *expected_str = buf_to_str(check->expected, bits, 16);
+
+			LOG_WARNING("Bad value '%s' captured during DR scan:", captured_str);
+			LOG_WARNING(" check_value: 0x%s", expected_str);
+
+			free(captured_str);
+			free(expected_str);
+			result = ERROR_JTAG_QUEUE_FAILED;
+		}
+
+		if (file_offset)
+			*file_offset = check->file_offset;
+		if (op_name)
+			*op_name = check->op_name;
+		break;
+	}
+
+	xsvf_free_pending();
+
+	return result;
+}
+
 COMMAND_HANDLER(handle_xsvf_command)
 {
 	uint8_t *dr_out_buf = NULL;				/* from host to device (TDI) */
@@ -260,6 +417,20 @@ COMMAND_HANDLER(handle_xsvf_command)
 		return ERROR_FAIL;
 	}
 
+	/* a previous run that bailed out may have left scans behind */
+	if (xsvf_pending_count)
+		xsvf_flush(NULL, NULL);
+	free(xsvf_read_buf);
+	xsvf_read_buf = malloc(XSVF_READ_BUFFER_SIZE);
+	if (!xsvf_read_buf) {
+		LOG_ERROR("not enough memory");
+		close(xsvf_fd);
+		return ERROR_FAIL;
+	}
+	xsvf_read_pos = 0;
+	xsvf_read_len = 0;
+	xsvf_read_offset = 0;
+
 	/* if this argument is present, then interpret xruntest counts as TCK cycles rather than as
 	 *usecs */
 	if ((CMD_ARGC > 2) && (strcmp(CMD_ARGV[2], "virt2") == 0)) {
@@ -274,9 +445,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 	LOG_WARNING("XSVF support in OpenOCD is limited. Consider using SVF instead");
 	LOG_USER("xsvf processing file: \"%s\"", filename);
 
-	while (read(xsvf_fd, &opcode, 1) > 0) {
+	while (xsvf_read(&opcode, 1) == ERROR_OK) {
 		/* record the position of this opcode within the file */
-		file_offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
+		file_offset = xsvf_tell() - 1;
 
 		/* maybe collect another state for a pathmove();
 		 * or terminate a path.
@@ -296,7 +467,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 						break;
 					}
 
-					if (read(xsvf_fd, &uc, 1) < 0) {
+					if (xsvf_read(&uc, 1) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -344,31 +515,32 @@ COMMAND_HANDLER(handle_xsvf_command)
 					else
 						jtag_add_pathmove(pathlen, path);
 
-					result = jtag_execute_queue();
-					if (result != ERROR_OK) {
-						LOG_ERROR("XSVF: pathmove error %d", result);
-						do_abort = 1;
-						break;
-					}
+					/* path errors show up at the next flush */
 					continue;
 			}
 		}
 
 		switch (opcode) {
 			case XCOMPLETE:
+			{
+				const char *op_name = NULL;
+
 				LOG_DEBUG("XCOMPLETE");
 
-				result = jtag_execute_queue();
+				result = xsvf_flush(&file_offset, &op_name);
 				if (result != ERROR_OK) {
+					if (op_name)
+						LOG_USER("%s mismatch", op_name);
 					tdo_mismatch = 1;
 					break;
 				}
-				break;
+			}
+			break;
 
 			case XTDOMASK:
 				LOG_DEBUG("XTDOMASK");
 				if (dr_in_mask &&
-						(xsvf_read_buffer(xsdrsize, xsvf_fd, dr_in_mask) != ERROR_OK))
+						(xsvf_read_buffer(xsdrsize, dr_in_mask) != ERROR_OK))
 					do_abort = 1;
 				break;
 
@@ -376,7 +548,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t xruntest_buf[4];
 
-				if (read(xsvf_fd, xruntest_buf, 4) < 0) {
+				if (xsvf_read(xruntest_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -390,7 +562,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t myrepeat;
 
-				if (read(xsvf_fd, &myrepeat, 1) < 0)
+				if (xsvf_read(&myrepeat, 1) != ERROR_OK)
 					do_abort = 1;
 				else {
 					xrepeat = myrepeat;
@@ -403,7 +575,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t xsdrsize_buf[4];
 
-				if (read(xsvf_fd, xsdrsize_buf, 4) < 0) {
+				if (xsvf_read(xsdrsize_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -433,80 +605,82 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				const char *op_name = (opcode == XSDR ? "XSDR" : "XSDRTDO");
 
-				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK) {
+				if (xsvf_read_buffer(xsdrsize, dr_out_buf) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
 
 				if (opcode == XSDRTDO) {
-					if (xsvf_read_buffer(xsdrsize, xsvf_fd,
-						dr_in_buf)  != ERROR_OK) {
+					if (xsvf_read_buffer(xsdrsize, dr_in_buf) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
 				}
 
-				if (limit < 1)
-					limit = 1;
-
 				LOG_DEBUG("%s %d", op_name, xsdrsize);
 
-				for (attempt = 0; attempt < limit; ++attempt) {
-					struct scan_field field;
-
-					if (attempt > 0) {
-						/* perform the XC9500 exception handling sequence shown in xapp067.pdf and
-						 * illustrated in psuedo code at end of this file.  We start from state
-						 * DRPAUSE:
-						 * go to Exit2-DR
-						 * go to Shift-DR
-						 * go to Exit1-DR
-						 * go to Update-DR
-						 * go to Run-Test/Idle
-						 *
-						 * This sequence should be harmless for other devices, and it
-						 * will be skipped entirely if xrepeat is set to zero.
-						 */
-
-						static tap_state_t exception_path[] = {
-							TAP_DREXIT2,
-							TAP_DRSHIFT,
-							TAP_DREXIT1,
-							TAP_DRUPDATE,
-							TAP_IDLE,
-						};
-
-						jtag_add_pathmove(ARRAY_SIZE(exception_path), exception_path);
-
-						if (verbose)
-							LOG_USER("%s mismatch, xsdrsize=%d retry=%d",
-									op_name,
-									xsdrsize,
-									attempt);
-					}
-
-					field.num_bits = xsdrsize;
-					field.out_value = dr_out_buf;
-					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
-
-					if (tap == NULL)
-						jtag_add_plain_dr_scan(field.num_bits,
-								field.out_value,
-								field.in_value,
-								TAP_DRPAUSE);
-					else
-						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
-
-					jtag_check_value_mask(&field, dr_in_buf, dr_in_mask);
-
-					free(field.in_value);
-
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
-					if (result == ERROR_OK) {
-						matched = 1;
+				if (limit <= 1) {
+					/* no retries: check along with the following scans */
+					if (xsvf_queue_dr_check(tap, xsdrsize, dr_out_buf, dr_in_buf,
+							dr_in_mask, op_name, file_offset) != ERROR_OK) {
+						do_abort = 1;
 						break;
 					}
+					matched = 1;
+					if (xsvf_pending_bytes >= XSVF_MAX_PENDING_BYTES
+							&& xsvf_flush(&file_offset, &op_name) != ERROR_OK)
+						matched = 0;
+				} else if (xsvf_flush(&file_offset, &op_name) != ERROR_OK) {
+					/* retries need the outcome of each attempt on its own */
+					matched = 0;
+				} else {
+					for (attempt = 0; attempt < limit; ++attempt) {
+						if (attempt > 0) {
+							/* perform the XC9500 exception handling sequence shown in xapp067.pdf and
+							 * illustrated in psuedo code at end of this file.  We start from state
+							 * DRPAUSE:
+							 * go to Exit2-DR
+							 * go to Shift-DR
+							 * go to Exit1-DR
+							 * go to Update-DR
+							 * go to Run-Test/Idle
+							 *
+							 * This sequence should be harmless for other devices, and it
+							 * will be skipped entirely if xrepeat is set to zero.
+							 */
+
+							static tap_state_t exception_path[] = {
+								TAP_DREXIT2,
+								TAP_DRSHIFT,
+								TAP_DREXIT1,
+								TAP_DRUPDATE,
+								TAP_IDLE,
+							};
+
+							jtag_add_pathmove(ARRAY_SIZE(exception_path), exception_path);
+
+							if (verbose)
+								LOG_USER("%s mismatch, xsdrsize=%d retry=%d",
+										op_name,
+										xsdrsize,
+										attempt);
+						}
+
+						if (xsvf_queue_dr_check(tap, xsdrsize, dr_out_buf, dr_in_buf,
+								dr_in_mask, op_name, file_offset) != ERROR_OK) {
+							do_abort = 1;
+							break;
+						}
+
+						/* LOG_DEBUG("FLUSHING QUEUE"); */
+						result = xsvf_flush(NULL, NULL);
+						if (result == ERROR_OK) {
+							matched = 1;
+							break;
+						}
+					}
+					if (do_abort)
+						break;
 				}
 
 				if (!matched) {
@@ -578,7 +752,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				tap_state_t mystate;
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -621,7 +795,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 			case XENDIR:
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -642,7 +816,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 			case XENDDR:
 
-				if (read(xsvf_fd, &uc, 1) < 0) {
+				if (xsvf_read(&uc, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -671,14 +845,14 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				if (opcode == XSIR) {
 					/* one byte bitcount */
-					if (read(xsvf_fd, short_buf, 1) < 0) {
+					if (xsvf_read(short_buf, 1) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
 					bitcount = short_buf[0];
 					LOG_DEBUG("XSIR %d", bitcount);
 				} else {
-					if (read(xsvf_fd, short_buf, 2) < 0) {
+					if (xsvf_read(short_buf, 2) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -688,7 +862,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				ir_buf = malloc((bitcount + 7) / 8);
 
-				if (xsvf_read_buffer(bitcount, xsvf_fd, ir_buf) != ERROR_OK)
+				if (xsvf_read_buffer(bitcount, ir_buf) != ERROR_OK)
 					do_abort = 1;
 				else {
 					struct scan_field field;
@@ -712,13 +886,11 @@ COMMAND_HANDLER(handle_xsvf_command)
 					}
 
 					/* Note that an -irmask of non-zero in your config file
-					 * can cause this to fail.  Setting -irmask to zero cand work
-					 * around the problem.
+					 * can cause the next flush to fail.  Setting -irmask to
+					 * zero cand work around the problem.
 					 */
-
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
-					if (result != ERROR_OK)
+					if (xsvf_pending_bytes >= XSVF_MAX_PENDING_BYTES
+							&& xsvf_flush(&file_offset, NULL) != ERROR_OK)
 						tdo_mismatch = 1;
 				}
 				free(ir_buf);
@@ -731,7 +903,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 				char comment[128];
 
 				do {
-					if (read(xsvf_fd, &uc, 1) < 0) {
+					if (xsvf_read(&uc, 1) != ERROR_OK) {
 						do_abort = 1;
 						break;
 					}
@@ -761,9 +933,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 				tap_state_t end_state;
 				int delay;
 
-				if (read(xsvf_fd, &wait_local, 1) < 0
-					|| read(xsvf_fd, &end, 1) < 0
-					|| read(xsvf_fd, delay_buf, 4) < 0) {
+				if (xsvf_read(&wait_local, 1) != ERROR_OK
+					|| xsvf_read(&end, 1) != ERROR_OK
+					|| xsvf_read(delay_buf, 4) != ERROR_OK) {
 						do_abort = 1;
 						break;
 				}
@@ -806,10 +978,10 @@ COMMAND_HANDLER(handle_xsvf_command)
 				int clock_count;
 				int usecs;
 
-				if (read(xsvf_fd, &wait_local, 1) < 0
-						||  read(xsvf_fd, &end, 1) < 0
-						||  read(xsvf_fd, clock_buf, 4) < 0
-						||  read(xsvf_fd, usecs_buf, 4) < 0) {
+				if (xsvf_read(&wait_local, 1) != ERROR_OK
+						||  xsvf_read(&end, 1) != ERROR_OK
+						||  xsvf_read(clock_buf, 4) != ERROR_OK
+						||  xsvf_read(usecs_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -858,7 +1030,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 				*/
 				uint8_t count_buf[4];
 
-				if (read(xsvf_fd, count_buf, 4) < 0) {
+				if (xsvf_read(count_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -877,9 +1049,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 				uint8_t clock_buf[4];
 				uint8_t usecs_buf[4];
 
-				if (read(xsvf_fd, &state, 1) < 0
-						|| read(xsvf_fd, clock_buf, 4) < 0
-						|| read(xsvf_fd, usecs_buf, 4) < 0) {
+				if (xsvf_read(&state, 1) != ERROR_OK
+						|| xsvf_read(clock_buf, 4) != ERROR_OK
+						|| xsvf_read(usecs_buf, 4) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -905,51 +1077,46 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				LOG_DEBUG("LSDR");
 
-				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK
-						|| xsvf_read_buffer(xsdrsize, xsvf_fd, dr_in_buf) != ERROR_OK) {
+				if (xsvf_read_buffer(xsdrsize, dr_out_buf) != ERROR_OK
+						|| xsvf_read_buffer(xsdrsize, dr_in_buf) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
 
+				/* retries need the outcome of each attempt on its own */
+				if (xsvf_flush(&file_offset, NULL) != ERROR_OK) {
+					tdo_mismatch = 1;
+					break;
+				}
+
 				if (limit < 1)
 					limit = 1;
 
 				for (attempt = 0; attempt < limit; ++attempt) {
-					struct scan_field field;
-
 					result = svf_add_statemove(loop_state);
 					if (result != ERROR_OK)
 						return result;
 					jtag_add_clocks(loop_clocks);
 					jtag_add_sleep(loop_usecs);
 
-					field.num_bits = xsdrsize;
-					field.out_value = dr_out_buf;
-					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
-
 					if (attempt > 0 && verbose)
 						LOG_USER("LSDR retry %d", attempt);
 
-					if (tap == NULL)
-						jtag_add_plain_dr_scan(field.num_bits,
-								field.out_value,
-								field.in_value,
-								TAP_DRPAUSE);
-					else
-						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
-
-					jtag_check_value_mask(&field, dr_in_buf, dr_in_mask);
-
-					free(field.in_value);
-
+					if (xsvf_queue_dr_check(tap, xsdrsize, dr_out_buf, dr_in_buf,
+							dr_in_mask, "LSDR", file_offset) != ERROR_OK) {
+						do_abort = 1;
+						break;
+					}
 
 					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
+					result = xsvf_flush(NULL, NULL);
 					if (result == ERROR_OK) {
 						matched = 1;
 						break;
 					}
 				}
+				if (do_abort)
+					break;
 
 				if (!matched) {
 					LOG_USER("LSDR mismatch");
@@ -963,7 +1130,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 			{
 				uint8_t trst_mode;
 
-				if (read(xsvf_fd, &trst_mode, 1) < 0) {
+				if (xsvf_read(&trst_mode, 1) != ERROR_OK) {
 					do_abort = 1;
 					break;
 				}
@@ -998,12 +1165,24 @@ COMMAND_HANDLER(handle_xsvf_command)
 			if (result != ERROR_OK)
 				return result;
 			result = jtag_execute_queue();
+			xsvf_free_pending();
 			if (result != ERROR_OK)
 				return result;
 			break;
 		}
 	}
 
+	/* check what is still queued when the file ends without XCOMPLETE */
+	if (!do_abort && !unsupported && !tdo_mismatch) {
+		const char *op_name = NULL;
+
+		if (xsvf_flush(&file_offset, &op_name) != ERROR_OK) {
+			if (op_name)
+				LOG_USER("%s mismatch", op_name);
+			tdo_mismatch = 1;
+		}
+	}
+
 	if (tdo_mismatch) {
 		command_print(CMD,
 			"TDO mismatch, somewhere near offset %lu in xsvf file, aborting",
@@ -1013,7 +1192,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 	}
 
 	if (unsupported) {
-		off_t offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
+		off_t offset = xsvf_tell() - 1;
 		command_print(CMD,
 			"unsupported xsvf command (0x%02X) at offset %jd, aborting",
 			uc, (intmax_t)offset);
@@ -1035,6 +1214,8 @@ COMMAND_HANDLER(handle_xsvf_command)
 		free(dr_in_mask);
 
 	close(xsvf_fd);
+	free(xsvf_read_buf);
+	xsvf_read_buf = NULL;
 
 	command_print(CMD, "XSVF file programmed successfully");
 
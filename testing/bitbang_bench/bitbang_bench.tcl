@@ -0,0 +1,45 @@
+#
+# JTAG shift throughput of a bitbang adapter.
+#
+# Shifts the same data register scan "count" times through the first TAP
+# and prints the rate.  No target is needed: the dummy adapter emulates
+# the TAP state machine, remote_bitbang_null.py answers every remote
+# bitbang request.  The scan chain checks at init fail on both (all
+# zero IDCODE), which is expected.
+#
+#   openocd -f interface/dummy.cfg -f testing/bitbang_bench/bitbang_bench.tcl
+#
+# See run.sh for the remote_bitbang setup.
+#
+
+# remote_bitbang also offers SWD; adapters that only know JTAG refuse
+# the selection but have it selected already
+catch {transport select jtag}
+
+jtag newtap bench tap -irlen 4 -ircapture 0 -irmask 0
+init
+
+proc bitbang_bench { {bits 4096} {count 256} } {
+	set tap [lindex [jtag names] 0]
+	set value 0x[string repeat a5 [expr {$bits / 8}]]
+
+	# warm up, e.g. remote_bitbang read ahead
+	drscan $tap $bits $value
+
+	set start [clock milliseconds]
+	for {set i 0} {$i < $count} {incr i} {
+		drscan $tap $bits $value
+	}
+	set ms [expr {[clock milliseconds] - $start}]
+	if { $ms < 1 } {
+		set ms 1
+	}
+
+	echo [format "%s: %d scans of %d bits in %d ms, %.2f Mbit/s" \
+		[adapter_name] $count $bits $ms [expr {$bits * $count / ($ms * 1000.0)}]]
+}
+
+bitbang_bench 32 4096
+bitbang_bench 4096 512
+bitbang_bench 65536 32
+shutdown
@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+#
+# Remote bitbang server without hardware, for bitbang_bench.tcl.
+#
+# Speaks protocol version 0 (it ignores 'V'), so OpenOCD drives it
+# through write_edges(): every request is accepted and every 'R' is
+# answered with a 0 sample.  Only the host side of the protocol is
+# measured.
+#
+#   remote_bitbang_null.py [port]
+#
+
+import socket
+import sys
+
+
+def serve(conn):
+    while True:
+        data = conn.recv(65536)
+        if not data or b'Q' in data:
+            return
+        samples = data.count(b'R')
+        if samples:
+            conn.sendall(b'0' * samples)
+
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 44242
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind(('127.0.0.1', port))
+    srv.listen(1)
+    while True:
+        conn, _ = srv.accept()
+        conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        with conn:
+            serve(conn)
+
+
+if __name__ == '__main__':
+    main()
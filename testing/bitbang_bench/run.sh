@@ -0,0 +1,21 @@
+#!/bin/sh
+#
+# Measure bitbang JTAG throughput through the dummy and remote_bitbang
+# adapters.  Run from the top of the source tree; OPENOCD selects the
+# binary (default: src/openocd).
+#
+
+OPENOCD=${OPENOCD:-src/openocd}
+PORT=${PORT:-44242}
+DIR=$(dirname "$0")
+
+"$OPENOCD" -s tcl -f interface/dummy.cfg -f "$DIR/bitbang_bench.tcl" || exit 1
+
+python3 "$DIR/remote_bitbang_null.py" "$PORT" &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null' EXIT
+sleep 1
+
+"$OPENOCD" -s tcl -c "interface remote_bitbang" \
+	-c "remote_bitbang_host 127.0.0.1" -c "remote_bitbang_port $PORT" \
+	-f "$DIR/bitbang_bench.tcl"
@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+ * Checks the slicing-by-8 CRC used by image_calculate_checksum() against
+ * a known answer and against the bytewise gdb loop on random buffers,
+ * then compares their speed.  Build and run from the top of the tree:
+ *
+ *   cc -O2 -Isrc -o crc32_check testing/crc32/crc32_check.c src/helper/crc32.c
+ *   ./crc32_check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <helper/crc32.h>
+
+#define BENCH_SIZE	(64 * 1024 * 1024)
+
+static double seconds(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+int main(void)
+{
+	static const uint8_t check[] = "123456789";
+	int failed = 0;
+
+	/* CRC-32/MPEG-2 check value, the same parameters as gdb's qCRC */
+	uint32_t crc = crc32_be_update(0xffffffff, check, sizeof(check) - 1);
+	if (crc != 0x0376e6e7) {
+		printf("known answer: got 0x%08x, expected 0x0376e6e7\n", (unsigned)crc);
+		failed = 1;
+	}
+
+	uint8_t *buffer = malloc(BENCH_SIZE);
+	if (!buffer)
+		return 1;
+	srand(1);
+	for (size_t i = 0; i < BENCH_SIZE; i++)
+		buffer[i] = rand();
+
+	/* random lengths and alignments, split at random points */
+	for (int i = 0; i < 10000; i++) {
+		size_t offset = rand() % 64;
+		size_t len = rand() % 4096;
+		size_t split = len ? rand() % len : 0;
+
+		uint32_t expected = crc32_be_update_bytewise(0xffffffff, buffer + offset, len);
+		crc = crc32_be_update(0xffffffff, buffer + offset, split);
+		crc = crc32_be_update(crc, buffer + offset + split, len - split);
+		if (crc != expected) {
+			printf("mismatch: offset %zu, length %zu, split %zu: 0x%08x != 0x%08x\n",
+					offset, len, split, (unsigned)crc, (unsigned)expected);
+			failed = 1;
+			break;
+		}
+	}
+
+	double start = seconds();
+	uint32_t expected = crc32_be_update_bytewise(0xffffffff, buffer, BENCH_SIZE);
+	double bytewise = seconds() - start;
+
+	start = seconds();
+	crc = crc32_be_update(0xffffffff, buffer, BENCH_SIZE);
+	double sliced = seconds() - start;
+
+	if (crc != expected) {
+		printf("mismatch on %d bytes\n", BENCH_SIZE);
+		failed = 1;
+	}
+
+	printf("bytewise:     %7.1f MB/s\n", BENCH_SIZE / 1e6 / bytewise);
+	printf("slicing-by-8: %7.1f MB/s\n", BENCH_SIZE / 1e6 / sliced);
+	printf("%s\n", failed ? "FAILED" : "OK");
+
+	free(buffer);
+	return failed;
+}